@@ -0,0 +1,57 @@
+#ifndef SPARKS_CORE_ALIGNED_ALLOCATOR_HPP_
+#define SPARKS_CORE_ALIGNED_ALLOCATOR_HPP_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace sparks {
+
+// A standard allocator which aligns every allocation to ALIGNMENT bytes (a
+// power of two, at least sizeof(void*)). Used for packed arrays which are
+// processed with SIMD and should start on a cache line.
+template <typename T, size_t ALIGNMENT = 64>
+class AlignedAllocator {
+ public:
+  using value_type = T;
+
+  static_assert((ALIGNMENT & (ALIGNMENT - 1)) == 0,
+                "alignment must be a power of two");
+  static_assert(ALIGNMENT >= sizeof(void*), "alignment too small");
+
+  template <typename U>
+  struct rebind {
+    using other = AlignedAllocator<U, ALIGNMENT>;
+  };
+
+  AlignedAllocator() = default;
+
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, ALIGNMENT>&) {}
+
+  T* allocate(size_t n) {
+    void* memory = nullptr;
+    if (posix_memalign(&memory, ALIGNMENT, n * sizeof(T)) != 0) {
+      throw std::bad_alloc{};
+    }
+    return static_cast<T*>(memory);
+  }
+
+  void deallocate(T* memory, size_t) { free(memory); }
+};
+
+template <typename T, typename U, size_t ALIGNMENT>
+bool operator==(const AlignedAllocator<T, ALIGNMENT>&,
+                const AlignedAllocator<U, ALIGNMENT>&) {
+  return true;
+}
+
+template <typename T, typename U, size_t ALIGNMENT>
+bool operator!=(const AlignedAllocator<T, ALIGNMENT>&,
+                const AlignedAllocator<U, ALIGNMENT>&) {
+  return false;
+}
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_ALIGNED_ALLOCATOR_HPP_
@@ -0,0 +1,67 @@
+#include "arraydelegate.hpp"
+
+#include <cstdint>
+#include <functional>
+
+#include <benchmark/benchmark.h>
+
+namespace sparks {
+namespace {
+
+// A closure the size of a typical task: three captured words.
+struct Accumulate {
+  void operator()(int64_t value) const { *sum += value * *scale + offset; }
+
+  int64_t* sum;
+  const int64_t* scale;
+  int64_t offset;
+};
+
+void BM_DirectCall(benchmark::State& state) {
+  int64_t sum = 0, scale = 3;
+  Accumulate closure{&sum, &scale, 1};
+  benchmark::DoNotOptimize(closure);
+  for (auto _ : state) closure(state.iterations());
+  benchmark::DoNotOptimize(sum);
+}
+BENCHMARK(BM_DirectCall);
+
+void BM_ArrayDelegateInvoke(benchmark::State& state) {
+  int64_t sum = 0, scale = 3;
+  arraydelegate<void(int64_t)> delegate{Accumulate{&sum, &scale, 1}};
+  benchmark::DoNotOptimize(delegate);
+  for (auto _ : state) delegate(state.iterations());
+  benchmark::DoNotOptimize(sum);
+}
+BENCHMARK(BM_ArrayDelegateInvoke);
+
+void BM_StdFunctionInvoke(benchmark::State& state) {
+  int64_t sum = 0, scale = 3;
+  std::function<void(int64_t)> function{Accumulate{&sum, &scale, 1}};
+  benchmark::DoNotOptimize(function);
+  for (auto _ : state) function(state.iterations());
+  benchmark::DoNotOptimize(sum);
+}
+BENCHMARK(BM_StdFunctionInvoke);
+
+// Construction from a closure, what adding a task costs before any queueing.
+void BM_ArrayDelegateConstruct(benchmark::State& state) {
+  int64_t sum = 0, scale = 3;
+  for (auto _ : state) {
+    arraydelegate<void(int64_t)> delegate{Accumulate{&sum, &scale, 1}};
+    benchmark::DoNotOptimize(delegate);
+  }
+}
+BENCHMARK(BM_ArrayDelegateConstruct);
+
+void BM_StdFunctionConstruct(benchmark::State& state) {
+  int64_t sum = 0, scale = 3;
+  for (auto _ : state) {
+    std::function<void(int64_t)> function{Accumulate{&sum, &scale, 1}};
+    benchmark::DoNotOptimize(function);
+  }
+}
+BENCHMARK(BM_StdFunctionConstruct);
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,407 @@
+#ifndef SPARKS_CORE_ATOMIC_ID_VECTOR_HPP_
+#define SPARKS_CORE_ATOMIC_ID_VECTOR_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <random>
+
+#include <glog/logging.h>
+
+#include "epoch.hpp"
+
+namespace sparks {
+
+template<typename Element_, typename IntId_, size_t INDEX_BITS>
+class BasicAtomicIdVector {
+ public:
+  static_assert(INDEX_BITS < sizeof(IntId_) * 8, "too many index bits");
+  static_assert(INDEX_BITS > 0, "zero index bits");
+
+  using Element = Element_;
+  using IntId = IntId_;
+
+  enum class Id : IntId_ {};
+
+ private:
+  static constexpr IntId INVALID {(1 << INDEX_BITS) - 1};
+
+ public:
+  static constexpr Id INVALID_ID {static_cast<Id>(INVALID)};
+  static constexpr IntId MAX_INDEX {INVALID - 1};
+  static constexpr IntId CAPACITY {MAX_INDEX + 1};
+
+  BasicAtomicIdVector() {
+    slots_ = new Slot[CAPACITY];
+    init_empty();
+  }
+
+  // Epoch mode: erase() and move_from() invalidate the id immediately, but
+  // destroying the element and reusing its slot are deferred until no reader
+  // pinned in `domain` can still be looking at it. Readers which hold a pin can
+  // then use find() without any further synchronization.
+  explicit BasicAtomicIdVector(EpochDomain& domain)
+      : epoch_domain_{&domain}, retired_epochs_{new Epoch[CAPACITY]} {
+    slots_ = new Slot[CAPACITY];
+    init_empty();
+  }
+
+  // Destruction must be synchronized: all method calls in all threads need to
+  // have finished before calling destructor.
+  ~BasicAtomicIdVector() {
+    destroy_elements();
+    delete[] slots_;
+    delete[] retired_epochs_;
+  }
+
+  // Non-copyable nor movable since it cannot be done lockfree.
+  BasicAtomicIdVector(const BasicAtomicIdVector&) = delete;
+  BasicAtomicIdVector(BasicAtomicIdVector&&) = delete;
+
+  BasicAtomicIdVector& operator=(const BasicAtomicIdVector&) = delete;
+  BasicAtomicIdVector& operator=(BasicAtomicIdVector&&) = delete;
+
+
+  // Clearing must be synchronized: all method calls in all threads need to
+  // have finished before calling clear().
+  void unsafe_clear() {
+    destroy_elements();
+    init_empty();
+  }
+
+  bool is_valid_id(Id id) const {
+    auto index = unpack_index(static_cast<IntId>(id));
+    if (index >= CAPACITY) return false;
+    return slots_[index].id.load() ==
+           static_cast<IntId>(id);
+  }
+
+  bool is_epoch_mode() const { return epoch_domain_ != nullptr; }
+
+  template<typename ...Args>
+  std::pair<Id, Element*> emplace(Args&& ...args) {
+    auto* slot = acquire_slot();
+    if (!slot && num_retired_.load() > 0) {
+      collect();
+      slot = acquire_slot();
+    }
+    if (slot) {
+      auto* new_element = reinterpret_cast<Element*>(slot->payload);
+      new (new_element) Element(std::forward<Args>(args)...);
+      return {static_cast<Id>(
+                  slot->id.load(std::memory_order::memory_order_acquire)),
+              new_element};
+    } else {
+      return {INVALID_ID, nullptr};
+    }
+  }
+
+  template<typename ...Args>
+  std::pair<Id, Element*> spin_emplace(Args&& ...args) {
+    Slot* slot;
+    while ((slot = acquire_slot()) == nullptr) collect();
+
+    auto* new_element = reinterpret_cast<Element*>(slot->payload);
+    new (new_element) Element(std::forward<Args>(args)...);
+    return {static_cast<Id>(slot->id.load()),
+            new_element};
+  }
+
+  const Element& operator[](Id id) const {
+    DCHECK(is_valid_id(id)) << static_cast<int>(id);
+    return element_at(unpack_index(static_cast<IntId>(id)));
+  }
+
+  Element& operator[](Id id) {
+    auto index = unpack_index(static_cast<IntId>(id));
+    DCHECK(is_valid_id(id))
+        << static_cast<int>(id) << " "
+        << (index < CAPACITY ? slots_[index].id.load() : 12345678);
+    return element_at(unpack_index(static_cast<IntId>(id)));
+  }
+
+  // Returns the element with the given id or nullptr if the id is stale. In
+  // epoch mode, the returned pointer stays valid (though the id may go stale)
+  // for as long as the calling thread keeps its EpochDomain::Pin.
+  const Element* find(Id id) const {
+    auto index = unpack_index(static_cast<IntId>(id));
+    if (index >= CAPACITY) return nullptr;
+    const auto& slot = slots_[index];
+    if (slot.id.load() != static_cast<IntId>(id)) return nullptr;
+    return reinterpret_cast<const Element*>(slot.payload);
+  }
+
+  Element* find(Id id) {
+    return const_cast<Element*>(
+        static_cast<const BasicAtomicIdVector&>(*this).find(id));
+  }
+
+  // In epoch mode the element is copied out (if it is copy-assignable) since
+  // pinned readers may still be looking at it.
+  bool move_from(Id id, Element& to) {
+    if (auto* slot = lock_slot(static_cast<IntId>(id))) {
+      auto* element = reinterpret_cast<Element*>(slot->payload);
+      if (epoch_domain_) {
+        extract_shared(*element, to);
+        retire_locked_slot(slot);
+      } else {
+        to = std::move(*element);
+        element->~Element();
+        release_locked_slot(slot);
+      }
+      return true;
+    }
+    return false;
+  }
+
+  // Idempotent.
+  void erase(Id id) {
+    if (auto* slot = lock_slot(static_cast<IntId>(id))) {
+      if (epoch_domain_) {
+        retire_locked_slot(slot);
+      } else {
+        reinterpret_cast<Element*>(slot->payload)->~Element();
+        release_locked_slot(slot);
+      }
+    }
+  }
+
+  // Epoch mode only: destroys the erased elements which no pinned reader can
+  // observe anymore and makes their slots available again. This is done
+  // periodically by erase() and when emplace() runs out of slots, but can also
+  // be called explicitly, e.g. once per frame.
+  void collect() {
+    if (!epoch_domain_) return;
+
+    // Take the whole retired list; concurrent collect() calls end up with
+    // disjoint lists.
+    IntId head_mirror = retired_head_.load(), new_head;
+    do {
+      if (unpack_index(head_mirror) == INVALID) return;
+      new_head = increment_tag_and_reset(head_mirror, INVALID);
+    } while (!retired_head_.compare_exchange_weak(head_mirror, new_head));
+
+    const auto min_pinned = epoch_domain_->min_pinned();
+    auto retired_index = unpack_index(head_mirror);
+    while (retired_index != INVALID) {
+      auto& slot = slots_[retired_index];
+      const auto retired_id = slot.id.load();
+      const auto next_index = unpack_index(retired_id);
+
+      // Point the slot back at itself, marking it as locked by us again.
+      slot.id.store(reset_index(retired_id, retired_index));
+      if (epoch_domain_->is_reclaimable(retired_epochs_[retired_index],
+                                        min_pinned)) {
+        reinterpret_cast<Element*>(slot.payload)->~Element();
+        release_locked_slot(&slot);
+        num_retired_.fetch_sub(1);
+      } else {
+        push_retired(&slot);
+      }
+      retired_index = next_index;
+    }
+  }
+
+ private:
+  using AtomicId = std::atomic<IntId>;
+  using Epoch = EpochDomain::Epoch;
+
+  struct Slot {
+    alignas(Element) char payload[sizeof(Element)];
+    AtomicId id;
+  };
+
+
+  static constexpr IntId INDEX_MASK = (1 << INDEX_BITS) - 1;
+  static constexpr IntId TAG_MASK = ~INDEX_MASK;
+  static constexpr IntId TAG_INCREMENTOR = 1 << INDEX_BITS;
+
+  // erase() in epoch mode tries to collect() every this many retirements.
+  static constexpr uint32_t COLLECT_PERIOD = 64;
+
+
+  static IntId unpack_index(IntId id) { return id & INDEX_MASK; }
+
+  static IntId reset_index(IntId id, IntId new_index) {
+    DCHECK_LE(new_index, INDEX_MASK);
+    return (id & TAG_MASK) | new_index;
+  }
+
+  static IntId increment_tag_and_reset(IntId id, IntId new_index) {
+    DCHECK_LE(new_index, INDEX_MASK);
+    return (((id & TAG_MASK) + TAG_INCREMENTOR) & TAG_MASK) | new_index;
+  }
+
+  static IntId increment_tag(IntId id) {
+    return increment_tag_and_reset(id, unpack_index(id));
+  }
+
+  Slot* lock_slot(IntId id) {
+    DCHECK_LT(unpack_index(id), INVALID);
+    auto& slot = slots_[unpack_index(id)];
+    const auto invalidated = increment_tag(id);
+    if (slot.id.compare_exchange_strong(id, invalidated)) {
+      DCHECK(is_acquired(unpack_index(id)));
+      return &slot;
+    }
+    return nullptr;  // Lost the race, another call invalidated the slot first.
+  }
+
+  bool is_acquired(IntId index) const {
+    DCHECK_LT(index, CAPACITY);
+    return unpack_index(slots_[index].id.load()) ==
+           index;
+  }
+
+  Slot& mark_acquired(IntId index) const {
+    DCHECK_LT(index, CAPACITY);
+    auto& slot = slots_[index];
+    slot.id.store(reset_index(slot.id.load(), index));
+    return slot;
+  }
+
+  Element& element_at(IntId index) const {
+    DCHECK(is_acquired(index));
+    return *reinterpret_cast<Element*>(slots_[index].payload);
+  }
+
+  Slot* acquire_slot() {
+    IntId head_mirror, head_index, new_head;
+    do {
+      head_mirror = free_head_.load();
+      head_index = unpack_index(head_mirror);
+      if (head_index == INVALID) return nullptr;  // No empty slots.
+
+      auto new_head_index = unpack_index(slots_[head_index].id);
+      new_head = increment_tag_and_reset(head_mirror, new_head_index);
+    } while (!free_head_.compare_exchange_weak(head_mirror, new_head));
+
+    return &mark_acquired(head_index);
+  }
+
+  void release_locked_slot(Slot* locked) {
+    IntId released_id = locked->id.load();
+    IntId released_index = unpack_index(released_id);
+    IntId head_mirror, new_head;
+    do {
+      head_mirror = free_head_.load();
+      new_head = increment_tag_and_reset(head_mirror, released_index);
+
+      locked->id.store(reset_index(released_id, unpack_index(head_mirror)));
+    } while (!free_head_.compare_exchange_weak(head_mirror, new_head));
+
+  }
+
+  // Epoch mode: records the epoch of the unlinking and pushes a locked slot
+  // onto the retired list. While retired, the index bits of a slot's id link
+  // to the next retired slot, so the slot is neither valid nor acquired.
+  void retire_locked_slot(Slot* locked) {
+    retired_epochs_[unpack_index(locked->id.load())] = epoch_domain_->retire();
+    push_retired(locked);
+    if ((num_retired_.fetch_add(1) + 1) % COLLECT_PERIOD == 0) collect();
+  }
+
+  void push_retired(Slot* locked) {
+    IntId locked_id = locked->id.load();
+    IntId locked_index = unpack_index(locked_id);
+    IntId head_mirror, new_head;
+    do {
+      head_mirror = retired_head_.load();
+      new_head = increment_tag_and_reset(head_mirror, locked_index);
+
+      locked->id.store(reset_index(locked_id, unpack_index(head_mirror)));
+    } while (!retired_head_.compare_exchange_weak(head_mirror, new_head));
+  }
+
+  template <typename E = Element>
+  static typename std::enable_if<std::is_copy_assignable<E>::value>::type
+  extract_shared(E& from, E& to) {
+    to = from;
+  }
+
+  template <typename E = Element>
+  static typename std::enable_if<!std::is_copy_assignable<E>::value>::type
+  extract_shared(E& from, E& to) {
+    LOG(FATAL) << "move_from() in epoch mode needs a copy-assignable element.";
+  }
+
+  // Destroys every retired element regardless of pinned readers.
+  void destroy_retired() {
+    auto retired_index = unpack_index(retired_head_.load());
+    while (retired_index != INVALID) {
+      auto& slot = slots_[retired_index];
+      retired_index = unpack_index(slot.id.load());
+      reinterpret_cast<Element*>(slot.payload)->~Element();
+    }
+    num_retired_.store(0);
+  }
+
+  void destroy_elements() {
+    destroy_retired();
+    for (IntId i_slot = 0; i_slot < CAPACITY; ++i_slot) {
+      if (is_acquired(i_slot)) element_at(i_slot).~Element();
+    }
+  }
+
+  void init_empty() {
+    // We generate initial tags randomly to make mixups of IDs from different
+    // IdVector-s less likely.
+    std::linear_congruential_engine<uint64_t, 2862933555777941757uL,
+                                    3037000493uL, static_cast<uint64_t>(-1)>
+        tag_generator(reinterpret_cast<uint64_t>(this));
+    auto tag = [&] { return static_cast<IntId>(tag_generator()) & TAG_MASK; };
+
+    free_head_.store(0);
+    retired_head_.store(INVALID);
+    for (IntId i_slot = 0; i_slot < CAPACITY - 1; ++i_slot) {
+      slots_[i_slot].id.store(i_slot + 1 | tag());
+    }
+    slots_[CAPACITY - 1].id.store(INVALID | tag());
+  }
+
+  Slot* slots_;
+  AtomicId free_head_ {INVALID};
+
+  // Epoch mode state, unused otherwise.
+  EpochDomain* epoch_domain_{nullptr};
+  Epoch* retired_epochs_{nullptr};
+  AtomicId retired_head_ {INVALID};
+  std::atomic<uint32_t> num_retired_{0};
+};
+
+template <typename E, typename I, size_t IB>
+constexpr typename BasicAtomicIdVector<E, I, IB>::IntId
+    BasicAtomicIdVector<E, I, IB>::INVALID;
+
+template <typename E, typename I, size_t IB>
+constexpr typename BasicAtomicIdVector<E, I, IB>::Id
+    BasicAtomicIdVector<E, I, IB>::INVALID_ID;
+
+template <typename E, typename I, size_t IB>
+constexpr typename BasicAtomicIdVector<E, I, IB>::IntId
+    BasicAtomicIdVector<E, I, IB>::MAX_INDEX;
+
+template <typename E, typename I, size_t IB>
+constexpr typename BasicAtomicIdVector<E, I, IB>::IntId
+    BasicAtomicIdVector<E, I, IB>::CAPACITY;
+
+template <typename E, typename I, size_t IB>
+constexpr typename BasicAtomicIdVector<E, I, IB>::IntId
+    BasicAtomicIdVector<E, I, IB>::INDEX_MASK;
+
+template <typename E, typename I, size_t IB>
+constexpr typename BasicAtomicIdVector<E, I, IB>::IntId
+    BasicAtomicIdVector<E, I, IB>::TAG_MASK;
+
+template <typename E, typename I, size_t IB>
+constexpr typename BasicAtomicIdVector<E, I, IB>::IntId
+    BasicAtomicIdVector<E, I, IB>::TAG_INCREMENTOR;
+
+template <typename E, typename I, size_t IB>
+constexpr uint32_t BasicAtomicIdVector<E, I, IB>::COLLECT_PERIOD;
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_ATOMIC_ID_VECTOR_HPP_
+
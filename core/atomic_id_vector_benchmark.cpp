@@ -0,0 +1,91 @@
+#include "atomic_id_vector.hpp"
+#include "epoch.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace sparks {
+namespace {
+
+struct Element {
+  explicit Element(int64_t x) : x{x} {}
+  int64_t x;
+};
+
+using AtomicIdVector = BasicAtomicIdVector<Element, uint32_t, 16>;
+using Id = AtomicIdVector::Id;
+
+// Emplaces a batch of state.range(0) elements, then erases them all.
+void BM_AtomicIdVectorEmplaceErase(benchmark::State& state) {
+  AtomicIdVector vector;
+  const auto batch = static_cast<size_t>(state.range(0));
+  std::vector<Id> ids(batch);
+  for (auto _ : state) {
+    for (size_t i = 0; i < batch; ++i) ids[i] = vector.emplace(i).first;
+    for (size_t i = 0; i < batch; ++i) vector.erase(ids[i]);
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_AtomicIdVectorEmplaceErase)->RangeMultiplier(8)->Range(8, 4096);
+
+// As above, but every thread works on the same vector.
+void BM_AtomicIdVectorEmplaceEraseContended(benchmark::State& state) {
+  static AtomicIdVector vector;
+  const size_t batch = 64;
+  std::vector<Id> ids(batch);
+  for (auto _ : state) {
+    for (size_t i = 0; i < batch; ++i) ids[i] = vector.spin_emplace(i).first;
+    for (size_t i = 0; i < batch; ++i) vector.erase(ids[i]);
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_AtomicIdVectorEmplaceEraseContended)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// Random-ish lookups of live ids.
+void BM_AtomicIdVectorLookup(benchmark::State& state) {
+  AtomicIdVector vector;
+  const size_t count = static_cast<size_t>(state.range(0));
+  std::vector<Id> ids(count);
+  for (size_t i = 0; i < count; ++i) ids[i] = vector.emplace(i).first;
+
+  int64_t sum = 0;
+  size_t i_id = 0;
+  for (auto _ : state) {
+    sum += vector[ids[i_id]].x;
+    i_id = (i_id + 7919) % count;
+  }
+  benchmark::DoNotOptimize(sum);
+  for (auto id : ids) vector.erase(id);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AtomicIdVectorLookup)->RangeMultiplier(8)->Range(64, 32768);
+
+// Pinned find() in epoch mode, the read path readers are expected to use.
+void BM_AtomicIdVectorEpochFind(benchmark::State& state) {
+  EpochDomain domain;
+  EpochDomain::Reader reader{domain};
+  AtomicIdVector vector{domain};
+  const size_t count = 4096;
+  std::vector<Id> ids(count);
+  for (size_t i = 0; i < count; ++i) ids[i] = vector.emplace(i).first;
+
+  int64_t sum = 0;
+  size_t i_id = 0;
+  for (auto _ : state) {
+    auto pin = reader.pin();
+    const Element* element = vector.find(ids[i_id]);
+    if (element) sum += element->x;
+    i_id = (i_id + 7919) % count;
+  }
+  benchmark::DoNotOptimize(sum);
+  for (auto id : ids) vector.erase(id);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AtomicIdVectorEpochFind);
+
+}  // namespace
+}  // namespace sparks
@@ -1,4 +1,4 @@
-#include "id_vector.hpp"
+#include "atomic_id_vector.hpp"
 
 #include <atomic>
 #include <memory>
@@ -54,9 +54,9 @@ struct Element {
 std::atomic<int> Element::global_count{0};
 std::atomic<bool> Element::suppress_diff_destroyer{false};
 
-struct IdVectorTest : public ::testing::Test {
-  using SmallVector = BasicIdVector<Element, uint8_t, 3>;
-  using BigVector = BasicIdVector<Element, uint32_t, 12>;
+struct AtomicIdVectorTest : public ::testing::Test {
+  using SmallVector = BasicAtomicIdVector<Element, uint8_t, 3>;
+  using BigVector = BasicAtomicIdVector<Element, uint32_t, 12>;
 
   static_assert(SmallVector::CAPACITY == 7, "");
   static_assert(BigVector::CAPACITY == 4095, "");
@@ -67,7 +67,7 @@ struct IdVectorTest : public ::testing::Test {
   SmallVector& small;
   BigVector& big;
 
-  IdVectorTest() : small{*small_ptr}, big{*big_ptr} {}
+  AtomicIdVectorTest() : small{*small_ptr}, big{*big_ptr} {}
 
   void TearDown() {
     small_ptr.reset();
@@ -76,7 +76,7 @@ struct IdVectorTest : public ::testing::Test {
   }
 };
 
-TEST_F(IdVectorTest, SingleThreadedAutoDestruction) {
+TEST_F(AtomicIdVectorTest, SingleThreadedAutoDestruction) {
   for (int i = 0; i < 5; ++i) {
     ASSERT_TRUE(small.emplace().second != nullptr);
   }
@@ -84,7 +84,7 @@ TEST_F(IdVectorTest, SingleThreadedAutoDestruction) {
   // TearDown() checks that elems are destructed correctly.
 }
 
-TEST_F(IdVectorTest, SingleThreadedAddAndRemove) {
+TEST_F(AtomicIdVectorTest, SingleThreadedAddAndRemove) {
   SmallVector::Id ids[7];
   for (int i = 0; i < 7; ++i) {
     auto emplacement = small.emplace();
@@ -115,7 +115,7 @@ TEST_F(IdVectorTest, SingleThreadedAddAndRemove) {
   }
 }
 
-TEST_F(IdVectorTest, LongManyThreadsAddAndRemoveTakes15) {
+TEST_F(AtomicIdVectorTest, LongManyThreadsAddAndRemoveTakes15) {
   constexpr size_t MAX_IDS = 4095;
   constexpr size_t MAX_ITER = 8192;
   constexpr size_t NUM_THREADS[] = { 1, 2, 3, 4, 6, 9, 13, 24, 32 };
@@ -207,5 +207,106 @@ TEST_F(IdVectorTest, LongManyThreadsAddAndRemoveTakes15) {
   }
 }
 
+TEST_F(AtomicIdVectorTest, EpochModeDefersDestructionWhilePinned) {
+  Element::suppress_diff_destroyer.store(true);
+  EpochDomain domain;
+  SmallVector epoch_small{domain};
+  EpochDomain::Reader reader{domain};
+  ASSERT_TRUE(epoch_small.is_epoch_mode());
+
+  SmallVector::Id ids[7];
+  for (int i = 0; i < 7; ++i) ids[i] = epoch_small.emplace(10 + i).first;
+
+  {
+    auto pin = reader.pin();
+    const Element* element = epoch_small.find(ids[3]);
+    ASSERT_TRUE(element != nullptr);
+
+    epoch_small.erase(ids[3]);
+    EXPECT_FALSE(epoch_small.is_valid_id(ids[3]));
+    EXPECT_TRUE(epoch_small.find(ids[3]) == nullptr);
+
+    // The slot cannot be reused while the reader is pinned.
+    EXPECT_TRUE(epoch_small.emplace(0).second == nullptr);
+    epoch_small.collect();
+    EXPECT_EQ(7, Element::count());
+    element->expect(13);
+  }
+
+  // Once unpinned, emplace() collects the retired slot by itself.
+  auto emplacement = epoch_small.emplace(1, 2);
+  ASSERT_TRUE(emplacement.second != nullptr);
+  EXPECT_EQ(7, Element::count());
+  EXPECT_EQ(3, epoch_small[emplacement.first].value());
+
+  // Retired but uncollected elements are destroyed with the vector.
+  epoch_small.erase(ids[0]);
+  EXPECT_EQ(7, Element::count());
+  epoch_small.unsafe_clear();
+  EXPECT_EQ(0, Element::count());
+  Element::suppress_diff_destroyer.store(false);
+}
+
+TEST_F(AtomicIdVectorTest, LongEpochModePinnedReadersNeverSeeDestroyedElements) {
+  constexpr size_t NUM_KEYS = 256;
+  constexpr size_t NUM_WRITERS = 2;
+  constexpr size_t NUM_READERS = 4;
+  constexpr size_t NUM_WRITER_ITERS = 1 << 16;
+
+  Element::suppress_diff_destroyer.store(true);
+  EpochDomain domain;
+  std::unique_ptr<BigVector> epoch_big{new BigVector{domain}};
+
+  std::vector<std::atomic<uint32_t>> published(NUM_KEYS);
+  for (size_t i_key = 0; i_key < NUM_KEYS; ++i_key) {
+    published[i_key].store(static_cast<uint32_t>(
+        epoch_big->emplace(static_cast<int>(i_key)).first));
+  }
+
+  std::atomic<size_t> writers_left{NUM_WRITERS};
+  std::vector<std::thread> threads;
+  for (size_t i_writer = 0; i_writer < NUM_WRITERS; ++i_writer) {
+    threads.emplace_back([&, i_writer] {
+      std::minstd_rand0 gen{static_cast<uint32_t>(i_writer + 1)};
+      for (size_t i_iter = 0; i_iter < NUM_WRITER_ITERS; ++i_iter) {
+        // Writers own disjoint sets of keys.
+        size_t key = (gen() % (NUM_KEYS / NUM_WRITERS)) * NUM_WRITERS + i_writer;
+        auto new_id = epoch_big->spin_emplace(static_cast<int>(key)).first;
+        auto old_id = published[key].exchange(static_cast<uint32_t>(new_id));
+        epoch_big->erase(static_cast<BigVector::Id>(old_id));
+      }
+      writers_left.fetch_sub(1);
+    });
+  }
+
+  std::atomic<uint64_t> num_hits{0};
+  for (size_t i_reader = 0; i_reader < NUM_READERS; ++i_reader) {
+    threads.emplace_back([&, i_reader] {
+      EpochDomain::Reader reader{domain};
+      std::minstd_rand0 gen{static_cast<uint32_t>(i_reader + 100)};
+      uint64_t hits = 0;
+      while (writers_left.load() > 0) {
+        auto pin = reader.pin();
+        size_t key = gen() % NUM_KEYS;
+        auto id = static_cast<BigVector::Id>(published[key].load());
+        if (const Element* element = epoch_big->find(id)) {
+          for (int i = 0; i < 16; ++i) element->expect(static_cast<int>(key));
+          ++hits;
+        }
+      }
+      num_hits.fetch_add(hits);
+    });
+  }
+
+  for (auto& thread : threads) thread.join();
+  VLOG(1) << "Pinned hits: " << num_hits.load();
+
+  epoch_big->collect();
+  EXPECT_EQ(NUM_KEYS, Element::count());
+  epoch_big.reset();
+  EXPECT_EQ(0, Element::count());
+  Element::suppress_diff_destroyer.store(false);
+}
+
 }  // namespace
 }  // namespace sparks
@@ -0,0 +1,28 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <glog/logging.h>
+
+int main(int argc, char **argv) {
+  google::InitGoogleLogging(argv[0]);
+  google::LogToStderr();
+
+  // Default to JSON on stdout so results can be diffed and plotted; passing
+  // --benchmark_format explicitly overrides it.
+  std::vector<char*> args{argv, argv + argc};
+  std::string json_format{"--benchmark_format=json"};
+  bool has_format = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], "--benchmark_format", 18) == 0) has_format = true;
+  }
+  if (!has_format) args.insert(args.begin() + 1, &json_format[0]);
+
+  int num_args = static_cast<int>(args.size());
+  benchmark::Initialize(&num_args, args.data());
+  if (benchmark::ReportUnrecognizedArguments(num_args, args.data())) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -2,14 +2,19 @@
 #define SPARKS_CORE_BLOCKING_COUNTER_HPP_
 
 #include <atomic>
-#include <condition_variable>
 #include <cstdint>
-#include <mutex>
+#include <utility>
 
 #include <glog/logging.h>
 
+#include "futex.hpp"
+
 namespace sparks {
 
+// A counter which wait_and_disable() waits on to reach zero. The count and a
+// 'waiter parked' flag share one atomic word: increment() and decrement() are
+// a single atomic operation and only the decrement() which reaches zero while
+// someone is parked makes a futex call.
 class BlockingCounter {
  public:
   class Item;
@@ -52,35 +57,42 @@ class BlockingCounter {
 
   void wait_and_disable() {
     if (alive_.exchange(false)) {
-      std::unique_lock<std::mutex> lock{count_mutex_};
-      --count_;
-      while (count_ > 0) zero_count_.wait(lock);
+      decrement();
+
+      auto state = state_.load();
+      while ((state & COUNT_MASK) > 0) {
+        if (!(state & WAITING) &&
+            !state_.compare_exchange_weak(state, state | WAITING)) {
+          continue;
+        }
+        futex_wait(state_, state | WAITING);
+        state = state_.load();
+      }
     }
   }
 
   void increment(uint32_t by = 1) {
-    count_ += by;
+    state_.fetch_add(by, std::memory_order_relaxed);
   }
 
   void decrement(uint32_t by = 1) {
-    std::unique_lock<std::mutex> lock{count_mutex_};
-    if (by >= count_) {
-      count_ = 0;
-      lock.unlock();
-      zero_count_.notify_all();
-    } else {
-      count_ -= by;
+    const auto old_state = state_.fetch_sub(by);
+    DCHECK_GE(old_state & COUNT_MASK, by) << "BlockingCounter underflow.";
+    if ((old_state & COUNT_MASK) == by && (old_state & WAITING)) {
+      futex_wake_all(state_);
     }
   }
 
-  uint32_t count() const { return count_; }
+  uint32_t count() const { return state_.load() & COUNT_MASK; }
 
  private:
+  static const uint32_t WAITING = 1u << 31;
+  static const uint32_t COUNT_MASK = WAITING - 1;
 
   std::atomic<bool> alive_{true};
-  uint32_t count_{1};
-  std::mutex count_mutex_;
-  std::condition_variable zero_count_;
+
+  // The count starts at one, the reference released by wait_and_disable().
+  std::atomic<uint32_t> state_{1};
 };
 
 }  // namespace sparks
@@ -0,0 +1,116 @@
+#include "blocking_counter.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+void sleep_ms(int milliseconds) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+// The count includes the reference which wait_and_disable() releases. Copies
+// of an Item count again, moves and swaps hand over the same count.
+TEST(BlockingCounterTest, ItemsCount) {
+  BlockingCounter counter;
+  EXPECT_EQ(1u, counter.count());
+  {
+    BlockingCounter::Item item{counter};
+    EXPECT_EQ(2u, counter.count());
+
+    BlockingCounter::Item copy{item};
+    EXPECT_EQ(3u, counter.count());
+
+    BlockingCounter::Item moved{std::move(copy)};
+    EXPECT_EQ(3u, counter.count());
+
+    // Assigning releases the target's count.
+    BlockingCounter::Item assigned{counter};
+    EXPECT_EQ(4u, counter.count());
+    assigned = item;
+    EXPECT_EQ(4u, counter.count());
+    assigned = std::move(moved);
+    EXPECT_EQ(3u, counter.count());
+
+    item.swap(assigned);
+    item.release();
+    EXPECT_EQ(2u, counter.count());
+    item.release();
+    EXPECT_EQ(2u, counter.count());
+  }
+  EXPECT_EQ(1u, counter.count());
+
+  counter.wait_and_disable();
+  EXPECT_EQ(0u, counter.count());
+  counter.wait_and_disable();
+  EXPECT_EQ(0u, counter.count());
+}
+
+// wait_and_disable() returns only once Items released by other threads, at
+// random times and some of them copied, are all gone.
+TEST(BlockingCounterTest, WaitsForItemsReleasedOnOtherThreads) {
+  const int NUM_THREADS = 4;
+  std::mt19937 random{5};
+  for (int round = 0; round < 200; ++round) {
+    BlockingCounter counter;
+    std::atomic<int> num_released{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < NUM_THREADS; ++i) {
+      const int spins = random() % 1000;
+      threads.emplace_back(
+          [&num_released, spins](BlockingCounter::Item item) {
+            BlockingCounter::Item copy{item};
+            item.release();
+            for (int spin = 0; spin < spins; ++spin) {
+              std::this_thread::yield();
+            }
+            ++num_released;
+          },
+          BlockingCounter::Item{counter});
+    }
+
+    counter.wait_and_disable();
+    EXPECT_EQ(NUM_THREADS, num_released.load()) << round;
+    EXPECT_EQ(0u, counter.count());
+    for (auto& thread : threads) thread.join();
+  }
+}
+
+// A waiter which found Items left parks on the futex. The waiting flag it
+// sets is not part of count(), and only the decrement which reaches zero
+// wakes it.
+TEST(BlockingCounterTest, ParkedWaiterIsWokenAtZero) {
+  BlockingCounter counter;
+  BlockingCounter::Item first{counter};
+  BlockingCounter::Item second{counter};
+  std::atomic<bool> returned{false};
+  std::thread waiter{[&counter, &returned] {
+    counter.wait_and_disable();
+    returned = true;
+  }};
+
+  // Long enough for the waiter to park.
+  sleep_ms(20);
+  EXPECT_FALSE(returned.load());
+  EXPECT_EQ(2u, counter.count());
+
+  first.release();
+  sleep_ms(20);
+  EXPECT_FALSE(returned.load());
+  EXPECT_EQ(1u, counter.count());
+
+  second.release();
+  waiter.join();
+  EXPECT_TRUE(returned.load());
+  EXPECT_EQ(0u, counter.count());
+}
+
+}  // namespace
+}  // namespace sparks
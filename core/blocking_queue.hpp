@@ -0,0 +1,166 @@
+#ifndef SPARKS_CORE_BLOCKING_QUEUE_HPP_
+#define SPARKS_CORE_BLOCKING_QUEUE_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+#include "cache_line.hpp"
+#include "futex.hpp"
+
+namespace sparks {
+
+// Makes a SpscQueue or MpmcQueue block instead of failing: push() waits while
+// the queue is full and pull() while it is empty, spinning briefly before
+// parking on a futex. Each side counts its parked threads, so that the other
+// only makes a futex call when someone is actually asleep. The usage rules of
+// Queue (e.g. a single producer) still apply.
+//
+// close() makes further pushes fail and wakes everyone; pulls keep draining
+// the queue and fail once it is empty, e.g. to stop a consumer thread.
+template <class Queue_>
+class BlockingQueue {
+ public:
+  using Queue = Queue_;
+  using Element = typename Queue::Element;
+  using Size = typename Queue::Size;
+
+  static const uint32_t SPIN_COUNT{64};
+
+  BlockingQueue() = default;
+
+  BlockingQueue(const BlockingQueue&) = delete;
+  BlockingQueue(BlockingQueue&&) = delete;
+
+  BlockingQueue& operator=(const BlockingQueue&) = delete;
+  BlockingQueue& operator=(BlockingQueue&&) = delete;
+
+  bool empty() const { return queue_.empty(); }
+  Size size() const { return queue_.size(); }
+
+  bool try_push(Element new_value) {
+    if (!queue_.push(new_value)) return false;
+    not_empty_.notify();
+    return true;
+  }
+
+  bool try_pull(Element& to) {
+    if (!queue_.pull(to)) return false;
+    not_full_.notify();
+    return true;
+  }
+
+  // Blocks while the queue is full. Returns false, without pushing, once
+  // closed.
+  bool push(Element new_value) {
+    if (closed_.load()) return false;
+    const bool pushed = not_full_.wait(
+        closed_, [this, new_value] { return queue_.push(new_value); });
+    if (pushed) not_empty_.notify();
+    return pushed;
+  }
+
+  // Blocks until all of [first, first + count) are pushed, in batches of
+  // whatever fits. Returns how many were, fewer only if closed.
+  Size push_batch(const Element* first, Size count) {
+    Size num_pushed = 0;
+    while (num_pushed < count && !closed_.load()) {
+      Size batch = 0;
+      const bool pushed =
+          not_full_.wait(closed_, [this, &batch, first, num_pushed, count] {
+            batch = queue_.push_batch(first + num_pushed, count - num_pushed);
+            return batch > 0;
+          });
+      if (!pushed) break;
+      num_pushed += batch;
+      not_empty_.notify();
+    }
+    return num_pushed;
+  }
+
+  // Blocks while the queue is empty. Returns false once it is closed and
+  // drained.
+  bool pull(Element& to) {
+    const bool pulled =
+        not_empty_.wait(closed_, [this, &to] { return queue_.pull(to); }) ||
+        queue_.pull(to);
+    if (pulled) not_full_.notify();
+    return pulled;
+  }
+
+  // Blocks until at least one element is available, then pulls up to
+  // max_count. Returns how many it did; zero once closed and drained.
+  Size pull_batch(Element* to, Size max_count) {
+    Size num_pulled = 0;
+    const auto pull_some = [this, &num_pulled, to, max_count] {
+      return (num_pulled = queue_.pull_batch(to, max_count)) > 0;
+    };
+    if (not_empty_.wait(closed_, pull_some) || pull_some()) {
+      not_full_.notify();
+    }
+    return num_pulled;
+  }
+
+  void close() {
+    closed_.store(true);
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+  bool is_closed() const { return closed_.load(); }
+
+ private:
+  // What one side waits for: the other side bumps epoch_ and wakes it, but
+  // only if waiters_ says someone may be parked.
+  class alignas(CACHE_LINE_SIZE) Event {
+   public:
+    // Calls try_once() until it returns true, then returns true, or until
+    // closed, then returns false.
+    template <typename TryOnce>
+    bool wait(const std::atomic<bool>& closed, TryOnce&& try_once) {
+      for (uint32_t i_spin = 0; i_spin < SPIN_COUNT; ++i_spin) {
+        if (try_once()) return true;
+      }
+
+      while (true) {
+        const auto epoch = epoch_.load();
+        waiters_.fetch_add(1);
+        // Orders the waiter count before the retry, against notify()'s fence
+        // ordering the queue operation before reading the count.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (try_once()) {
+          waiters_.fetch_sub(1);
+          return true;
+        }
+        if (closed.load()) {
+          waiters_.fetch_sub(1);
+          return false;
+        }
+        futex_wait(epoch_, epoch);
+        waiters_.fetch_sub(1);
+      }
+    }
+
+    void notify() {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (waiters_.load(std::memory_order_relaxed) > 0) notify_all();
+    }
+
+    void notify_all() {
+      epoch_.fetch_add(1);
+      futex_wake_all(epoch_);
+    }
+
+   private:
+    std::atomic<uint32_t> epoch_{0};
+    std::atomic<uint32_t> waiters_{0};
+  };
+
+  Queue queue_;
+  Event not_empty_;
+  Event not_full_;
+  std::atomic<bool> closed_{false};
+};
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_BLOCKING_QUEUE_HPP_
@@ -0,0 +1,144 @@
+#include "blocking_queue.hpp"
+#include "mpmc_queue.hpp"
+#include "spsc_queue.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+using Element = uint32_t;
+using BlockingSpscQueue = BlockingQueue<SpscQueue<Element, 2>>;
+using BlockingMpmcQueue = BlockingQueue<MpmcQueue<Element, 2>>;
+
+TEST(BlockingQueueTest, TryOperationsDoNotBlock) {
+  BlockingSpscQueue queue;
+  Element to;
+  EXPECT_FALSE(queue.try_pull(to));
+  for (Element i = 0; i < 4; ++i) EXPECT_TRUE(queue.try_push(i));
+  EXPECT_FALSE(queue.try_push(4));
+  EXPECT_TRUE(queue.try_pull(to));
+  EXPECT_EQ(0, to);
+}
+
+// With a four element queue, the producer keeps blocking on a full queue and
+// the consumer on an empty one; every value must still arrive, in order.
+TEST(BlockingQueueTest, SpscPingPong) {
+  const Element NUM_VALUES = 1 << 16;
+  BlockingSpscQueue queue;
+
+  std::thread producer{[&queue, NUM_VALUES] {
+    Element batch[3];
+    for (Element next = 0; next < NUM_VALUES;) {
+      if (next % 2 == 0 || next + 3 > NUM_VALUES) {
+        EXPECT_TRUE(queue.push(next++));
+      } else {
+        for (Element i = 0; i < 3; ++i) batch[i] = next + i;
+        EXPECT_EQ(3, queue.push_batch(batch, 3));
+        next += 3;
+      }
+    }
+  }};
+
+  Element batch[3];
+  bool in_order = true;
+  for (Element expected = 0; expected < NUM_VALUES;) {
+    if (expected % 3 == 0) {
+      Element to;
+      ASSERT_TRUE(queue.pull(to));
+      in_order &= to == expected++;
+    } else {
+      const Element num_pulled = queue.pull_batch(batch, 3);
+      ASSERT_GT(num_pulled, 0);
+      for (Element i = 0; i < num_pulled; ++i) {
+        in_order &= batch[i] == expected++;
+      }
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(in_order);
+}
+
+TEST(BlockingQueueTest, CloseWakesWaitersAndDrains) {
+  BlockingMpmcQueue queue;
+  const int NUM_CONSUMERS = 4;
+  std::atomic<int> num_pulled{0};
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < NUM_CONSUMERS; ++i) {
+    consumers.emplace_back([&queue, &num_pulled] {
+      Element to;
+      while (queue.pull(to)) num_pulled.fetch_add(1);
+    });
+  }
+
+  EXPECT_TRUE(queue.push(1));
+  EXPECT_TRUE(queue.push(2));
+  queue.close();
+  for (auto& consumer : consumers) consumer.join();
+
+  EXPECT_EQ(2, num_pulled.load());
+  EXPECT_TRUE(queue.is_closed());
+  EXPECT_FALSE(queue.push(3));
+  Element to;
+  EXPECT_FALSE(queue.pull(to));
+}
+
+TEST(BlockingQueueTest, CloseWakesBlockedProducer) {
+  BlockingMpmcQueue queue;
+  for (Element i = 0; i < 4; ++i) EXPECT_TRUE(queue.push(i));
+
+  std::atomic<bool> pushed{true};
+  std::thread producer{[&queue, &pushed] { pushed.store(queue.push(4)); }};
+  queue.close();
+  producer.join();
+  EXPECT_FALSE(pushed.load());
+
+  // What was pushed before closing can still be pulled.
+  Element to[4];
+  EXPECT_EQ(4, queue.pull_batch(to, 4));
+  EXPECT_EQ(0, queue.pull_batch(to, 4));
+}
+
+TEST(BlockingQueueTest, MpmcManyThreads) {
+  const int NUM_PRODUCERS = 4;
+  const int NUM_CONSUMERS = 3;
+  const Element VALUES_PER_PRODUCER = 1 << 14;
+  BlockingMpmcQueue queue;
+  std::atomic<uint64_t> sum{0};
+  std::atomic<uint32_t> num_pulled{0};
+
+  std::vector<std::thread> producers, consumers;
+  for (int i = 0; i < NUM_CONSUMERS; ++i) {
+    consumers.emplace_back([&queue, &sum, &num_pulled] {
+      Element batch[2];
+      Element num_batch;
+      while ((num_batch = queue.pull_batch(batch, 2)) > 0) {
+        for (Element i = 0; i < num_batch; ++i) sum.fetch_add(batch[i]);
+        num_pulled.fetch_add(num_batch);
+      }
+    });
+  }
+  for (int i = 0; i < NUM_PRODUCERS; ++i) {
+    producers.emplace_back([&queue, VALUES_PER_PRODUCER] {
+      for (Element value = 1; value <= VALUES_PER_PRODUCER; ++value) {
+        EXPECT_TRUE(queue.push(value));
+      }
+    });
+  }
+  for (auto& producer : producers) producer.join();
+  queue.close();
+  for (auto& consumer : consumers) consumer.join();
+
+  const uint64_t per_producer =
+      uint64_t{VALUES_PER_PRODUCER} * (VALUES_PER_PRODUCER + 1) / 2;
+  EXPECT_EQ(NUM_PRODUCERS * VALUES_PER_PRODUCER, num_pulled.load());
+  EXPECT_EQ(NUM_PRODUCERS * per_producer, sum.load());
+}
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,26 @@
+#ifndef SPARKS_CORE_CACHE_LINE_HPP_
+#define SPARKS_CORE_CACHE_LINE_HPP_
+
+#include <cstddef>
+
+// Building with -DSPARKS_CACHE_LINE_SIZE=8 packs the padded structures as
+// tightly as their members allow, to measure what the padding is worth (see
+// the false_sharing_benchmark targets).
+#ifndef SPARKS_CACHE_LINE_SIZE
+#define SPARKS_CACHE_LINE_SIZE 64
+#endif
+
+namespace sparks {
+
+// The distance which keeps data written by different threads from sharing a
+// cache line, i.e. C++17's std::hardware_destructive_interference_size. Data
+// owned by one thread but written by others is aligned to it, as are objects
+// of which each thread owns one in an array.
+constexpr size_t CACHE_LINE_SIZE = SPARKS_CACHE_LINE_SIZE;
+
+static_assert((CACHE_LINE_SIZE & (CACHE_LINE_SIZE - 1)) == 0,
+              "cache line size must be a power of two");
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_CACHE_LINE_HPP_
@@ -0,0 +1,60 @@
+#ifndef SPARKS_CORE_CLOCK_HPP_
+#define SPARKS_CORE_CLOCK_HPP_
+
+#include <chrono>
+#include <cstdint>
+
+namespace sparks {
+
+// Monotonic, high-resolution clock used for all the runtime's timing. It
+// counts integer ticks like SDL_GetPerformanceCounter() did, but needs no
+// windowing library, so the runtime can run headless.
+class Clock {
+ public:
+  using Ticks = uint64_t;
+
+  // Ticks are nanoseconds, whatever the resolution of the underlying clock.
+  static const Ticks TICKS_PER_SECOND = 1000000000;
+
+  static Ticks now() {
+    return static_cast<Ticks>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Source::now().time_since_epoch()).count());
+  }
+
+  static double to_seconds(Ticks ticks) {
+    return static_cast<double>(ticks) / TICKS_PER_SECOND;
+  }
+
+  static double to_milliseconds(Ticks ticks) {
+    return static_cast<double>(ticks) * 1e3 / TICKS_PER_SECOND;
+  }
+
+ private:
+  // steady_clock is the only standard clock guaranteed never to go backwards;
+  // high_resolution_clock may be an alias of the (adjustable) system_clock.
+  using Source = std::chrono::steady_clock;
+};
+
+// Measures the time elapsed since its construction or last reset().
+class Stopwatch {
+ public:
+  using Ticks = Clock::Ticks;
+
+  Stopwatch() : start_{Clock::now()} {}
+
+  void reset() { start_ = Clock::now(); }
+
+  Ticks elapsed_ticks() const { return Clock::now() - start_; }
+  double elapsed_seconds() const { return Clock::to_seconds(elapsed_ticks()); }
+  double elapsed_milliseconds() const {
+    return Clock::to_milliseconds(elapsed_ticks());
+  }
+
+ private:
+  Ticks start_;
+};
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_CLOCK_HPP_
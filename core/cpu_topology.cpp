@@ -0,0 +1,244 @@
+#include "cpu_topology.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include <tuple>
+
+#include <glog/logging.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace sparks {
+
+namespace {
+
+const int MAX_NUMA_NODES = 1024;
+const int BITS_PER_WORD = 8 * sizeof(unsigned long);
+
+bool read_line(const std::string& path, std::string& line) {
+  std::ifstream file{path};
+  return static_cast<bool>(std::getline(file, line));
+}
+
+bool read_int(const std::string& path, int& value) {
+  std::string line;
+  if (!read_line(path, line) || line.empty()) return false;
+  value = std::atoi(line.c_str());
+  return true;
+}
+
+bool read_cpu_list(const std::string& path, std::vector<int>& cpus) {
+  std::string line;
+  if (!read_line(path, line)) return false;
+  cpus = parse_cpu_list(line);
+  return !cpus.empty();
+}
+
+#ifdef __linux__
+long set_mempolicy(int mode, const unsigned long* nodemask,
+                   unsigned long maxnode) {
+  return syscall(SYS_set_mempolicy, mode, nodemask, maxnode);
+}
+#endif
+
+}  // namespace
+
+std::vector<int> parse_cpu_list(const std::string& list) {
+  std::vector<int> cpus;
+  size_t begin = 0;
+  while (begin < list.size()) {
+    size_t end = list.find(',', begin);
+    if (end == std::string::npos) end = list.size();
+    const std::string range = list.substr(begin, end - begin);
+    const size_t dash = range.find('-');
+    if (!range.empty()) {
+      const int first = std::atoi(range.c_str());
+      const int last = dash == std::string::npos
+                           ? first
+                           : std::atoi(range.c_str() + dash + 1);
+      for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    begin = end + 1;
+  }
+  return cpus;
+}
+
+CpuTopology CpuTopology::detect(const std::string& sysfs_root) {
+  const std::string cpu_root = sysfs_root + "/devices/system/cpu/";
+  CpuTopology topology;
+
+  std::vector<int> online;
+  if (!read_cpu_list(cpu_root + "online", online)) {
+    const int num_cpus =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    for (int cpu = 0; cpu < num_cpus; ++cpu) online.push_back(cpu);
+  }
+
+  for (int id : online) {
+    const std::string prefix = cpu_root + "cpu" + std::to_string(id) + "/";
+    Cpu cpu{id, id, 0, 0, 0};
+
+    std::vector<int> siblings;
+    if (read_cpu_list(prefix + "topology/thread_siblings_list", siblings)) {
+      cpu.core = siblings.front();
+      cpu.smt_rank = static_cast<int>(
+          std::find(siblings.begin(), siblings.end(), id) - siblings.begin());
+    }
+
+    for (int i_cache = 0;; ++i_cache) {
+      const std::string cache =
+          prefix + "cache/index" + std::to_string(i_cache) + "/";
+      int level;
+      if (!read_int(cache + "level", level)) break;
+      std::vector<int> shared;
+      if (level == 3 && read_cpu_list(cache + "shared_cpu_list", shared)) {
+        cpu.l3_group = shared.front();
+      }
+    }
+
+    topology.cpus_.push_back(cpu);
+  }
+
+#ifdef __linux__
+  const std::string node_root = sysfs_root + "/devices/system/node/";
+  if (DIR* nodes = opendir(node_root.c_str())) {
+    while (dirent* entry = readdir(nodes)) {
+      const std::string name = entry->d_name;
+      if (name.compare(0, 4, "node") != 0 || name.size() == 4) continue;
+      const int node = std::atoi(name.c_str() + 4);
+      std::vector<int> node_cpus;
+      if (!read_cpu_list(node_root + name + "/cpulist", node_cpus)) continue;
+      for (auto& cpu : topology.cpus_) {
+        if (std::find(node_cpus.begin(), node_cpus.end(), cpu.id) !=
+            node_cpus.end()) {
+          cpu.numa_node = node;
+        }
+      }
+    }
+    closedir(nodes);
+  }
+#endif
+
+  VLOG(1) << "Detected " << topology.num_cpus() << " CPUs, "
+          << topology.num_cores() << " cores, " << topology.num_numa_nodes()
+          << " NUMA nodes.";
+  return topology;
+}
+
+size_t CpuTopology::num_cores() const {
+  size_t count = 0;
+  for (const auto& cpu : cpus_) count += cpu.smt_rank == 0;
+  return count;
+}
+
+size_t CpuTopology::num_numa_nodes() const {
+  std::vector<int> nodes;
+  for (const auto& cpu : cpus_) nodes.push_back(cpu.numa_node);
+  std::sort(nodes.begin(), nodes.end());
+  return std::unique(nodes.begin(), nodes.end()) - nodes.begin();
+}
+
+std::vector<WorkerPlacement> CpuTopology::place_workers(
+    size_t num_workers) const {
+  std::vector<Cpu> order{cpus_};
+  std::sort(order.begin(), order.end(), [](const Cpu& a, const Cpu& b) {
+    return std::make_tuple(a.smt_rank, a.numa_node, a.l3_group, a.core, a.id) <
+           std::make_tuple(b.smt_rank, b.numa_node, b.l3_group, b.core, b.id);
+  });
+
+  std::vector<WorkerPlacement> placement;
+  placement.reserve(num_workers);
+  for (size_t i_worker = 0; i_worker < num_workers && !order.empty();
+       ++i_worker) {
+    const Cpu& cpu = order[i_worker % order.size()];
+    placement.push_back({cpu.id, cpu.core, cpu.l3_group, cpu.numa_node});
+  }
+  return placement;
+}
+
+bool apply_placement(const WorkerPlacement& placement) {
+#ifdef __linux__
+  bool succeeded = true;
+
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(placement.cpu, &cpus);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+    LOG(WARNING) << "Could not pin thread to CPU " << placement.cpu;
+    succeeded = false;
+  }
+
+  if (placement.numa_node >= 0 && placement.numa_node < MAX_NUMA_NODES) {
+    unsigned long nodes[MAX_NUMA_NODES / BITS_PER_WORD] = {0};
+    nodes[placement.numa_node / BITS_PER_WORD] |=
+        1ul << (placement.numa_node % BITS_PER_WORD);
+    if (set_mempolicy(MPOL_PREFERRED, nodes, MAX_NUMA_NODES + 1) != 0) {
+      VLOG(1) << "Could not prefer NUMA node " << placement.numa_node;
+      succeeded = false;
+    }
+  }
+  return succeeded;
+#else
+  (void) placement;
+  return false;
+#endif
+}
+
+bool bind_memory_to_numa_node(void* address, size_t length, int numa_node) {
+#ifdef __linux__
+  if (numa_node < 0 || numa_node >= MAX_NUMA_NODES || length == 0) {
+    return false;
+  }
+
+  const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(address);
+  const uintptr_t page_begin = begin & ~(page_size - 1);
+
+  unsigned long nodes[MAX_NUMA_NODES / BITS_PER_WORD] = {0};
+  nodes[numa_node / BITS_PER_WORD] |= 1ul << (numa_node % BITS_PER_WORD);
+  return syscall(SYS_mbind, page_begin, begin + length - page_begin,
+                 MPOL_PREFERRED, nodes, MAX_NUMA_NODES + 1,
+                 MPOL_MF_MOVE) == 0;
+#else
+  (void) address;
+  (void) length;
+  (void) numa_node;
+  return false;
+#endif
+}
+
+ScopedPlacement::ScopedPlacement(const WorkerPlacement& placement) {
+#ifdef __linux__
+  cpu_set_t cpus;
+  if (pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &cpus)) previous_cpus_.push_back(cpu);
+    }
+  }
+#endif
+  apply_placement(placement);
+}
+
+ScopedPlacement::~ScopedPlacement() {
+#ifdef __linux__
+  if (!previous_cpus_.empty()) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu : previous_cpus_) CPU_SET(cpu, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  }
+  set_mempolicy(MPOL_DEFAULT, nullptr, 0);
+#endif
+}
+
+}  // namespace sparks
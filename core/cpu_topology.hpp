@@ -0,0 +1,94 @@
+#ifndef SPARKS_CORE_CPU_TOPOLOGY_HPP_
+#define SPARKS_CORE_CPU_TOPOLOGY_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sparks {
+
+// Where a worker thread should run: a logical CPU together with the groups it
+// belongs to, so that schedulers can prefer stealing from nearby workers.
+struct WorkerPlacement {
+  int cpu;
+
+  // The physical core of cpu; SMT siblings have the same core.
+  int core;
+
+  // The lowest-numbered CPU sharing this CPU's last level cache.
+  int l3_group;
+
+  int numa_node;
+};
+
+// The machine's CPU topology, as read from sysfs: which logical CPUs are SMT
+// siblings, which share an L3 and which NUMA node each belongs to. Where the
+// information is not available (e.g. not on Linux) every CPU is assumed to be
+// its own core, on a single L3 and NUMA node.
+class CpuTopology {
+ public:
+  struct Cpu {
+    int id;
+
+    // Identifies the physical core; SMT siblings have the same core.
+    int core;
+
+    // This CPU's rank among its SMT siblings: 0 for the first hardware thread
+    // of a core, 1 for the second etc.
+    int smt_rank;
+
+    int l3_group;
+    int numa_node;
+  };
+
+  // Reads the topology of this machine. sysfs_root only changes for testing.
+  static CpuTopology detect(const std::string& sysfs_root = "/sys");
+
+  const std::vector<Cpu>& cpus() const { return cpus_; }
+  size_t num_cpus() const { return cpus_.size(); }
+  size_t num_cores() const;
+  size_t num_numa_nodes() const;
+
+  // Chooses CPUs for num_workers workers: one per physical core first, filling
+  // a NUMA node and L3 group before moving to the next, then SMT siblings in
+  // the same order. CPUs are reused round-robin if there are more workers than
+  // CPUs. Worker i should run on placement[i].
+  std::vector<WorkerPlacement> place_workers(size_t num_workers) const;
+
+ private:
+  std::vector<Cpu> cpus_;
+};
+
+// Parses sysfs CPU lists such as "0-3,8,10-11" into the CPUs they name, in
+// order.
+std::vector<int> parse_cpu_list(const std::string& list);
+
+// Pins the calling thread to placement.cpu and makes its allocations prefer
+// placement.numa_node, so that memory it touches first (its stack, arenas and
+// queues) ends up local. Returns false if either call failed, which is
+// harmless apart from performance.
+bool apply_placement(const WorkerPlacement& placement);
+
+// Moves (and binds future faults of) the pages spanning
+// [address, address + length) to a NUMA node; for memory which is allocated by
+// one thread but mostly used by a worker on another node.
+bool bind_memory_to_numa_node(void* address, size_t length, int numa_node);
+
+// Applies a placement to the calling thread until destruction, then restores
+// its previous CPU affinity and the default memory policy. For threads which
+// only temporarily act as a worker, like the one calling Scheduler::run().
+class ScopedPlacement {
+ public:
+  explicit ScopedPlacement(const WorkerPlacement& placement);
+  ~ScopedPlacement();
+
+  ScopedPlacement(const ScopedPlacement&) = delete;
+  ScopedPlacement& operator=(const ScopedPlacement&) = delete;
+
+ private:
+  std::vector<int> previous_cpus_;
+};
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_CPU_TOPOLOGY_HPP_
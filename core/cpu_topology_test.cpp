@@ -0,0 +1,131 @@
+#include "cpu_topology.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+TEST(ParseCpuListTest, RangesAndSingleCpus) {
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 8, 10, 11}),
+            parse_cpu_list("0-3,8,10-11"));
+  EXPECT_EQ((std::vector<int>{5}), parse_cpu_list("5"));
+  EXPECT_TRUE(parse_cpu_list("").empty());
+}
+
+// A fake sysfs tree in a temporary directory, removed with the fixture.
+class CpuTopologyTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char root[] = "/tmp/sparks_cpu_topology_test.XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(root));
+    root_ = root;
+    directories_.push_back(root_);
+  }
+
+  void TearDown() override {
+    for (auto file = files_.rbegin(); file != files_.rend(); ++file) {
+      unlink(file->c_str());
+    }
+    for (auto directory = directories_.rbegin();
+         directory != directories_.rend(); ++directory) {
+      rmdir(directory->c_str());
+    }
+  }
+
+  // Writes a file, and the directories leading to it, under the root.
+  void write(const std::string& path, const std::string& contents) {
+    size_t slash = 0;
+    while ((slash = path.find('/', slash + 1)) != std::string::npos) {
+      const std::string directory = root_ + "/" + path.substr(0, slash);
+      if (mkdir(directory.c_str(), 0700) == 0) {
+        directories_.push_back(directory);
+      }
+    }
+    files_.push_back(root_ + "/" + path);
+    std::ofstream{files_.back()} << contents << "\n";
+  }
+
+  std::string root_;
+  std::vector<std::string> directories_;
+  std::vector<std::string> files_;
+};
+
+// Two NUMA nodes of two cores with two hardware threads each, numbered the
+// way Linux does: 0-3 are the first threads of the cores, 4-7 their siblings.
+// Node 0 holds the second half of the cores, so that NUMA nodes don't simply
+// follow CPU ids.
+TEST_F(CpuTopologyTest, GroupsFakeSysfs) {
+  const int NUM_CPUS = 8;
+  write("devices/system/cpu/online", "0-7");
+  for (int id = 0; id < NUM_CPUS; ++id) {
+    const int core = id % 4;
+    const std::string cpu = "devices/system/cpu/cpu" + std::to_string(id) + "/";
+    write(cpu + "topology/thread_siblings_list",
+          std::to_string(core) + "," + std::to_string(core + 4));
+    for (int level = 1; level <= 3; ++level) {
+      const std::string cache =
+          cpu + "cache/index" + std::to_string(level - 1) + "/";
+      write(cache + "level", std::to_string(level));
+      write(cache + "shared_cpu_list",
+            level < 3 ? std::to_string(core) + "," + std::to_string(core + 4)
+                      : core < 2 ? "0-1,4-5" : "2-3,6-7");
+    }
+  }
+  write("devices/system/node/node0/cpulist", "2-3,6-7");
+  write("devices/system/node/node1/cpulist", "0-1,4-5");
+
+  const CpuTopology topology = CpuTopology::detect(root_);
+  ASSERT_EQ(size_t{NUM_CPUS}, topology.num_cpus());
+  EXPECT_EQ(4u, topology.num_cores());
+  EXPECT_EQ(2u, topology.num_numa_nodes());
+  for (const CpuTopology::Cpu& cpu : topology.cpus()) {
+    const int core = cpu.id % 4;
+    EXPECT_EQ(core, cpu.core) << cpu.id;
+    EXPECT_EQ(cpu.id / 4, cpu.smt_rank) << cpu.id;
+    EXPECT_EQ(core < 2 ? 0 : 2, cpu.l3_group) << cpu.id;
+    EXPECT_EQ(core < 2 ? 1 : 0, cpu.numa_node) << cpu.id;
+  }
+
+  // One worker per core, NUMA node 0 first, then the SMT siblings in the same
+  // order, then round-robin.
+  const std::vector<WorkerPlacement> placement = topology.place_workers(10);
+  std::vector<int> cpus;
+  for (const WorkerPlacement& worker : placement) {
+    cpus.push_back(worker.cpu);
+    EXPECT_EQ(worker.cpu % 4, worker.core) << worker.cpu;
+    EXPECT_EQ(worker.core < 2 ? 0 : 2, worker.l3_group) << worker.cpu;
+    EXPECT_EQ(worker.core < 2 ? 1 : 0, worker.numa_node) << worker.cpu;
+  }
+  EXPECT_EQ((std::vector<int>{2, 3, 0, 1, 6, 7, 4, 5, 2, 3}), cpus);
+}
+
+// Without sysfs, every CPU is its own core on a single L3 and NUMA node.
+TEST_F(CpuTopologyTest, FallsBackWithoutSysfs) {
+  const CpuTopology topology = CpuTopology::detect(root_);
+  const size_t num_cpus = std::max(1u, std::thread::hardware_concurrency());
+  EXPECT_EQ(num_cpus, topology.num_cpus());
+  EXPECT_EQ(num_cpus, topology.num_cores());
+  EXPECT_EQ(1u, topology.num_numa_nodes());
+
+  const std::vector<WorkerPlacement> placement =
+      topology.place_workers(num_cpus + 1);
+  ASSERT_EQ(num_cpus + 1, placement.size());
+  for (size_t i = 0; i < placement.size(); ++i) {
+    EXPECT_EQ(static_cast<int>(i % num_cpus), placement[i].cpu);
+    EXPECT_EQ(placement[i].cpu, placement[i].core);
+    EXPECT_EQ(0, placement[i].l3_group);
+    EXPECT_EQ(0, placement[i].numa_node);
+  }
+}
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,147 @@
+#ifndef SPARKS_CORE_EPOCH_HPP_
+#define SPARKS_CORE_EPOCH_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include <glog/logging.h>
+
+namespace sparks {
+
+// Epoch-based reclamation domain. Writers call retire() when they unlink an
+// object and get back the epoch of the unlinking; readers pin the current
+// epoch for the duration of their accesses. An object retired at epoch E can
+// be destroyed once min_pinned() > E, since every reader which could have
+// observed it is either unpinned or has re-pinned after the unlinking.
+//
+// Pinning is a single store to a reader-owned slot, so read paths stay
+// lock-free; scanning the slots is the (rarer) writer's job.
+class EpochDomain {
+ public:
+  using Epoch = uint64_t;
+
+  static const size_t MAX_READERS = 64;
+  static constexpr Epoch QUIESCENT = std::numeric_limits<Epoch>::max();
+
+  class Reader;
+  class Pin;
+
+  EpochDomain() {
+    for (auto& slot : readers_) {
+      slot.registered.store(false);
+      slot.pinned.store(QUIESCENT);
+    }
+  }
+
+  // Destruction must be synchronized: all the readers must have been
+  // destroyed.
+  ~EpochDomain() {
+    for (const auto& slot : readers_) DCHECK(!slot.registered.load());
+  }
+
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain(EpochDomain&&) = delete;
+
+  EpochDomain& operator=(const EpochDomain&) = delete;
+  EpochDomain& operator=(EpochDomain&&) = delete;
+
+  // Advances the global epoch and returns the epoch at which the caller's
+  // (already unlinked) object was retired.
+  Epoch retire() { return epoch_.fetch_add(1); }
+
+  // The smallest epoch pinned by any reader or QUIESCENT if no reader is
+  // currently pinned.
+  Epoch min_pinned() const {
+    Epoch min_epoch = QUIESCENT;
+    for (const auto& slot : readers_) {
+      const auto pinned = slot.pinned.load();
+      if (pinned < min_epoch) min_epoch = pinned;
+    }
+    return min_epoch;
+  }
+
+  bool is_reclaimable(Epoch retired_at, Epoch min_pinned_epoch) const {
+    return retired_at < min_pinned_epoch;
+  }
+
+ private:
+  struct alignas(64) ReaderSlot {
+    std::atomic<bool> registered;
+    std::atomic<Epoch> pinned;
+  };
+
+  ReaderSlot readers_[MAX_READERS];
+  std::atomic<Epoch> epoch_{0};
+};
+
+// A registered reader. Each thread which reads from structures protected by an
+// EpochDomain must own a Reader; a Reader must only be used from one thread at
+// a time.
+class EpochDomain::Reader {
+ public:
+  explicit Reader(EpochDomain& domain) : domain_{&domain} {
+    for (auto& slot : domain_->readers_) {
+      if (!slot.registered.exchange(true)) {
+        slot_ = &slot;
+        return;
+      }
+    }
+    LOG(FATAL) << "More than " << MAX_READERS << " epoch readers.";
+  }
+
+  ~Reader() {
+    DCHECK_EQ(pin_depth_, 0);
+    slot_->pinned.store(QUIESCENT);
+    slot_->registered.store(false);
+  }
+
+  Reader(const Reader&) = delete;
+  Reader(Reader&&) = delete;
+
+  Reader& operator=(const Reader&) = delete;
+  Reader& operator=(Reader&&) = delete;
+
+  // Pins the current epoch until the returned Pin is destroyed. Pins nest, only
+  // the outermost one touches shared state.
+  inline Pin pin();
+
+  bool is_pinned() const { return pin_depth_ > 0; }
+
+ private:
+  friend class Pin;
+
+  void enter() {
+    if (pin_depth_++ == 0) slot_->pinned.store(domain_->epoch_.load());
+  }
+
+  void exit() {
+    DCHECK_GT(pin_depth_, 0);
+    if (--pin_depth_ == 0) slot_->pinned.store(QUIESCENT);
+  }
+
+  EpochDomain* domain_;
+  ReaderSlot* slot_{nullptr};
+  uint32_t pin_depth_{0};
+};
+
+class EpochDomain::Pin {
+ public:
+  explicit Pin(Reader& reader) : reader_{&reader} { reader_->enter(); }
+  Pin(Pin&& other) : reader_{other.reader_} { other.reader_ = nullptr; }
+  ~Pin() { if (reader_) reader_->exit(); }
+
+  Pin(const Pin&) = delete;
+  Pin& operator=(const Pin&) = delete;
+  Pin& operator=(Pin&&) = delete;
+
+ private:
+  Reader* reader_;
+};
+
+EpochDomain::Pin EpochDomain::Reader::pin() { return Pin{*this}; }
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_EPOCH_HPP_
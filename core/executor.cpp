@@ -1,11 +1,41 @@
 #include "executor.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
 #include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <glog/logging.h>
 
 namespace sparks {
 
-Executor::Executor() : tasks_{16}, dependents_{16} {
+namespace {
+
+// How long an idle I/O thread waits for a task before exiting.
+const auto IO_THREAD_IDLE_TIMEOUT = std::chrono::seconds(2);
+
+// How many times an idle worker yields before it parks.
+const int IDLE_SPINS = 128;
+
+// The submission queue size of the read ring; the kernel makes the completion
+// queue, which bounds the reads in flight, twice as large.
+const uint32_t RING_ENTRIES = 256;
+
+// io_uring reads take a 32-bit length; longer ones are read in pieces.
+const size_t MAX_RING_READ = size_t{1} << 30;
+
+}  // namespace
+
+thread_local Executor::Worker* Executor::current_worker_{nullptr};
+
+Executor::Executor()
+    : tasks_{16}, successor_blocks_{16},
+      timers_{Clock::now() / TIMER_RESOLUTION}, periodic_tasks_{16} {
   // Initialise affinity task queues to empty task lists.
   for (unsigned i = 0; i < MAX_THREADS; ++i) {
     affinity_task_queue_[i].front = affinity_task_queue_[i].back = INVALID_TASK;
@@ -18,19 +48,34 @@ Executor::~Executor() {
 }
 
 void Executor::run_tasks_no_affinity() {
-  if (closed_) return;
+  Worker worker;
+  DCHECK(current_worker_ == nullptr) << "Nested run_tasks_*() call.";
 
+  // close() sets closed_ under the lock before close_and_wait() disables
+  // num_threads_, so checking it under the lock too means the counter is
+  // still alive when the Item is made.
   std::unique_lock<Mutex> lock{tasks_mutex_};
+  if (closed_) return;
+  current_worker_ = &worker;
   BlockingCounter::Item running_thread{num_threads_};
+  worker.scratch_epoch = num_epochs_;
 
   while (true) {
+    fire_due_timers();
+    int idle_spins{IDLE_SPINS};
     while (empty_task_list(global_task_queue_)) {
-      lock.unlock();
-      std::this_thread::yield();
-      lock.lock();
+      if (--idle_spins < 0) {
+        park_worker(lock);
+      } else {
+        lock.unlock();
+        std::this_thread::yield();
+        lock.lock();
+      }
       if (closed_) {
+        current_worker_ = nullptr;
         return;
       }
+      fire_due_timers();
     }
 
     run_task(pop_task(global_task_queue_), lock);
@@ -38,37 +83,46 @@ void Executor::run_tasks_no_affinity() {
 }
 
 void Executor::run_tasks_with_affinity(ThreadId affinity) {
-  if (closed_) return;
   if (affinity == NO_AFFINITY) {
     run_tasks_no_affinity();
     return;
   }
 
+  Worker worker;
+  DCHECK(current_worker_ == nullptr) << "Nested run_tasks_*() call.";
+
+  // See run_tasks_no_affinity().
   std::unique_lock<Mutex> lock{tasks_mutex_};
+  if (closed_) return;
+  current_worker_ = &worker;
   BlockingCounter::Item running_thread{num_threads_};
+  worker.scratch_epoch = num_epochs_;
 
   CHECK(!thread_exists_for_affinity_[affinity]) << affinity;
   thread_exists_for_affinity_[affinity] = true;
 
   while (true) {
+    fire_due_timers();
     TaskList& affinity_queue = affinity_task_queue_[affinity];
     bool global_is_empty = empty_task_list(global_task_queue_);
     bool affinity_is_empty = empty_task_list(affinity_queue);
-    int start_sleeping{128};
+    int idle_spins{IDLE_SPINS};
     while (global_is_empty && affinity_is_empty) {
-      lock.unlock();
-      if (--start_sleeping < 0) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      if (--idle_spins < 0) {
+        park_worker(lock);
       } else {
+        lock.unlock();
         std::this_thread::yield();
+        lock.lock();
       }
-      lock.lock();
 
       if (closed_) {
         thread_exists_for_affinity_[affinity] = false;
+        current_worker_ = nullptr;
         return;
       }
 
+      fire_due_timers();
       global_is_empty = empty_task_list(global_task_queue_);
       affinity_is_empty = empty_task_list(affinity_queue);
     }
@@ -89,10 +143,313 @@ void Executor::run_tasks_with_affinity(ThreadId affinity) {
   }
 }
 
+void Executor::park_worker(std::unique_lock<Mutex>& lock) {
+  ++num_parked_workers_;
+  const auto wake_tick = timers_.next_tick();
+  if (wake_tick == TimerWheel<TaskId>::NEVER || timer_keeper_parked_) {
+    work_available_.wait(lock);
+  } else {
+    timer_keeper_parked_ = true;
+    timer_keeper_wake_tick_ = wake_tick;
+    const Clock::Ticks wake_time = wake_tick * TIMER_RESOLUTION;
+    const Clock::Ticks now = Clock::now();
+    if (wake_time > now) {
+      work_available_.wait_for(lock, std::chrono::nanoseconds(wake_time - now));
+    }
+    timer_keeper_parked_ = false;
+
+    // Hand keeping the timers to another parked worker, since this one may
+    // now run a long task.
+    if (num_parked_workers_ > 1) work_available_.notify_one();
+  }
+  --num_parked_workers_;
+}
+
+void Executor::start_timer(TaskId id, Clock::Ticks time) {
+  const Clock::Ticks now = Clock::now();
+  if (time <= now) {
+    release_held_dependency(id);
+    return;
+  }
+
+  // Advancing first keeps the new timer on the lowest level it can be.
+  timers_.advance(now / TIMER_RESOLUTION,
+                  [this](TaskId due) { release_held_dependency(due); });
+  const auto tick = (time + TIMER_RESOLUTION - 1) / TIMER_RESOLUTION;
+  timers_.add(tick, id);
+
+  // Make sure a parked worker will wake up in time for it.
+  if (timer_keeper_parked_) {
+    if (tick < timer_keeper_wake_tick_) work_available_.notify_all();
+  } else if (num_parked_workers_ > 0) {
+    work_available_.notify_one();
+  }
+}
+
+void Executor::schedule_periodic_run(PeriodicTaskId id) {
+  Clock::Ticks time;
+  ThreadId affinity;
+  {
+    std::lock_guard<Mutex> lock{tasks_mutex_};
+    const PeriodicTask& periodic = periodic_tasks_[id];
+    time = periodic.next_time;
+    affinity = periodic.affinity;
+  }
+
+  Executor* executor = this;
+  const TaskId* no_dependencies = nullptr;
+  const TaskId task_id = add_task_impl(
+      [executor, id] { executor->run_periodic_task(id); }, no_dependencies,
+      no_dependencies, affinity, TaskKind::NORMAL, 1);
+  if (task_id == INVALID_TASK) return;
+
+  std::lock_guard<Mutex> lock{tasks_mutex_};
+  start_timer(task_id, time);
+}
+
+void Executor::run_periodic_task(PeriodicTaskId id) {
+  PeriodicTask* periodic;
+  {
+    std::lock_guard<Mutex> lock{tasks_mutex_};
+    periodic = &periodic_tasks_[id];
+    if (periodic->cancelled) {
+      periodic_tasks_.erase(id);
+      return;
+    }
+  }
+
+  // Elements of periodic_tasks_ never move, and only runs erase them.
+  periodic->closure();
+
+  {
+    std::lock_guard<Mutex> lock{tasks_mutex_};
+    if (periodic->cancelled) {
+      periodic_tasks_.erase(id);
+      return;
+    }
+
+    // The next step after the one just run which is still in the future.
+    const Clock::Ticks now = Clock::now();
+    const Clock::Ticks period = periodic->period;
+    auto& next_time = periodic->next_time;
+    next_time += period;
+    if (next_time <= now) {
+      next_time += ((now - next_time) / period + 1) * period;
+    }
+  }
+  schedule_periodic_run(id);
+}
+
+void Executor::cancel_periodic_task(PeriodicTaskId id) {
+  std::lock_guard<Mutex> lock{tasks_mutex_};
+  CHECK(periodic_tasks_.is_valid_id(id)) << "Unknown periodic task: " << id;
+  periodic_tasks_[id].cancelled = true;
+}
+
+void Executor::run_io_tasks(BlockingCounter::Item running_thread) {
+  Worker worker;
+  current_worker_ = &worker;
+
+  // Declared after running_thread, so the lock is released before the
+  // Executor can be destroyed.
+  std::unique_lock<Mutex> lock{tasks_mutex_};
+  worker.scratch_epoch = num_epochs_;
+
+  while (!closed_) {
+    if (empty_task_list(io_task_queue_)) {
+      ++num_idle_io_threads_;
+      const auto status = io_wakeup_.wait_for(lock, IO_THREAD_IDLE_TIMEOUT);
+      --num_idle_io_threads_;
+      if (status == std::cv_status::timeout &&
+          empty_task_list(io_task_queue_)) {
+        break;
+      }
+      continue;
+    }
+
+    --num_io_tasks_queued_;
+    run_task(pop_task(io_task_queue_), lock);
+  }
+
+  --num_io_threads_;
+  current_worker_ = nullptr;
+}
+
+void Executor::wake_io_thread() {
+  // Idle threads only stop counting as such once they reacquire the lock, so
+  // compare with the number of queued tasks rather than wake just one.
+  if (num_idle_io_threads_ > 0) io_wakeup_.notify_one();
+  if (num_io_tasks_queued_ > num_idle_io_threads_ &&
+      num_io_threads_ < max_io_threads_ && !closed_) {
+    // Rare (only when the pool grows), so starting the thread under the lock
+    // is acceptable.
+    ++num_io_threads_;
+    std::thread{&Executor::run_io_tasks, this,
+                BlockingCounter::Item{num_threads_}}.detach();
+  }
+}
+
+size_t Executor::max_io_threads() {
+  std::lock_guard<Mutex> lock{tasks_mutex_};
+  return max_io_threads_;
+}
+
+void Executor::set_max_io_threads(size_t max_io_threads) {
+  CHECK_GT(max_io_threads, 0u);
+  std::lock_guard<Mutex> lock{tasks_mutex_};
+  max_io_threads_ = max_io_threads;
+}
+
+size_t Executor::num_io_threads() {
+  std::lock_guard<Mutex> lock{tasks_mutex_};
+  return num_io_threads_;
+}
+
+bool Executor::ring_available() {
+  std::lock_guard<Mutex> lock{tasks_mutex_};
+  if (!ring_tried_ && !closed_) {
+    ring_tried_ = true;
+    ring_ = IoRing::create(RING_ENTRIES);
+    if (ring_) {
+      std::thread{&Executor::run_ring_completions, this,
+                  BlockingCounter::Item{num_threads_}}.detach();
+    }
+  }
+  return ring_ != nullptr;
+}
+
+void Executor::submit_read(Read* read) {
+  {
+    std::lock_guard<std::mutex> lock{ring_mutex_};
+    if (!ring_stopped_) {
+      ring_backlog_.push_back(read);
+      submit_ring_backlog();
+      return;
+    }
+  }
+
+  // A task which was already running at close(); nothing reaps ring_ now.
+  read->num_read = -ECANCELED;
+  complete_ring_read(read);
+}
+
+void Executor::submit_ring_backlog() {
+  while (!ring_backlog_.empty() &&
+         ring_in_flight_ < ring_->max_in_flight()) {
+    Read* read = ring_backlog_.front();
+    const auto length = static_cast<uint32_t>(
+        std::min(read->length - read->num_read, MAX_RING_READ));
+    if (!ring_->prepare_read(read->fd, read->buffer + read->num_read, length,
+                             read->offset + read->num_read,
+                             reinterpret_cast<uint64_t>(read))) {
+      break;
+    }
+    ring_backlog_.pop_front();
+    ++ring_in_flight_;
+  }
+
+  const int num_submitted = ring_->submit();
+  CHECK_GE(num_submitted, 0)
+      << "io_uring submit: " << std::strerror(-num_submitted);
+}
+
+void Executor::run_ring_completions(BlockingCounter::Item running_thread) {
+  std::vector<Read*> completed;
+  std::vector<Read*> unfinished;
+  bool stop = false;
+  while (!stop) {
+    ring_->wait();
+
+    completed.clear();
+    unfinished.clear();
+    {
+      // Reaping under ring_mutex_ also orders it after the submission.
+      std::lock_guard<std::mutex> lock{ring_mutex_};
+      ring_in_flight_ -= ring_->reap(
+          [&completed, &unfinished](uint64_t user_data, int32_t result) {
+        Read* read = reinterpret_cast<Read*>(user_data);
+        if (read == nullptr) return;  // close()'s wake-up.
+
+        if (result == -EINTR || result == -EAGAIN) {
+          unfinished.push_back(read);
+        } else if (result < 0) {
+          read->num_read = result;
+          completed.push_back(read);
+        } else {
+          read->num_read += result;
+          const auto num_read = static_cast<size_t>(read->num_read);
+          if (result == 0 || num_read == read->length) {
+            completed.push_back(read);
+          } else {
+            unfinished.push_back(read);
+          }
+        }
+      });
+
+      ring_backlog_.insert(ring_backlog_.begin(), unfinished.begin(),
+                           unfinished.end());
+      submit_ring_backlog();
+      stop = ring_closing_ && ring_in_flight_ == 0;
+      if (stop) {
+        // These will never be submitted. Their tasks still complete, so that
+        // tasks_in_flight drops and dependents run.
+        ring_stopped_ = true;
+        for (Read* read : ring_backlog_) {
+          read->num_read = -ECANCELED;
+          completed.push_back(read);
+        }
+        ring_backlog_.clear();
+      }
+    }
+
+    for (Read* read : completed) complete_ring_read(read);
+  }
+}
+
+void Executor::complete_ring_read(Read* read) {
+  if (read->result) *read->result = read->num_read;
+  complete_async_task(read->task);
+  delete read;
+}
+
+void Executor::read_blocking(Read* read) {
+  const bool opened = !read->path.empty();
+  if (opened) {
+    read->fd = open(read->path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (read->fd < 0) read->num_read = -errno;
+  }
+
+  while (read->fd >= 0 && static_cast<size_t>(read->num_read) < read->length) {
+    const ssize_t result =
+        pread(read->fd, read->buffer + read->num_read,
+              read->length - read->num_read, read->offset + read->num_read);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      read->num_read = -errno;
+      break;
+    }
+    if (result == 0) break;
+    read->num_read += result;
+  }
+
+  if (opened && read->fd >= 0) ::close(read->fd);
+  if (read->result) *read->result = read->num_read;
+  delete read;
+}
+
 void Executor::close() {
   std::lock_guard<Mutex> lock{tasks_mutex_};
   if (closed_) return;
   closed_ = true;
+  io_wakeup_.notify_all();
+  work_available_.notify_all();
+
+  if (ring_) {
+    std::lock_guard<std::mutex> ring_lock{ring_mutex_};
+    ring_closing_ = true;
+    if (ring_->prepare_nop(0)) ++ring_in_flight_;
+    ring_->submit();
+  }
 }
 
 void Executor::close_and_wait() {
@@ -106,48 +463,134 @@ inline bool Executor::empty_task_list(const TaskList& list) {
   return list.front == INVALID_TASK;
 }
 
-Executor::Task Executor::pop_task(
-    TaskList& queue) {
+Executor::TaskId Executor::pop_task(TaskList& queue) {
   DCHECK_NE(queue.front, INVALID_TASK);
   DCHECK_NE(queue.back, INVALID_TASK);
 
   TaskId task_id = queue.front;
-  Task task{std::move(tasks_[task_id])};
-
-  queue.front = task.next_in_list;
+  queue.front = tasks_[task_id].next_in_list;
   if (queue.front == INVALID_TASK) queue.back = INVALID_TASK;
 
-  tasks_.erase(task_id);
-  return task;
+  return task_id;
 }
 
-void Executor::run_task(Task&& task, std::unique_lock<Mutex>& lock) {
+void Executor::run_task(TaskId id, std::unique_lock<Mutex>& lock) {
+  // Elements of tasks_ never move. Unless the task is ASYNC, only this
+  // thread erases it; an ASYNC one may be erased by complete_async_task() as
+  // soon as the lock is released, so it is not touched after its closure.
+  Task& task = tasks_[id];
   DCHECK_EQ(task.num_unmet_dependencies, 0);
+  const TaskKind kind = task.kind;
+
+  // The epoch ends as soon as its last task is ready: every task using the
+  // old scratch memory has completed, and the closure may already add (or
+  // even run) tasks of the next epoch.
+  if (kind == TaskKind::ENDS_EPOCH) ++num_epochs_;
 
   if (task.closure) {
+    reset_scratch_if_stale();
     lock.unlock();
     task.closure();
     lock.lock();
   }
 
+  // Its completion will call complete_async_task().
+  if (kind == TaskKind::ASYNC) return;
+
   signal_dependents(task);
+  tasks_.erase(id);
+  --budget_stats_.tasks_in_flight;
+}
+
+void Executor::complete_async_task(TaskId id) {
+  std::lock_guard<Mutex> lock{tasks_mutex_};
+  signal_dependents(tasks_[id]);
+  tasks_.erase(id);
+  --budget_stats_.tasks_in_flight;
+}
+
+void Executor::wait_for_budget(std::unique_lock<Mutex>& lock) {
+  const Clock::Ticks start = Clock::now();
+  ++budget_stats_.throttled_adds;
+
+  // Only threads which are not workers (like the main thread producing
+  // tasks) get here. They help with a Worker of their own, so the tasks have
+  // a scratch arena.
+  DCHECK(current_worker_ == nullptr);
+  static thread_local Worker helper;
+  current_worker_ = &helper;
+
+  while (budget_stats_.tasks_in_flight >= max_tasks_in_flight_ && !closed_) {
+    fire_due_timers();
+    if (empty_task_list(global_task_queue_)) {
+      lock.unlock();
+      std::this_thread::yield();
+      lock.lock();
+    } else {
+      run_task(pop_task(global_task_queue_), lock);
+      ++budget_stats_.helped_tasks;
+    }
+  }
+  current_worker_ = nullptr;
+
+  const Clock::Ticks waited = Clock::now() - start;
+  budget_stats_.throttled_ticks += waited;
+  budget_stats_.max_throttled_ticks =
+      std::max(budget_stats_.max_throttled_ticks, waited);
+}
+
+void Executor::set_max_tasks_in_flight(size_t max_tasks_in_flight) {
+  CHECK_GT(max_tasks_in_flight, 0u);
+  CHECK_LE(max_tasks_in_flight, DEFAULT_MAX_TASKS_IN_FLIGHT)
+      << "Leave room for tasks being added while the budget is checked.";
+  std::lock_guard<Mutex> lock{tasks_mutex_};
+  max_tasks_in_flight_ = max_tasks_in_flight;
+}
+
+TaskBudgetStats Executor::task_budget_stats() {
+  std::lock_guard<Mutex> lock{tasks_mutex_};
+  return budget_stats_;
+}
+
+void Executor::reset_scratch_if_stale() {
+  Worker& worker = *current_worker_;
+  if (worker.scratch_epoch != num_epochs_) {
+    worker.scratch.reset();
+    worker.scratch_epoch = num_epochs_;
+  }
 }
 
 void Executor::signal_dependents(Task& task) {
-  DependentId dependent_id = task.first_dependent;
-
-  while (dependent_id != INVALID_DEPENDENT) {
-    Dependent& dependent = dependents_[dependent_id];
-    Task& dependent_task = tasks_[dependent.from];
-    DCHECK_NE(dependent_task.num_unmet_dependencies, 0);
-    if ((--dependent_task.num_unmet_dependencies) == 0) {
-      schedule(dependent.from, dependent_task);
+  const uint32_t num_inline = task.num_successors < NUM_INLINE_SUCCESSORS
+                                  ? task.num_successors
+                                  : NUM_INLINE_SUCCESSORS;
+  for (uint32_t i = 0; i < num_inline; ++i) {
+    signal_dependent(task.successors[i]);
+  }
+  if (task.spilled_successors == INVALID_SUCCESSOR_BLOCK) return;
+
+  // Only the last filled block, the first one in the list, may be partial.
+  uint32_t num_in_block =
+      (task.num_successors - NUM_INLINE_SUCCESSORS - 1) % SuccessorBlock::SIZE +
+      1;
+  SuccessorBlockId block_id = task.spilled_successors;
+  while (block_id != INVALID_SUCCESSOR_BLOCK) {
+    const SuccessorBlock& block = successor_blocks_[block_id];
+    for (uint32_t i = 0; i < num_in_block; ++i) {
+      signal_dependent(block.successors[i]);
     }
 
-    DependentId next_dependent_id = dependent.next;
-    dependents_.erase(dependent_id);
-    dependent_id = next_dependent_id;
+    const SuccessorBlockId next_block_id = block.next;
+    successor_blocks_.erase(block_id);
+    block_id = next_block_id;
+    num_in_block = SuccessorBlock::SIZE;
   }
 }
 
+void Executor::signal_dependent(TaskId id) {
+  Task& task = tasks_[id];
+  DCHECK_NE(task.num_unmet_dependencies, 0);
+  if (--task.num_unmet_dependencies == 0) schedule(id, task);
+}
+
 }  // namespace sparks
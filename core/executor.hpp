@@ -2,21 +2,50 @@
 #define SPARKS_CORE_EXECUTOR_HPP_
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <initializer_list>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <string>
 
 #include "arraydelegate.hpp"
 #include "blocking_counter.hpp"
+#include "clock.hpp"
+#include "frame_arena.hpp"
+#include "io_ring.hpp"
+#include "shared_id_vector.hpp"
 #include "spin_lock.hpp"
 #include "stable_id_vector.hpp"
+#include "timer_wheel.hpp"
 
 namespace sparks {
 
+// Occupancy and back-pressure counters of an Executor's in-flight task
+// budget (see Executor::set_max_tasks_in_flight()).
+struct TaskBudgetStats {
+  // Tasks added but not completed yet: now, and at most so far.
+  size_t tasks_in_flight;
+  size_t peak_tasks_in_flight;
+
+  // Number of task additions which had to wait for room (additions from
+  // running tasks never do).
+  uint64_t throttled_adds;
+
+  // Number of tasks which those ran while waiting for room.
+  uint64_t helped_tasks;
+
+  // Total and longest time an addition waited for room.
+  Clock::Ticks throttled_ticks;
+  Clock::Ticks max_throttled_ticks;
+};
+
 class Executor {
  public:
   using TaskId = uint32_t;
-  using DependentId = uint32_t;
+  using PeriodicTaskId = uint32_t;
   using ThreadId = uint16_t;
   using TaskStamp = uint16_t;
   using DependencyCount = uint16_t;
@@ -25,16 +54,45 @@ class Executor {
 
  private:
   struct Task;
-  struct Dependent;
+  struct SuccessorBlock;
+  struct Read;
+  struct PeriodicTask;
+
+  enum class TaskKind : uint8_t {
+    NORMAL,
+
+    // Added by add_epoch_task().
+    ENDS_EPOCH,
+
+    // Runs on the I/O pool.
+    IO,
 
-  using TaskIdVector = BasicStableIdVector<Task, TaskId, 12>;
-  using DependentIdVector = BasicStableIdVector<Dependent, DependentId, 14>;
+    // Completes when complete_async_task() is called, not when its closure
+    // returns.
+    ASYNC,
+  };
+
+  using TaskIdVector = BasicSharedIdVector<Task, TaskId, 12>;
+  using SuccessorBlockId = uint32_t;
+  using SuccessorBlockIdVector =
+      BasicStableIdVector<SuccessorBlock, SuccessorBlockId, 12>;
+  using PeriodicTaskIdVector =
+      BasicStableIdVector<PeriodicTask, PeriodicTaskId, 8>;
 
  public:
   static const ThreadId MAX_THREADS = 16;
   static const ThreadId NO_AFFINITY = static_cast<ThreadId>(-1);
   static const TaskId INVALID_TASK = TaskIdVector::INVALID_INDEX;
-  static const TaskId INVALID_DEPENDENT = DependentIdVector::INVALID_INDEX;
+  static const size_t DEFAULT_MAX_IO_THREADS = 64;
+
+  // Half the task id space, leaving the rest for tasks being added while the
+  // budget is checked and for those added by running tasks.
+  static const size_t DEFAULT_MAX_TASKS_IN_FLIGHT = TaskIdVector::MAX_SIZE / 2;
+
+  // The resolution of timed tasks: they run at most this late (plus the time
+  // to wake a worker), never early.
+  static const Clock::Ticks TIMER_RESOLUTION =
+      Clock::TICKS_PER_SECOND / 10000;
 
   Executor();
   ~Executor();
@@ -48,17 +106,135 @@ class Executor {
   TaskId add_task(ClosureType&& closure, TaskIdFwdIter depends_begin,
                   TaskIdFwdIter depends_end, ThreadId affinity = NO_AFFINITY);
 
+  // Adds a task which ends a scratch epoch (typically the last task of a
+  // frame): once it starts, every worker resets its scratch() arena before
+  // running its next task. It must therefore run after every task using the
+  // epoch's scratch memory. Its closure already belongs to the next epoch, so
+  // it may add (e.g.) the next frame's tasks.
+  template <typename ClosureType,
+            typename TaskIdRange = ::std::initializer_list<TaskId>>
+  TaskId add_epoch_task(ClosureType&& closure,
+                        const TaskIdRange& depends_on = {},
+                        ThreadId affinity = NO_AFFINITY);
+
+  template <typename ClosureType, typename TaskIdFwdIter>
+  TaskId add_epoch_task(ClosureType&& closure, TaskIdFwdIter depends_begin,
+                        TaskIdFwdIter depends_end,
+                        ThreadId affinity = NO_AFFINITY);
+
+  // Adds a task which runs no earlier than time (a Clock::now() value), once
+  // its dependencies have run too. Tasks can depend on it at once. Idle
+  // workers park until the earliest such time instead of polling.
+  template <typename ClosureType,
+            typename TaskIdRange = ::std::initializer_list<TaskId>>
+  TaskId add_task_at(Clock::Ticks time, ClosureType&& closure,
+                     const TaskIdRange& depends_on = {},
+                     ThreadId affinity = NO_AFFINITY);
+
+  template <typename ClosureType,
+            typename TaskIdRange = ::std::initializer_list<TaskId>>
+  TaskId add_task_after(Clock::Ticks delay, ClosureType&& closure,
+                        const TaskIdRange& depends_on = {},
+                        ThreadId affinity = NO_AFFINITY);
+
+  // Runs closure every period, first one period from now, until
+  // cancel_periodic_task(). Runs are due at fixed steps from the first, so
+  // lateness does not accumulate; steps missed while a run was late (or still
+  // running) are skipped rather than run back to back. Runs never overlap.
+  // At most 255 periodic tasks can be registered at once. Each holds a slot of
+  // the tasks in flight budget (for its next run) until cancelled.
+  template <typename ClosureType>
+  PeriodicTaskId add_periodic_task(Clock::Ticks period, ClosureType&& closure,
+                                   ThreadId affinity = NO_AFFINITY);
+
+  // No run of the task starts after this returns; one may still be running.
+  // Its id may be reused soon after, so each task must be cancelled exactly
+  // once; an id which is not registered fails a CHECK.
+  void cancel_periodic_task(PeriodicTaskId id);
+
+  // Adds a task which may block, e.g. on a read(). It runs on a separate pool
+  // of I/O threads, never on the threads running run_tasks_*(), and signals
+  // its dependents like any other task. The pool starts a thread whenever an
+  // I/O task is scheduled with none idle (up to max_io_threads()), and idle
+  // threads exit after a while.
+  template <typename ClosureType,
+            typename TaskIdRange = ::std::initializer_list<TaskId>>
+  TaskId add_io_task(ClosureType&& closure,
+                     const TaskIdRange& depends_on = {});
+
+  template <typename ClosureType, typename TaskIdFwdIter>
+  TaskId add_io_task(ClosureType&& closure, TaskIdFwdIter depends_begin,
+                     TaskIdFwdIter depends_end);
+
+  // Adds a task which reads length bytes at offset of fd into buffer, like
+  // pread() but continuing after short reads, and completes once they have
+  // arrived. Unless result is null, it is set to the number of bytes read
+  // (fewer than length only at the end of the file) or to -errno before any
+  // dependent runs. Reads are submitted to an io_uring, so no thread waits
+  // for them and many can be outstanding at once; where io_uring is not
+  // available they run on the I/O pool instead (see add_io_task()).
+  template <typename TaskIdRange = ::std::initializer_list<TaskId>>
+  TaskId add_read_task(int fd, uint64_t offset, size_t length, void* buffer,
+                       int64_t* result = nullptr,
+                       const TaskIdRange& depends_on = {});
+
+  // As above, but opens path first and closes it afterwards. Since open()
+  // blocks, these always run on the I/O pool.
+  template <typename TaskIdRange = ::std::initializer_list<TaskId>>
+  TaskId add_read_task(const std::string& path, uint64_t offset,
+                       size_t length, void* buffer, int64_t* result = nullptr,
+                       const TaskIdRange& depends_on = {});
+
+  // The limit on the size of the I/O pool. Since its threads mostly sleep in
+  // syscalls it can exceed the number of cores many times over.
+  size_t max_io_threads();
+  void set_max_io_threads(size_t max_io_threads);
+
+  // The current size of the I/O pool, idle threads included.
+  size_t num_io_threads();
+
+  // The scratch arena of the calling worker thread, for temporary allocations
+  // which live until the end of the current epoch (see add_epoch_task()).
+  // Must only be called from a running task.
+  static inline FrameArena& scratch();
+
+  // Run tasks on the calling thread until close(). The worker's state (like
+  // its scratch arena) is allocated by the calling thread, so pin it with
+  // apply_placement() first to keep that memory on the worker's NUMA node.
   void run_tasks_no_affinity();
   void run_tasks_with_affinity(ThreadId with_affinity);
 
   void close();
   void close_and_wait();
 
+  // Contention counters of the lock which every add_task() and every task
+  // completion go through.
+  SpinLockStats tasks_mutex_stats() const { return tasks_mutex_.stats(); }
+
+  // Bounds the number of tasks added but not completed yet (of every kind,
+  // including timed ones). A thread adding a task beyond that runs ready
+  // tasks itself until one completes (or yields if there are none), which
+  // keeps memory and queueing latency bounded when producers outpace the
+  // workers. The budget must leave room for the tasks which those already in
+  // flight wait for. Tasks added by running tasks are never throttled (their
+  // parents hold slots which only free up once they return): they overdraw
+  // the budget instead.
+  void set_max_tasks_in_flight(size_t max_tasks_in_flight);
+  TaskBudgetStats task_budget_stats();
+
  private:
+  static const SuccessorBlockId INVALID_SUCCESSOR_BLOCK =
+      SuccessorBlockIdVector::INVALID_INDEX;
+
+  // The successors a Task holds inline, enough for most; with them, a task
+  // takes up a cache line and a half.
+  static const uint32_t NUM_INLINE_SUCCESSORS = 4;
+
   struct Task {
     template<typename ClosureType>
-    Task(ClosureType&& closure, ThreadId affinity)
-        : closure{std::forward<ClosureType>(closure)}, affinity{affinity} {}
+    Task(ClosureType&& closure, ThreadId affinity, TaskKind kind)
+        : closure{std::forward<ClosureType>(closure)}, affinity{affinity},
+          kind{kind} {}
 
     // The work item associated with this task. It is valid for the closure to
     // be empty, in which case the task simply acts as a dependency group.
@@ -68,10 +244,14 @@ class Executor {
     // TaskList at a time.
     TaskId next_in_list{INVALID_TASK};
 
-    // The beginning of the list of tasks which depend on this one. After this
-    // task completes all of their num_unmet_dependencies counters will be
-    // decremented.
-    DependentId first_dependent{INVALID_DEPENDENT};
+    // The last filled block of the successors which didn't fit inline.
+    SuccessorBlockId spilled_successors{INVALID_SUCCESSOR_BLOCK};
+
+    // The first of the tasks which depend on this one; the rest are in
+    // spilled_successors. After this task completes all of their
+    // num_unmet_dependencies counters will be decremented.
+    TaskId successors[NUM_INLINE_SUCCESSORS];
+    DependencyCount num_successors{0};
 
     // The number of tasks on which this one depends that haven't been ran yet.
     // The task will be ran when this reaches zero.
@@ -84,17 +264,57 @@ class Executor {
     // This stamp is a cycling task counter to enforce (approximate) ordering
     // between different task queues.
     TaskStamp stamp{0};
+
+    TaskKind kind;
+  };
+
+  // A read of add_read_task(), owned by its task's closure until submitted,
+  // then by the completion thread.
+  struct Read {
+    TaskId task;
+    int fd;
+
+    // If not empty, fd is opened from this by the read itself.
+    std::string path;
+
+    char* buffer;
+    size_t length;
+    uint64_t offset;
+    int64_t* result;
+
+    // The bytes read so far, or -errno after an error.
+    int64_t num_read;
+  };
+
+  struct PeriodicTask {
+    template <typename ClosureType>
+    PeriodicTask(ClosureType&& closure, Clock::Ticks period,
+                 Clock::Ticks next_time, ThreadId affinity)
+        : closure{std::forward<ClosureType>(closure)}, period{period},
+          next_time{next_time}, affinity{affinity} {}
+
+    Closure closure;
+    Clock::Ticks period;
+
+    // When the next run is due.
+    Clock::Ticks next_time;
+
+    ThreadId affinity;
+    bool cancelled{false};
   };
 
-  struct Dependent {
-    inline Dependent(TaskId from, TaskId next) : from{from}, next{next} {}
+  // A chunk of a task's successors beyond the inline ones. With the id of its
+  // entry in successor_blocks_, it fills a cache line.
+  struct SuccessorBlock {
+    static const uint32_t SIZE = 14;
+
+    explicit SuccessorBlock(SuccessorBlockId next) : next{next} {}
 
-    // The task which depends on the one whose dependent list this is.
-    TaskId from;
+    TaskId successors[SIZE];
 
-    // The id of the next dependent in the list or INVALID_DEPENDENT if this is
-    // the last element.
-    DependentId next;
+    // The block filled before this one, which is full, or
+    // INVALID_SUCCESSOR_BLOCK.
+    SuccessorBlockId next;
   };
 
   // A linked list of tasks.
@@ -102,32 +322,120 @@ class Executor {
     TaskId front, back;
   };
 
+  // The state each thread running tasks keeps for itself.
+  struct Worker {
+    FrameArena scratch;
+
+    // The number of ended epochs when scratch was last reset.
+    uint64_t scratch_epoch{0};
+  };
+
+  // The Worker of the calling thread, if it is running tasks.
+  static thread_local Worker* current_worker_;
+
+  // The task waits for num_held more dependencies, to be released with
+  // release_held_dependency(). If emplaced_id isn't null, the new task's id
+  // is stored there before the task can run.
+  template <typename ClosureType, typename TaskIdFwdIter>
+  TaskId add_task_impl(ClosureType&& closure, TaskIdFwdIter depends_begin,
+                       TaskIdFwdIter depends_end, ThreadId affinity,
+                       TaskKind kind, DependencyCount num_held = 0,
+                       TaskId* emplaced_id = nullptr);
+
+  // Runs ready tasks until there is room in the budget. Expects a locked
+  // unique_lock, on a thread which is not running a task.
+  void wait_for_budget(std::unique_lock<Mutex>& lock);
+
+  // Expects tasks_mutex_ to be held.
+  inline void release_held_dependency(TaskId id);
+
+  // Releases the dependency held for a timed task at time, or starts a timer
+  // to. Expects tasks_mutex_ to be held.
+  void start_timer(TaskId id, Clock::Ticks time);
+
+  // Releases the timed tasks which are due. Expects tasks_mutex_ to be held.
+  inline void fire_due_timers();
+
+  // Adds the next run of a periodic task.
+  void schedule_periodic_run(PeriodicTaskId id);
+
+  // The closure of a periodic task's runs.
+  void run_periodic_task(PeriodicTaskId id);
+
+  // Parks the calling worker until a task is scheduled, the next timer is due
+  // or close(). Expects a locked unique_lock.
+  void park_worker(std::unique_lock<Mutex>& lock);
+
+  // The loop of an I/O pool thread; running_thread is its num_threads_ item.
+  void run_io_tasks(BlockingCounter::Item running_thread);
+
+  // Wakes an idle I/O thread for a newly scheduled I/O task, or starts one.
+  // Expects tasks_mutex_ to be held.
+  void wake_io_thread();
+
   // Moves a previously waiting task onto an appropriate scheduled task queue.
   inline void schedule(TaskId id, Task& task);
 
   // Pushes a task at the front of a TaskList (FIFO).
   inline void push_task(TaskId id, Task& task, TaskList& queue);
 
-  // Pops a task of a queue, removes it from the tasks_ vector and returns it.
-  inline Task pop_task(TaskList& queue);
+  // Pops a task of a queue and returns its id.
+  inline TaskId pop_task(TaskList& queue);
+
+  // Completes an ASYNC task: signals its dependents and erases it.
+  void complete_async_task(TaskId id);
+
+  // Creates ring_ and starts its completion thread, unless that was tried
+  // already. Returns whether ring_ exists.
+  bool ring_available();
+
+  // The closure of a read task submitted to ring_.
+  void submit_read(Read* read);
+
+  // Submits reads from ring_backlog_ while the ring has room. Expects
+  // ring_mutex_ to be held.
+  void submit_ring_backlog();
+
+  // The loop of the thread reaping ring_'s completions.
+  void run_ring_completions(BlockingCounter::Item running_thread);
 
-  // Runs a task and signals its dependents. Expects a locked unique_lock.
-  inline void run_task(Task&& task, std::unique_lock<Mutex>& lock);
+  // Sets the result of a read submitted to ring_, completes its task and
+  // deletes it.
+  void complete_ring_read(Read* read);
+
+  // A read on the calling thread, for the I/O pool; deletes read.
+  static void read_blocking(Read* read);
+
+  // Runs a task, signals its dependents and removes it from the tasks_
+  // vector. Until then, tasks can still be added which depend on it. Expects
+  // a locked unique_lock.
+  inline void run_task(TaskId id, std::unique_lock<Mutex>& lock);
+
+  // Resets the calling worker's scratch arena if an epoch ended since its
+  // last reset. Expects tasks_mutex_ to be held.
+  inline void reset_scratch_if_stale();
+
+  // Adds successor to the tasks which depend on task. Expects tasks_mutex_ to
+  // be held.
+  inline void add_successor(Task& task, TaskId successor);
 
   // Decrements the unmet dependencies counter of all the dependents of a task
   // and schedules and tasks whose counter is zero.
   inline void signal_dependents(Task& task);
 
+  // Decrements the unmet dependencies counter of a single dependent.
+  inline void signal_dependent(TaskId id);
+
   // Is a task list empty?
   static inline bool empty_task_list(const TaskList& list);
 
   // An id vector of all the added tasks (all the tasklists refer to elements
-  // in this vector).
+  // in this vector). Tasks are emplaced without holding tasks_mutex_, every
+  // other access happens under it.
   TaskIdVector tasks_;
 
-  // An id vector of all dependencies, the dependent list nodes are stored in
-  // this vector.
-  DependentIdVector dependents_;
+  // The spilled successors of all the tasks.
+  SuccessorBlockIdVector successor_blocks_;
 
   // The scheduled tasks with no affinity.
   TaskList global_task_queue_{INVALID_TASK, INVALID_TASK};
@@ -135,6 +443,45 @@ class Executor {
   // The scheduled tasks with affinities.
   TaskList affinity_task_queue_[MAX_THREADS];
 
+  // The timed tasks not yet due, in TIMER_RESOLUTION ticks of Clock time.
+  TimerWheel<TaskId> timers_;
+
+  PeriodicTaskIdVector periodic_tasks_;
+
+  // Idle workers park on this, with tasks_mutex_. At most one of them, the
+  // timer keeper, parks only until the next timer is due.
+  std::condition_variable_any work_available_;
+  size_t num_parked_workers_{0};
+  bool timer_keeper_parked_{false};
+  TimerWheel<TaskId>::Tick timer_keeper_wake_tick_{0};
+
+  // The scheduled I/O tasks.
+  TaskList io_task_queue_{INVALID_TASK, INVALID_TASK};
+
+  // Idle I/O threads wait on this, with tasks_mutex_.
+  std::condition_variable_any io_wakeup_;
+
+  size_t num_io_tasks_queued_{0};
+  size_t num_io_threads_{0};
+  size_t num_idle_io_threads_{0};
+  size_t max_io_threads_{DEFAULT_MAX_IO_THREADS};
+
+  // The io_uring of add_read_task(), created with the first read task; null
+  // if not available. ring_tried_ is protected by tasks_mutex_, the rest by
+  // ring_mutex_, which is a std::mutex because it is held across syscalls.
+  std::unique_ptr<IoRing> ring_;
+  bool ring_tried_{false};
+  std::mutex ring_mutex_;
+
+  // The reads waiting for room in ring_.
+  std::deque<Read*> ring_backlog_;
+  uint32_t ring_in_flight_{0};
+
+  // Set by close(); the completion thread then exits once ring_ is empty,
+  // setting ring_stopped_.
+  bool ring_closing_{false};
+  bool ring_stopped_{false};
+
   // [i] == true if there exists a thread which is currently running
   // run_tasks(i) i.e. handling tasks with affinity == i.
   bool thread_exists_for_affinity_[MAX_THREADS]{false};
@@ -146,6 +493,12 @@ class Executor {
   // task.
   TaskStamp next_stamp_{0};
 
+  size_t max_tasks_in_flight_{DEFAULT_MAX_TASKS_IN_FLIGHT};
+  TaskBudgetStats budget_stats_{};
+
+  // The number of add_epoch_task() tasks which have started.
+  uint64_t num_epochs_{0};
+
   // Number of threads which are inside a task loop currently.
   BlockingCounter num_threads_;
 
@@ -166,24 +519,163 @@ Executor::TaskId Executor::add_task(ClosureType&& closure,
                                     TaskIdFwdIter depends_begin,
                                     TaskIdFwdIter depends_end,
                                     ThreadId affinity) {
+  return add_task_impl(std::forward<ClosureType>(closure), depends_begin,
+                       depends_end, affinity, TaskKind::NORMAL);
+}
+
+template <typename ClosureType, typename TaskIdRange>
+inline Executor::TaskId Executor::add_epoch_task(ClosureType&& closure,
+                                                 const TaskIdRange& depends_on,
+                                                 ThreadId affinity) {
+  return add_epoch_task(std::forward<ClosureType>(closure), depends_on.begin(),
+                        depends_on.end(), affinity);
+}
+
+template <typename ClosureType, typename TaskIdFwdIter>
+Executor::TaskId Executor::add_epoch_task(ClosureType&& closure,
+                                          TaskIdFwdIter depends_begin,
+                                          TaskIdFwdIter depends_end,
+                                          ThreadId affinity) {
+  return add_task_impl(std::forward<ClosureType>(closure), depends_begin,
+                       depends_end, affinity, TaskKind::ENDS_EPOCH);
+}
+
+template <typename ClosureType, typename TaskIdRange>
+Executor::TaskId Executor::add_task_at(Clock::Ticks time,
+                                       ClosureType&& closure,
+                                       const TaskIdRange& depends_on,
+                                       ThreadId affinity) {
+  const TaskId task_id = add_task_impl(
+      std::forward<ClosureType>(closure), depends_on.begin(),
+      depends_on.end(), affinity, TaskKind::NORMAL, 1);
+  if (task_id == INVALID_TASK) return task_id;
+
+  std::lock_guard<Mutex> lock{tasks_mutex_};
+  start_timer(task_id, time);
+  return task_id;
+}
+
+template <typename ClosureType, typename TaskIdRange>
+inline Executor::TaskId Executor::add_task_after(
+    Clock::Ticks delay, ClosureType&& closure, const TaskIdRange& depends_on,
+    ThreadId affinity) {
+  return add_task_at(Clock::now() + delay, std::forward<ClosureType>(closure),
+                     depends_on, affinity);
+}
+
+template <typename ClosureType>
+Executor::PeriodicTaskId Executor::add_periodic_task(Clock::Ticks period,
+                                                     ClosureType&& closure,
+                                                     ThreadId affinity) {
+  DCHECK_GT(period, 0u);
+  PeriodicTaskId id;
+  {
+    std::lock_guard<Mutex> lock{tasks_mutex_};
+    CHECK_LT(periodic_tasks_.size(), size_t{PeriodicTaskIdVector::MAX_SIZE})
+        << "Too many periodic tasks.";
+    id = periodic_tasks_.emplace(std::forward<ClosureType>(closure), period,
+                                 Clock::now() + period, affinity);
+  }
+  schedule_periodic_run(id);
+  return id;
+}
+
+template <typename ClosureType, typename TaskIdRange>
+inline Executor::TaskId Executor::add_io_task(ClosureType&& closure,
+                                              const TaskIdRange& depends_on) {
+  return add_io_task(std::forward<ClosureType>(closure), depends_on.begin(),
+                     depends_on.end());
+}
+
+template <typename ClosureType, typename TaskIdFwdIter>
+Executor::TaskId Executor::add_io_task(ClosureType&& closure,
+                                       TaskIdFwdIter depends_begin,
+                                       TaskIdFwdIter depends_end) {
+  return add_task_impl(std::forward<ClosureType>(closure), depends_begin,
+                       depends_end, NO_AFFINITY, TaskKind::IO);
+}
+
+template <typename TaskIdRange>
+Executor::TaskId Executor::add_read_task(int fd, uint64_t offset,
+                                         size_t length, void* buffer,
+                                         int64_t* result,
+                                         const TaskIdRange& depends_on) {
+  Read* read = new Read{INVALID_TASK, fd, {}, static_cast<char*>(buffer),
+                        length, offset, result, 0};
+  TaskId task_id;
+  if (ring_available()) {
+    Executor* executor = this;
+    task_id = add_task_impl([executor, read] { executor->submit_read(read); },
+                            depends_on.begin(), depends_on.end(), NO_AFFINITY,
+                            TaskKind::ASYNC, 0, &read->task);
+  } else {
+    task_id = add_task_impl([read] { read_blocking(read); },
+                            depends_on.begin(), depends_on.end(), NO_AFFINITY,
+                            TaskKind::IO);
+  }
+  if (task_id == INVALID_TASK) delete read;
+  return task_id;
+}
+
+template <typename TaskIdRange>
+Executor::TaskId Executor::add_read_task(const std::string& path,
+                                         uint64_t offset, size_t length,
+                                         void* buffer, int64_t* result,
+                                         const TaskIdRange& depends_on) {
+  Read* read = new Read{INVALID_TASK, -1, path, static_cast<char*>(buffer),
+                        length, offset, result, 0};
+  const TaskId task_id = add_task_impl(
+      [read] { read_blocking(read); }, depends_on.begin(), depends_on.end(),
+      NO_AFFINITY, TaskKind::IO);
+  if (task_id == INVALID_TASK) delete read;
+  return task_id;
+}
+
+FrameArena& Executor::scratch() {
+  DCHECK(current_worker_ != nullptr)
+      << "Executor::scratch() called outside of a task.";
+  return current_worker_->scratch;
+}
+
+template <typename ClosureType, typename TaskIdFwdIter>
+Executor::TaskId Executor::add_task_impl(ClosureType&& closure,
+                                         TaskIdFwdIter depends_begin,
+                                         TaskIdFwdIter depends_end,
+                                         ThreadId affinity, TaskKind kind,
+                                         DependencyCount num_held,
+                                         TaskId* emplaced_id) {
   if (closed_) return INVALID_TASK;
 
   DCHECK(affinity == NO_AFFINITY || affinity <= MAX_THREADS)
       << "Invalid affinity: " << affinity;
 
-  std::lock_guard<Mutex> lock{tasks_mutex_};
-
-  TaskId new_task_id =
-      tasks_.emplace(std::forward<ClosureType>(closure), affinity);
+  // Constructing the task (and its closure) does not need the lock, only
+  // linking it into the dependency graph does.
+  TaskId new_task_id = tasks_.emplace(std::forward<ClosureType>(closure),
+                                      affinity, kind);
+  CHECK_NE(new_task_id, INVALID_TASK)
+      << "Too many tasks: " << TaskIdVector::MAX_SIZE;
+  if (emplaced_id) *emplaced_id = new_task_id;
   Task& new_task = tasks_[new_task_id];
+  new_task.num_unmet_dependencies = num_held;
+
+  std::unique_lock<Mutex> lock{tasks_mutex_};
+  // A running task holds its slot until it returns, so adds from inside one
+  // (on a worker or the I/O pool) overdraw the budget rather than wait: if
+  // every slot were held by such tasks, none could ever be freed.
+  if (budget_stats_.tasks_in_flight >= max_tasks_in_flight_ &&
+      current_worker_ == nullptr) {
+    wait_for_budget(lock);
+  }
+  if (++budget_stats_.tasks_in_flight > budget_stats_.peak_tasks_in_flight) {
+    budget_stats_.peak_tasks_in_flight = budget_stats_.tasks_in_flight;
+  }
 
   for (; depends_begin < depends_end; ++depends_begin) {
     TaskId dependency_id{*depends_begin};
     if (!tasks_.is_valid_id(dependency_id)) continue;
 
-    Task& dependency = tasks_[dependency_id];
-    dependency.first_dependent =
-        dependents_.emplace(new_task_id, dependency.first_dependent);
+    add_successor(tasks_[dependency_id], new_task_id);
     ++new_task.num_unmet_dependencies;
   }
 
@@ -196,11 +688,55 @@ inline void Executor::schedule(TaskId id, Task& task) {
   DCHECK_EQ(task.num_unmet_dependencies, 0);
 
   task.stamp = next_stamp_++;
-  if (task.affinity == NO_AFFINITY) {
+  if (task.kind == TaskKind::IO) {
+    push_task(id, task, io_task_queue_);
+    ++num_io_tasks_queued_;
+    wake_io_thread();
+  } else if (task.affinity == NO_AFFINITY) {
     push_task(id, task, global_task_queue_);
+    if (num_parked_workers_ > 0) work_available_.notify_one();
   } else {
     push_task(id, task, affinity_task_queue_[task.affinity]);
+    // Only the thread with that affinity can run it.
+    if (num_parked_workers_ > 0) work_available_.notify_all();
+  }
+}
+
+inline void Executor::release_held_dependency(TaskId id) {
+  Task& task = tasks_[id];
+  DCHECK_NE(task.num_unmet_dependencies, 0);
+  if (--task.num_unmet_dependencies == 0) schedule(id, task);
+}
+
+inline void Executor::fire_due_timers() {
+  if (timers_.empty()) return;
+  timers_.advance(Clock::now() / TIMER_RESOLUTION,
+                  [this](TaskId id) { release_held_dependency(id); });
+}
+
+inline void Executor::add_successor(Task& task, TaskId successor) {
+  DCHECK_LT(task.num_successors, std::numeric_limits<DependencyCount>::max());
+  const uint32_t i_successor = task.num_successors++;
+  if (i_successor < NUM_INLINE_SUCCESSORS) {
+    task.successors[i_successor] = successor;
+    return;
+  }
+
+  const uint32_t i_spilled =
+      (i_successor - NUM_INLINE_SUCCESSORS) % SuccessorBlock::SIZE;
+  if (i_spilled == 0) {
+    // emplace() only DCHECKs for room, so check here: the blocks are shared
+    // by all the tasks in flight.
+    CHECK_LT(successor_blocks_.size(),
+             size_t{SuccessorBlockIdVector::MAX_SIZE})
+        << "Too many spilled successors: "
+        << SuccessorBlockIdVector::MAX_SIZE * SuccessorBlock::SIZE
+        << " beyond the inline ones, across all tasks.";
+    task.spilled_successors =
+        successor_blocks_.emplace(task.spilled_successors);
   }
+  successor_blocks_[task.spilled_successors].successors[i_spilled] =
+      successor;
 }
 
 inline void Executor::push_task(TaskId id, Task& task, TaskList& queue) {
@@ -0,0 +1,381 @@
+#include "executor.hpp"
+#include "task_graph.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+namespace sparks {
+namespace {
+
+using TaskId = Executor::TaskId;
+
+// An Executor with state.range(0) worker threads. The benchmark thread only
+// submits tasks and waits for a sink task to call done().
+class ExecutorRunner {
+ public:
+  explicit ExecutorRunner(int num_threads) {
+    threads_.reserve(num_threads);
+    for (int i = 0; i < num_threads; ++i) {
+      threads_.emplace_back([this] { executor_.run_tasks_no_affinity(); });
+    }
+  }
+
+  ~ExecutorRunner() {
+    executor_.close_and_wait();
+    for (auto& thread : threads_) thread.join();
+  }
+
+  Executor& executor() { return executor_; }
+
+  void done() { done_.store(true, std::memory_order_release); }
+
+  void wait() {
+    while (!done_.load(std::memory_order_acquire)) std::this_thread::yield();
+    done_.store(false, std::memory_order_relaxed);
+  }
+
+ private:
+  Executor executor_;
+  std::vector<std::thread> threads_;
+  std::atomic<bool> done_{false};
+};
+
+void burn(int64_t iterations) {
+  for (int64_t i = 0; i < iterations; ++i) benchmark::DoNotOptimize(i);
+}
+
+const int64_t TASK_WORK = 256;
+
+// Arguments: {threads}.
+void thread_sweep(benchmark::internal::Benchmark* bench) {
+  bench->ArgName("threads")->UseRealTime();
+  for (int64_t num_threads = 1; num_threads <= 8; num_threads *= 2) {
+    bench->Arg(num_threads);
+  }
+}
+
+// The frame graph from test.cpp, one frame per iteration.
+void BM_ExecutorFrameDag(benchmark::State& state) {
+  ExecutorRunner runner{static_cast<int>(state.range(0))};
+  Executor& executor = runner.executor();
+  ExecutorRunner* r = &runner;
+  const auto work = [] { burn(TASK_WORK); };
+
+  for (auto _ : state) {
+    TaskId frame_start = executor.add_task([] {});
+    TaskId scene = executor.add_task(work, {frame_start});
+    TaskId anim = executor.add_task(work, {scene});
+    TaskId ai = executor.add_task(work, {frame_start});
+    TaskId ctrl = executor.add_task(work, {frame_start});
+    TaskId gameplay = executor.add_task(work, {scene, anim, ai, ctrl});
+    TaskId audio = executor.add_task(work, {gameplay});
+    TaskId gui = executor.add_task(work, {frame_start});
+    TaskId render_start =
+        executor.add_task([] {}, {scene, anim, gui, gameplay});
+    TaskId render_end = executor.add_task([] {}, {
+        executor.add_task(work, {render_start}),
+        executor.add_task(work, {render_start}),
+        executor.add_task(work, {render_start}),
+        executor.add_task(work, {render_start})});
+    executor.add_task([r] { r->done(); },
+                      {frame_start, scene, anim, ai, ctrl, gameplay, audio,
+                       gui, render_start, render_end});
+    runner.wait();
+  }
+}
+BENCHMARK(BM_ExecutorFrameDag)->Apply(thread_sweep);
+
+// The same frame graph recorded once in a TaskGraph and submitted every
+// iteration, with state.range(1) selecting whether it is optimized. The sink
+// depends on every task, so there are no chains to fuse here; the frame_start
+// and render_end joins are elided, render_start is too wide to be.
+void BM_TaskGraphFrameDag(benchmark::State& state) {
+  ExecutorRunner runner{static_cast<int>(state.range(0))};
+  ExecutorRunner* r = &runner;
+  const auto work = [] { burn(TASK_WORK); };
+
+  TaskGraph graph;
+  const auto frame_start = graph.add_join({});
+  const auto scene = graph.add_node(work, {frame_start});
+  const auto anim = graph.add_node(work, {scene});
+  const auto ai = graph.add_node(work, {frame_start});
+  const auto ctrl = graph.add_node(work, {frame_start});
+  const auto gameplay = graph.add_node(work, {scene, anim, ai, ctrl});
+  const auto audio = graph.add_node(work, {gameplay});
+  const auto gui = graph.add_node(work, {frame_start});
+  const auto render_start = graph.add_join({scene, anim, gui, gameplay});
+  const auto render_end = graph.add_join({
+      graph.add_node(work, {render_start}),
+      graph.add_node(work, {render_start}),
+      graph.add_node(work, {render_start}),
+      graph.add_node(work, {render_start})});
+  graph.add_node([r] { r->done(); },
+                 {frame_start, scene, anim, ai, ctrl, gameplay, audio, gui,
+                  render_start, render_end});
+  if (state.range(1)) graph.optimize();
+
+  for (auto _ : state) {
+    graph.submit(runner.executor());
+    runner.wait();
+  }
+  state.counters["tasks_per_frame"] = graph.num_tasks();
+  state.counters["edges_per_frame"] = graph.num_dependencies();
+}
+BENCHMARK(BM_TaskGraphFrameDag)
+    ->ArgNames({"threads", "optimized"})
+    ->UseRealTime()
+    ->Args({1, 0})->Args({1, 1})
+    ->Args({2, 0})->Args({2, 1})
+    ->Args({4, 0})->Args({4, 1})
+    ->Args({8, 0})->Args({8, 1});
+
+// The 40x40x40 fork tree from scheduler_sandbox.cpp: tasks add their children
+// from inside their closures.
+const int FORK_FANOUT = 40;
+
+struct ForkTree {
+  Executor* executor;
+  ExecutorRunner* runner;
+  std::atomic<int> leaves_left;
+};
+
+void BM_ExecutorForkTree(benchmark::State& state) {
+  ExecutorRunner runner{static_cast<int>(state.range(0))};
+  ForkTree tree;
+  tree.executor = &runner.executor();
+  tree.runner = &runner;
+  ForkTree* t = &tree;
+
+  for (auto _ : state) {
+    tree.leaves_left.store(FORK_FANOUT * FORK_FANOUT * FORK_FANOUT);
+    for (int i = 0; i < FORK_FANOUT; ++i) {
+      tree.executor->add_task([t] {
+        for (int j = 0; j < FORK_FANOUT; ++j) {
+          t->executor->add_task([t] {
+            for (int k = 0; k < FORK_FANOUT; ++k) {
+              t->executor->add_task([t] {
+                burn(TASK_WORK);
+                if (t->leaves_left.fetch_sub(1) == 1) t->runner->done();
+              });
+            }
+          });
+        }
+      });
+    }
+    runner.wait();
+  }
+  state.SetItemsProcessed(
+      state.iterations() * FORK_FANOUT * FORK_FANOUT * FORK_FANOUT);
+}
+BENCHMARK(BM_ExecutorForkTree)->Apply(thread_sweep);
+
+// A chain where each task depends on the previous one, all added up front.
+const int CHAIN_LENGTH = 1024;
+
+void BM_ExecutorChain(benchmark::State& state) {
+  ExecutorRunner runner{static_cast<int>(state.range(0))};
+  Executor& executor = runner.executor();
+  ExecutorRunner* r = &runner;
+
+  for (auto _ : state) {
+    TaskId previous = executor.add_task([] { burn(TASK_WORK); });
+    for (int i = 1; i < CHAIN_LENGTH; ++i) {
+      previous = executor.add_task([] { burn(TASK_WORK); }, {previous});
+    }
+    executor.add_task([r] { r->done(); }, {previous});
+    runner.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * CHAIN_LENGTH);
+}
+BENCHMARK(BM_ExecutorChain)->Apply(thread_sweep);
+
+// One root, FAN_WIDTH tasks depending on it and a sink depending on them all.
+const int FAN_WIDTH = 1024;
+
+void BM_ExecutorFanOutFanIn(benchmark::State& state) {
+  ExecutorRunner runner{static_cast<int>(state.range(0))};
+  Executor& executor = runner.executor();
+  ExecutorRunner* r = &runner;
+  std::vector<TaskId> fan(FAN_WIDTH);
+
+  for (auto _ : state) {
+    TaskId root = executor.add_task([] {});
+    for (auto& id : fan) id = executor.add_task([] { burn(TASK_WORK); }, {root});
+    executor.add_task([r] { r->done(); }, fan);
+    runner.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * FAN_WIDTH);
+}
+BENCHMARK(BM_ExecutorFanOutFanIn)->Apply(thread_sweep);
+
+// FAN_WIDTH independent tasks with empty closures: measures per-task overhead.
+void BM_ExecutorEmptyTasks(benchmark::State& state) {
+  ExecutorRunner runner{static_cast<int>(state.range(0))};
+  Executor& executor = runner.executor();
+  ExecutorRunner* r = &runner;
+  std::vector<TaskId> empty(FAN_WIDTH);
+
+  for (auto _ : state) {
+    for (auto& id : empty) id = executor.add_task([] {});
+    executor.add_task([r] { r->done(); }, empty);
+    runner.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * FAN_WIDTH);
+}
+BENCHMARK(BM_ExecutorEmptyTasks)->Apply(thread_sweep);
+
+// Layers of LAYER_WIDTH empty tasks, each depending on state.range(1) tasks of
+// the layer before: measures the cost of adding and signalling dependency
+// edges.
+const int LAYER_WIDTH = 64;
+const int NUM_LAYERS = 16;
+
+void BM_ExecutorDependencyEdges(benchmark::State& state) {
+  ExecutorRunner runner{static_cast<int>(state.range(0))};
+  Executor& executor = runner.executor();
+  ExecutorRunner* r = &runner;
+  const int num_dependencies = static_cast<int>(state.range(1));
+  std::vector<TaskId> layer(LAYER_WIDTH), next_layer(LAYER_WIDTH);
+  std::vector<TaskId> depends_on(num_dependencies);
+
+  for (auto _ : state) {
+    for (auto& id : layer) id = executor.add_task([] {});
+    for (int i_layer = 1; i_layer < NUM_LAYERS; ++i_layer) {
+      for (int i = 0; i < LAYER_WIDTH; ++i) {
+        for (int j = 0; j < num_dependencies; ++j) {
+          depends_on[j] = layer[(i + j) % LAYER_WIDTH];
+        }
+        next_layer[i] = executor.add_task([] {}, depends_on);
+      }
+      layer.swap(next_layer);
+    }
+    executor.add_task([r] { r->done(); }, layer);
+    runner.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * (NUM_LAYERS - 1) *
+                          LAYER_WIDTH * num_dependencies);
+}
+BENCHMARK(BM_ExecutorDependencyEdges)
+    ->ArgNames({"threads", "dependencies"})
+    ->UseRealTime()
+    ->Args({1, 1})->Args({1, 4})->Args({1, 16})
+    ->Args({4, 1})->Args({4, 4})->Args({4, 16});
+
+// A producer adding OVERLOAD_TASKS tasks as fast as it can, with an in-flight
+// budget of state.range(1) tasks (0 for the default, half the task ids).
+const int OVERLOAD_TASKS = 65536;
+
+void BM_ExecutorOverload(benchmark::State& state) {
+  ExecutorRunner runner{static_cast<int>(state.range(0))};
+  Executor& executor = runner.executor();
+  if (state.range(1) > 0) executor.set_max_tasks_in_flight(state.range(1));
+  std::atomic<int> tasks_left{0};
+  ExecutorRunner* r = &runner;
+  std::atomic<int>* left = &tasks_left;
+
+  for (auto _ : state) {
+    tasks_left.store(OVERLOAD_TASKS);
+    for (int i = 0; i < OVERLOAD_TASKS; ++i) {
+      executor.add_task([r, left] {
+        burn(TASK_WORK);
+        if (left->fetch_sub(1) == 1) r->done();
+      });
+    }
+    runner.wait();
+  }
+
+  const TaskBudgetStats stats = executor.task_budget_stats();
+  state.counters["peak_in_flight"] = stats.peak_tasks_in_flight;
+  state.counters["helped"] = benchmark::Counter(
+      stats.helped_tasks, benchmark::Counter::kAvgIterations);
+  state.counters["max_throttled_ms"] =
+      Clock::to_milliseconds(stats.max_throttled_ticks);
+  state.SetItemsProcessed(state.iterations() * OVERLOAD_TASKS);
+}
+BENCHMARK(BM_ExecutorOverload)
+    ->ArgNames({"threads", "budget"})
+    ->UseRealTime()
+    ->Args({1, 0})->Args({1, 64})->Args({1, 1024})
+    ->Args({4, 0})->Args({4, 64})->Args({4, 1024});
+
+// NUM_READS reads of READ_SIZE bytes from a file (in the page cache after the
+// first iteration) per iteration, then a sink depending on all of them.
+const int NUM_READS = 1024;
+const size_t READ_SIZE = 4096;
+
+class ReadFile {
+ public:
+  ReadFile() {
+    char path[] = "/tmp/executor_benchmark_XXXXXX";
+    fd_ = mkstemp(path);
+    CHECK_GE(fd_, 0);
+    unlink(path);
+    const std::vector<char> data(NUM_READS * READ_SIZE, 'x');
+    CHECK_EQ(write(fd_, data.data(), data.size()),
+             static_cast<ssize_t>(data.size()));
+  }
+
+  ~ReadFile() { close(fd_); }
+
+  int fd() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+// Through add_read_task(): io_uring, where available.
+void BM_ExecutorReadTasks(benchmark::State& state) {
+  ExecutorRunner runner{static_cast<int>(state.range(0))};
+  Executor& executor = runner.executor();
+  ExecutorRunner* r = &runner;
+  ReadFile file;
+  std::vector<char> buffer(NUM_READS * READ_SIZE);
+  std::vector<TaskId> reads(NUM_READS);
+
+  for (auto _ : state) {
+    for (int i = 0; i < NUM_READS; ++i) {
+      reads[i] = executor.add_read_task(file.fd(), i * READ_SIZE, READ_SIZE,
+                                        &buffer[i * READ_SIZE]);
+    }
+    executor.add_task([r] { r->done(); }, reads);
+    runner.wait();
+  }
+  state.SetBytesProcessed(state.iterations() * NUM_READS * READ_SIZE);
+}
+BENCHMARK(BM_ExecutorReadTasks)->Apply(thread_sweep);
+
+// The same reads as blocking pread()s on the I/O pool.
+void BM_ExecutorIoTaskPreads(benchmark::State& state) {
+  ExecutorRunner runner{static_cast<int>(state.range(0))};
+  Executor& executor = runner.executor();
+  ExecutorRunner* r = &runner;
+  ReadFile file;
+  std::vector<char> buffer(NUM_READS * READ_SIZE);
+  std::vector<TaskId> reads(NUM_READS);
+
+  for (auto _ : state) {
+    for (int i = 0; i < NUM_READS; ++i) {
+      const int fd = file.fd();
+      char* destination = &buffer[i * READ_SIZE];
+      const off_t offset = i * READ_SIZE;
+      reads[i] = executor.add_io_task([fd, destination, offset] {
+        benchmark::DoNotOptimize(pread(fd, destination, READ_SIZE, offset));
+      });
+    }
+    executor.add_task([r] { r->done(); }, reads);
+    runner.wait();
+  }
+  state.SetBytesProcessed(state.iterations() * NUM_READS * READ_SIZE);
+}
+BENCHMARK(BM_ExecutorIoTaskPreads)->Apply(thread_sweep);
+
+}  // namespace
+}  // namespace sparks
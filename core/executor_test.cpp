@@ -0,0 +1,525 @@
+#include "executor.hpp"
+#include "executor_test_util.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+// close_and_wait() may come before, while or after the workers enter
+// run_tasks_*(); either way it must neither abort nor hang.
+TEST(ExecutorTest, CloseWhileWorkersStart) {
+  for (int i = 0; i < 1000; ++i) {
+    Executor executor;
+    std::thread with_affinity{[&executor] {
+      executor.run_tasks_with_affinity(0);
+    }};
+    { ExecutorThreads threads{executor, 2}; }
+    with_affinity.join();
+  }
+}
+
+// A producer thread adding tasks beyond the budget waits for room, helping
+// with the queued tasks meanwhile, and never exceeds the budget itself.
+TEST(ExecutorTest, AddsBeyondTheBudgetAreThrottled) {
+  const int NUM_TASKS = 1000;
+  const size_t MAX_IN_FLIGHT = 8;
+  Executor executor;
+  executor.set_max_tasks_in_flight(MAX_IN_FLIGHT);
+  std::atomic<int> num_done{0};
+  {
+    ExecutorThreads threads{executor, 1};
+    for (int i = 0; i < NUM_TASKS; ++i) {
+      executor.add_task([&num_done] {
+        std::this_thread::yield();
+        num_done.fetch_add(1);
+      });
+    }
+    ASSERT_TRUE(wait_until_idle(executor));
+    EXPECT_EQ(NUM_TASKS, num_done.load());
+
+    const TaskBudgetStats stats = executor.task_budget_stats();
+    EXPECT_EQ(MAX_IN_FLIGHT, stats.peak_tasks_in_flight);
+    EXPECT_GT(stats.throttled_adds, 0u);
+    EXPECT_LE(stats.throttled_adds, uint64_t{NUM_TASKS});
+    EXPECT_GE(stats.throttled_ticks, stats.max_throttled_ticks);
+  }
+}
+
+// A throttled producer with no worker to run its tasks runs them itself.
+TEST(ExecutorTest, ThrottledProducerHelpsWithoutWorkers) {
+  const int NUM_TASKS = 100;
+  Executor executor;
+  executor.set_max_tasks_in_flight(4);
+  std::atomic<int> num_done{0};
+  for (int i = 0; i < NUM_TASKS; ++i) {
+    executor.add_task([&num_done] { num_done.fetch_add(1); });
+  }
+
+  const TaskBudgetStats stats = executor.task_budget_stats();
+  EXPECT_EQ(4u, stats.tasks_in_flight);
+  EXPECT_EQ(uint64_t{NUM_TASKS - 4}, stats.throttled_adds);
+  EXPECT_EQ(uint64_t{NUM_TASKS - 4}, stats.helped_tasks);
+  EXPECT_EQ(NUM_TASKS - 4, num_done.load());
+  executor.close_and_wait();
+}
+
+// Every slot of the budget is held by a running task which adds another: the
+// adds must overdraw the budget rather than wait for slots which only free up
+// once they return.
+TEST(ExecutorTest, NestedAddsOverdrawTheBudget) {
+  const int NUM_CHILDREN = 4;
+  Executor executor;
+  executor.set_max_tasks_in_flight(1);
+  std::atomic<int> num_children_done{0};
+  {
+    ExecutorThreads threads{executor, 1};
+    Executor* const executor_ptr = &executor;
+    std::atomic<int>* const num_done = &num_children_done;
+    executor.add_task([executor_ptr, num_done] {
+      for (int i = 0; i < NUM_CHILDREN; ++i) {
+        executor_ptr->add_task([num_done] { num_done->fetch_add(1); });
+      }
+    });
+    ASSERT_TRUE(wait_until_idle(executor))
+        << "children done: " << num_children_done.load();
+    EXPECT_EQ(NUM_CHILDREN, num_children_done.load());
+
+    const TaskBudgetStats stats = executor.task_budget_stats();
+    EXPECT_EQ(size_t{NUM_CHILDREN + 1}, stats.peak_tasks_in_flight);
+    EXPECT_EQ(0u, stats.throttled_adds);
+  }
+}
+
+// A timed task never runs before its time.
+TEST(ExecutorTest, TimedTasksRunAfterTheirDelay) {
+  const Clock::Ticks DELAY = Clock::TICKS_PER_SECOND / 500;
+  Executor executor;
+  ExecutorThreads threads{executor, 1};
+  std::atomic<Clock::Ticks> ran_at{0};
+  std::atomic<Clock::Ticks>* const ran_at_ptr = &ran_at;
+  const Clock::Ticks added_at = Clock::now();
+  executor.add_task_after(DELAY, [ran_at_ptr] { *ran_at_ptr = Clock::now(); });
+  ASSERT_TRUE(wait_until_idle(executor));
+  EXPECT_GE(ran_at.load(), added_at + DELAY);
+}
+
+// A periodic task re-arms itself from its run, which overdraws a budget of
+// one rather than waiting for its own slot; once cancelled, it frees the
+// slot for other tasks.
+TEST(ExecutorTest, PeriodicTaskRearmsUnderTheBudget) {
+  Executor executor;
+  executor.set_max_tasks_in_flight(1);
+  ExecutorThreads threads{executor, 1};
+  std::atomic<int> num_runs{0};
+  std::atomic<int>* const num_runs_ptr = &num_runs;
+  const auto periodic = executor.add_periodic_task(
+      Clock::TICKS_PER_SECOND / 1000, [num_runs_ptr] { ++*num_runs_ptr; });
+  ASSERT_TRUE(wait_until([&num_runs] { return num_runs.load() >= 5; }));
+
+  executor.cancel_periodic_task(periodic);
+  ASSERT_TRUE(wait_until_idle(executor));
+  const int num_cancelled_runs = num_runs.load();
+
+  std::atomic<bool> ran{false};
+  std::atomic<bool>* const ran_ptr = &ran;
+  executor.add_task([ran_ptr] { *ran_ptr = true; });
+  ASSERT_TRUE(wait_until_idle(executor));
+  EXPECT_TRUE(ran.load());
+  EXPECT_EQ(num_cancelled_runs, num_runs.load());
+
+  const TaskBudgetStats stats = executor.task_budget_stats();
+  EXPECT_EQ(2u, stats.peak_tasks_in_flight);
+  EXPECT_EQ(0u, stats.throttled_adds);
+}
+
+// Records, per worker thread and frame, how many scratch bytes each task
+// found allocated before making its own allocation.
+struct ScratchLog {
+  static const size_t ALLOCATION_SIZE = 64;
+
+  struct Entry {
+    std::thread::id thread;
+    int frame;
+    size_t bytes_before;
+  };
+
+  void add(int frame) {
+    FrameArena& scratch = Executor::scratch();
+    const size_t bytes_before = scratch.bytes_allocated();
+    scratch.allocate(ALLOCATION_SIZE);
+    std::lock_guard<std::mutex> lock{mutex};
+    entries.push_back({std::this_thread::get_id(), frame, bytes_before});
+  }
+
+  Executor* executor;
+  std::mutex mutex;
+  std::vector<Entry> entries;
+};
+
+const int NUM_FRAMES = 20;
+const int NUM_FRAME_TASKS = 50;
+
+// Adds a frame's tasks and the epoch task ending it, which adds the next
+// frame like test.cpp does.
+void add_frame(ScratchLog* log, int frame) {
+  std::vector<Executor::TaskId> tasks;
+  for (int i = 0; i < NUM_FRAME_TASKS; ++i) {
+    tasks.push_back(log->executor->add_task([log, frame] { log->add(frame); }));
+  }
+  log->executor->add_epoch_task(
+      [log, frame] {
+        log->add(frame + 1);
+        if (frame + 1 < NUM_FRAMES) add_frame(log, frame + 1);
+      },
+      tasks.begin(), tasks.end());
+}
+
+// Every worker starts each frame, including the epoch task's closure which
+// begins it, with an empty scratch arena, and keeps allocating from it for
+// the rest of the frame.
+TEST(ExecutorTest, EpochTasksResetEveryWorkersScratch) {
+  Executor executor;
+  ScratchLog log;
+  log.executor = &executor;
+  {
+    ExecutorThreads threads{executor, 3};
+    add_frame(&log, 0);
+    ASSERT_TRUE(wait_until_idle(executor));
+  }
+
+  std::map<std::pair<std::thread::id, int>, size_t> bytes_expected;
+  std::set<int> frames;
+  for (const ScratchLog::Entry& entry : log.entries) {
+    size_t& expected =
+        bytes_expected[std::make_pair(entry.thread, entry.frame)];
+    EXPECT_EQ(expected, entry.bytes_before) << "frame " << entry.frame;
+    expected = entry.bytes_before + ScratchLog::ALLOCATION_SIZE;
+    frames.insert(entry.frame);
+  }
+  EXPECT_EQ(size_t{NUM_FRAMES + 1}, frames.size());
+  EXPECT_EQ(size_t{NUM_FRAMES * (NUM_FRAME_TASKS + 1)}, log.entries.size());
+}
+
+// A task which waits for a flag, so that successors can be added to it
+// before it completes.
+struct Blocker {
+  void operator()() const {
+    const std::atomic<bool>* const flag = released;
+    wait_until([flag] { return flag->load(); });
+  }
+
+  const std::atomic<bool>* released;
+};
+
+// Successors beyond the inline ones spill into blocks of 14: every one of
+// them runs, once, after the task, and the blocks are freed again (there is
+// room for 4095 blocks, fewer than all the rounds together take).
+TEST(ExecutorTest, SpilledSuccessorsRunAfterTheirTask) {
+  Executor executor;
+  ExecutorThreads threads{executor, 2};
+  for (int num_successors : {0, 1, 4, 5, 17, 18, 19, 32, 33, 1000}) {
+    for (int round = 0; round < (num_successors == 1000 ? 100 : 1); ++round) {
+      std::atomic<bool> released{false};
+      std::atomic<int> num_early{0}, num_done{0};
+      const auto blocker = executor.add_task(Blocker{&released});
+      const std::atomic<bool>* const released_ptr = &released;
+      std::atomic<int>* const num_early_ptr = &num_early;
+      std::atomic<int>* const num_done_ptr = &num_done;
+      for (int i = 0; i < num_successors; ++i) {
+        executor.add_task(
+            [released_ptr, num_early_ptr, num_done_ptr] {
+              if (!released_ptr->load()) ++*num_early_ptr;
+              ++*num_done_ptr;
+            },
+            {blocker});
+      }
+      EXPECT_EQ(0, num_done.load());
+      released = true;
+      ASSERT_TRUE(wait_until_idle(executor)) << num_successors;
+      EXPECT_EQ(num_successors, num_done.load());
+      EXPECT_EQ(0, num_early.load());
+    }
+  }
+}
+
+// The spilled successors of several tasks interleave in the shared blocks,
+// and some successors depend on several of those tasks.
+TEST(ExecutorTest, SpilledSuccessorsOfSeveralTasks) {
+  const int NUM_BLOCKERS = 4;
+  const int NUM_SUCCESSORS = 100;
+  Executor executor;
+  ExecutorThreads threads{executor, NUM_BLOCKERS + 1};
+  std::atomic<bool> released[NUM_BLOCKERS];
+  Executor::TaskId blockers[NUM_BLOCKERS];
+  for (int i = 0; i < NUM_BLOCKERS; ++i) {
+    released[i] = false;
+    blockers[i] = executor.add_task(Blocker{&released[i]});
+  }
+
+  // Successor i depends on blocker i % 4 (listed twice for even i) and, for
+  // odd i, on (i + 1) % 4 too; it counts as early if one of those hasn't been
+  // released yet.
+  std::atomic<int> num_early{0}, num_done{0};
+  for (int i = 0; i < NUM_SUCCESSORS; ++i) {
+    const int first = i % NUM_BLOCKERS;
+    const int second = i % 2 ? (i + 1) % NUM_BLOCKERS : first;
+    const std::atomic<bool>* const first_released = &released[first];
+    const std::atomic<bool>* const second_released = &released[second];
+    std::atomic<int>* const num_early_ptr = &num_early;
+    executor.add_task(
+        [first_released, second_released, num_early_ptr] {
+          if (!first_released->load() || !second_released->load()) {
+            ++*num_early_ptr;
+          }
+        },
+        {blockers[first], blockers[second]});
+    std::atomic<int>* const num_done_ptr = &num_done;
+    executor.add_task([num_done_ptr] { ++*num_done_ptr; }, {blockers[first]});
+  }
+
+  // Released one by one, so that a successor scheduled too early gets to run
+  // (and be counted) while one of its blockers still holds.
+  for (int i = NUM_BLOCKERS - 1; i >= 0; --i) {
+    released[i] = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_TRUE(wait_until_idle(executor));
+  EXPECT_EQ(0, num_early.load());
+  EXPECT_EQ(NUM_SUCCESSORS, num_done.load());
+}
+
+// Records the threads which ran I/O tasks.
+struct IoThreadLog {
+  void add() {
+    std::lock_guard<std::mutex> lock{mutex};
+    threads.insert(std::this_thread::get_id());
+  }
+
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+};
+
+// I/O tasks never run on the run_tasks_*() workers, and depend on and signal
+// other tasks like any task.
+TEST(ExecutorTest, IoTasksRunOnTheirOwnThreads) {
+  const int NUM_IO_TASKS = 20;
+  Executor executor;
+  std::vector<std::thread> workers;
+  std::set<std::thread::id> worker_ids;
+  for (int i = 0; i < 2; ++i) {
+    workers.emplace_back([&executor] { executor.run_tasks_no_affinity(); });
+    worker_ids.insert(workers.back().get_id());
+  }
+
+  TaskLog log;
+  IoThreadLog io_threads;
+  TaskLog* const log_ptr = &log;
+  IoThreadLog* const io_threads_ptr = &io_threads;
+  const auto before = executor.add_task(Logged{&log, 0});
+  std::vector<Executor::TaskId> io_tasks;
+  for (int i = 1; i <= NUM_IO_TASKS; ++i) {
+    io_tasks.push_back(executor.add_io_task(
+        [log_ptr, io_threads_ptr, i] {
+          log_ptr->start(i);
+          io_threads_ptr->add();
+          log_ptr->end(i);
+        },
+        {before}));
+  }
+  executor.add_task(Logged{&log, NUM_IO_TASKS + 1}, io_tasks.begin(),
+                    io_tasks.end());
+  ASSERT_TRUE(wait_until_idle(executor));
+  executor.close_and_wait();
+  for (auto& worker : workers) worker.join();
+
+  for (int i = 1; i <= NUM_IO_TASKS; ++i) {
+    EXPECT_TRUE(log.ended_before(0, i)) << i;
+    EXPECT_TRUE(log.ended_before(i, NUM_IO_TASKS + 1)) << i;
+  }
+  EXPECT_FALSE(io_threads.threads.empty());
+  for (const auto& id : io_threads.threads) EXPECT_EQ(0u, worker_ids.count(id));
+}
+
+// The pool grows with blocked I/O tasks up to max_io_threads(), and its
+// threads exit once they have been idle for two seconds.
+TEST(ExecutorTest, IoPoolGrowsToItsLimitAndShrinks) {
+  const int NUM_IO_TASKS = 10;
+  Executor executor;
+  executor.set_max_io_threads(3);
+  EXPECT_EQ(3u, executor.max_io_threads());
+
+  std::atomic<bool> released{false};
+  std::atomic<int> num_started{0};
+  const std::atomic<bool>* const released_ptr = &released;
+  std::atomic<int>* const num_started_ptr = &num_started;
+  for (int i = 0; i < NUM_IO_TASKS; ++i) {
+    executor.add_io_task([released_ptr, num_started_ptr] {
+      ++*num_started_ptr;
+      Blocker{released_ptr}();
+    });
+  }
+  ASSERT_TRUE(wait_until([&num_started] { return num_started == 3; }));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(3, num_started.load());
+  EXPECT_EQ(3u, executor.num_io_threads());
+
+  released = true;
+  ASSERT_TRUE(wait_until_idle(executor));
+  EXPECT_EQ(NUM_IO_TASKS, num_started.load());
+  EXPECT_TRUE(wait_until([&executor] {
+    return executor.num_io_threads() == 0;
+  }));
+
+  // And grows again.
+  executor.add_io_task([num_started_ptr] { ++*num_started_ptr; });
+  ASSERT_TRUE(wait_until_idle(executor));
+  EXPECT_EQ(NUM_IO_TASKS + 1, num_started.load());
+  EXPECT_EQ(1u, executor.num_io_threads());
+}
+
+// close_and_wait() waits for the running I/O task, and no queued one starts
+// after close().
+TEST(ExecutorTest, CloseWithIoTasksQueuedAndRunning) {
+  Executor executor;
+  executor.set_max_io_threads(1);
+  std::atomic<bool> released{false};
+  std::atomic<int> num_started{0};
+  std::atomic<int> num_finished{0};
+  const std::atomic<bool>* const released_ptr = &released;
+  std::atomic<int>* const num_started_ptr = &num_started;
+  std::atomic<int>* const num_finished_ptr = &num_finished;
+  for (int i = 0; i < 4; ++i) {
+    executor.add_io_task([released_ptr, num_started_ptr, num_finished_ptr] {
+      ++*num_started_ptr;
+      Blocker{released_ptr}();
+      ++*num_finished_ptr;
+    });
+  }
+  ASSERT_TRUE(wait_until([&num_started] { return num_started == 1; }));
+
+  std::thread releaser{[&released] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    released = true;
+  }};
+  executor.close_and_wait();
+  EXPECT_EQ(1, num_started.load());
+  EXPECT_EQ(1, num_finished.load());
+  releaser.join();
+}
+
+// Reads of a temporary file of FILE_SIZE bytes, byte i being i % 251, with
+// a few workers running.
+class ReadTaskTest : public ::testing::Test {
+ protected:
+  static const size_t FILE_SIZE = 100000;
+
+  ReadTaskTest() : threads_{executor_, 2} {}
+
+  void SetUp() override {
+    char path[] = "/tmp/sparks_read_task_test.XXXXXX";
+    fd_ = mkstemp(path);
+    ASSERT_GE(fd_, 0) << std::strerror(errno);
+    path_ = path;
+    std::vector<char> contents(FILE_SIZE);
+    for (size_t i = 0; i < FILE_SIZE; ++i) contents[i] = byte_at(i);
+    ASSERT_EQ(static_cast<ssize_t>(FILE_SIZE),
+              write(fd_, contents.data(), FILE_SIZE));
+  }
+
+  void TearDown() override {
+    if (fd_ >= 0) ::close(fd_);
+    if (!path_.empty()) unlink(path_.c_str());
+  }
+
+  static char byte_at(size_t offset) {
+    return static_cast<char>(offset % 251);
+  }
+
+  // Reads by fd (through the io_uring where available) or by path (on the
+  // I/O pool) and returns the result a dependent task saw.
+  int64_t read(bool by_path, uint64_t offset, std::vector<char>& buffer) {
+    int64_t result = -1;
+    const auto task =
+        by_path ? executor_.add_read_task(path_, offset, buffer.size(),
+                                          buffer.data(), &result)
+                : executor_.add_read_task(fd_, offset, buffer.size(),
+                                          buffer.data(), &result);
+    std::atomic<int64_t> seen{-1};
+    std::atomic<int64_t>* const seen_ptr = &seen;
+    const int64_t* const result_ptr = &result;
+    executor_.add_task([seen_ptr, result_ptr] { *seen_ptr = *result_ptr; },
+                       {task});
+    EXPECT_TRUE(wait_until_idle(executor_));
+    EXPECT_EQ(result, seen.load());
+    return result;
+  }
+
+  Executor executor_;
+  ExecutorThreads threads_;
+  int fd_{-1};
+  std::string path_;
+};
+
+// Reads come back in full, and short only at the end of the file.
+TEST_F(ReadTaskTest, ReadsAreShortOnlyAtTheEnd) {
+  struct Case {
+    uint64_t offset;
+    size_t length;
+    int64_t num_read;
+  };
+  const Case cases[] = {{0, FILE_SIZE, FILE_SIZE},
+                        {1000, 5000, 5000},
+                        {FILE_SIZE - 10, 100, 10},
+                        {FILE_SIZE, 100, 0},
+                        {FILE_SIZE + 5, 100, 0}};
+  for (bool by_path : {false, true}) {
+    for (const Case& c : cases) {
+      std::vector<char> buffer(c.length);
+      ASSERT_EQ(c.num_read, read(by_path, c.offset, buffer))
+          << "by_path: " << by_path << ", offset: " << c.offset;
+      int num_wrong = 0;
+      for (int64_t i = 0; i < c.num_read; ++i) {
+        if (buffer[i] != byte_at(c.offset + i)) ++num_wrong;
+      }
+      EXPECT_EQ(0, num_wrong) << "by_path: " << by_path
+                              << ", offset: " << c.offset;
+    }
+  }
+}
+
+// Failed reads set -errno, be it from open() or from the read itself.
+TEST_F(ReadTaskTest, FailedReadsSetMinusErrno) {
+  const int directory = open("/tmp", O_RDONLY | O_DIRECTORY);
+  ASSERT_GE(directory, 0);
+  char buffers[3][16];
+  int64_t results[3] = {0, 0, 0};
+  executor_.add_read_task(directory, 0, 16, buffers[0], &results[0]);
+  executor_.add_read_task(std::string{"/tmp"}, 0, 16, buffers[1],
+                          &results[1]);
+  executor_.add_read_task(path_ + ".missing", 0, 16, buffers[2], &results[2]);
+  ASSERT_TRUE(wait_until_idle(executor_));
+  ::close(directory);
+
+  EXPECT_EQ(-EISDIR, results[0]);
+  EXPECT_EQ(-EISDIR, results[1]);
+  EXPECT_EQ(-ENOENT, results[2]);
+}
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,135 @@
+#ifndef SPARKS_CORE_EXECUTOR_TEST_UTIL_HPP_
+#define SPARKS_CORE_EXECUTOR_TEST_UTIL_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "executor.hpp"
+
+namespace sparks {
+
+// Runs an Executor on num_threads threads until destroyed.
+class ExecutorThreads {
+ public:
+  ExecutorThreads(Executor& executor, int num_threads) : executor_(executor) {
+    for (int i = 0; i < num_threads; ++i) {
+      threads_.emplace_back([&executor] { executor.run_tasks_no_affinity(); });
+    }
+  }
+
+  ~ExecutorThreads() {
+    executor_.close_and_wait();
+    for (auto& thread : threads_) thread.join();
+  }
+
+ private:
+  Executor& executor_;
+  std::vector<std::thread> threads_;
+};
+
+// Waits up to ten seconds for done() to return true.
+template <typename Done>
+bool wait_until(Done done) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!done()) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+// Waits for every task added to executor to complete.
+inline bool wait_until_idle(Executor& executor) {
+  return wait_until([&executor] {
+    return executor.task_budget_stats().tasks_in_flight == 0;
+  });
+}
+
+// Records when tasks (numbered by the test) start and end, to check their
+// order afterwards.
+class TaskLog {
+ public:
+  void start(int task) { add(task, true); }
+  void end(int task) { add(task, false); }
+
+  bool started(int task) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return position(task, true) < events_.size();
+  }
+
+  // Whether task `first` ended before `second` started (both must have run).
+  bool ended_before(int first, int second) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto first_end = position(first, false);
+    const auto second_start = position(second, true);
+    return first_end < events_.size() && second_start < events_.size() &&
+           first_end < second_start;
+  }
+
+ private:
+  struct Event {
+    int task;
+    bool is_start;
+
+    bool operator==(const Event& other) const {
+      return task == other.task && is_start == other.is_start;
+    }
+  };
+
+  void add(int task, bool is_start) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.push_back({task, is_start});
+  }
+
+  size_t position(int task, bool is_start) const {
+    return std::find(events_.begin(), events_.end(), Event{task, is_start}) -
+           events_.begin();
+  }
+
+  mutable std::mutex mutex_;
+  std::vector<Event> events_;
+};
+
+// A task which only logs that it ran.
+struct Logged {
+  void operator()() const {
+    log->start(task);
+    log->end(task);
+  }
+
+  TaskLog* log;
+  int task;
+};
+
+// A task which waits for another one to start before it ends, so the two
+// must be able to run in parallel: if either depended on the other, they
+// would be logged one after the other (after a ten second timeout).
+struct Rendezvous {
+  void operator()() const {
+    log->start(task);
+    const TaskLog* const other_log = log;
+    const int other_task = other;
+    wait_until([other_log, other_task] {
+      return other_log->started(other_task);
+    });
+    log->end(task);
+  }
+
+  TaskLog* log;
+  int task;
+  int other;
+};
+
+// Whether two tasks ran in parallel.
+inline bool overlapped(const TaskLog& log, int a, int b) {
+  return log.started(a) && log.started(b) && !log.ended_before(a, b) &&
+         !log.ended_before(b, a);
+}
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_EXECUTOR_TEST_UTIL_HPP_
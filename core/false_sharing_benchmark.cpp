@@ -0,0 +1,80 @@
+#include "work_stealing_queue.hpp"
+
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+// Built into the false_sharing_padded and false_sharing_packed targets too,
+// the latter with -DSPARKS_CACHE_LINE_SIZE=8: running both side by side shows
+// what the cache line padding of the queues (and of the Scheduler, whose
+// benchmarks they include) is worth.
+
+namespace sparks {
+namespace {
+
+using Element = uint32_t;
+using Queue = WorkStealingQueue<Element, 10>;
+
+const int MAX_THREADS = 8;
+
+// Thread 0 keeps a queue topped up, every other thread steals from it. Packed,
+// every push invalidates the line the thieves' lock and head share with tail.
+void BM_FalseSharingSteal(benchmark::State& state) {
+  static Queue queue;
+  Element to = 0;
+  int64_t num_moved = 0;
+  if (state.thread_index() == 0) {
+    Element next = 0;
+    for (auto _ : state) {
+      if (queue.unique_push(next)) {
+        ++next;
+        ++num_moved;
+      }
+    }
+    while (queue.unique_pull(to)) {}
+  } else {
+    int64_t num_steals = 0;
+    for (auto _ : state) num_steals += queue.shared_pull(to);
+    num_moved += num_steals;
+    state.counters["steals"] =
+        benchmark::Counter(num_steals, benchmark::Counter::kIsRate);
+  }
+  benchmark::DoNotOptimize(to);
+  state.SetItemsProcessed(num_moved);
+}
+BENCHMARK(BM_FalseSharingSteal)->ThreadRange(2, MAX_THREADS)->UseRealTime();
+
+// Every thread owns one of an array of queues, like the nodes of a Scheduler,
+// and pushes and pulls its own tasks; every STEAL_PERIOD-th iteration it
+// also steals from its neighbour. Packed, neighbouring queues share lines.
+const int STEAL_PERIOD = 16;
+
+void BM_FalseSharingAdjacentQueues(benchmark::State& state) {
+  static Queue queues[MAX_THREADS];
+  Queue& own = queues[state.thread_index()];
+  Queue& neighbour = queues[(state.thread_index() + 1) % state.threads()];
+  Element to = 0;
+  int64_t num_steals = 0;
+  int iteration = 0;
+  for (auto _ : state) {
+    own.unique_push(1);
+    own.unique_push(2);
+    own.unique_pull(to);
+    if (++iteration == STEAL_PERIOD) {
+      iteration = 0;
+      num_steals += neighbour.shared_pull(to);
+    }
+    own.unique_pull(to);
+  }
+  while (own.unique_pull(to)) {}
+  benchmark::DoNotOptimize(to);
+  state.counters["steals"] =
+      benchmark::Counter(num_steals, benchmark::Counter::kIsRate);
+  state.SetItemsProcessed(state.iterations() * 4);
+}
+BENCHMARK(BM_FalseSharingAdjacentQueues)
+    ->ThreadRange(1, MAX_THREADS)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace sparks
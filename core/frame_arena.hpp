@@ -0,0 +1,128 @@
+#ifndef SPARKS_CORE_FRAME_ARENA_HPP_
+#define SPARKS_CORE_FRAME_ARENA_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace sparks {
+
+// A linear (bump pointer) allocator for short-lived scratch memory. There is
+// no per-allocation free: reset() releases everything at once and keeps the
+// chunks around for reuse, so a steady-state frame allocates no memory from
+// the system at all. Requests larger than a chunk get a dedicated buffer
+// which reset() does free.
+//
+// Not thread-safe; the Executor gives every worker thread its own arena.
+class FrameArena {
+ public:
+  static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+  explicit FrameArena(size_t chunk_size = DEFAULT_CHUNK_SIZE)
+      : chunk_size_{chunk_size} {
+    DCHECK_GT(chunk_size_, 0);
+  }
+
+  FrameArena(const FrameArena&) = delete;
+  FrameArena(FrameArena&&) = default;
+
+  FrameArena& operator=(const FrameArena&) = delete;
+  FrameArena& operator=(FrameArena&&) = default;
+
+  // Returns size bytes aligned to alignment, which must be a power of two.
+  inline void* allocate(size_t size,
+                        size_t alignment = alignof(std::max_align_t));
+
+  // Constructs a T in the arena. Its destructor will never be called, hence
+  // the restriction to trivially destructible types.
+  template<typename T, typename ...Args>
+  T* create(Args&& ...args) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "Arena objects are never destroyed.");
+    return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  // Uninitialised storage for count Ts.
+  template<typename T>
+  T* allocate_array(size_t count) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "Arena objects are never destroyed.");
+    return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+  }
+
+  // Invalidates every allocation made since the last reset().
+  void reset() {
+    large_chunks_.clear();
+    i_chunk_ = 0;
+    offset_ = 0;
+    bytes_allocated_ = 0;
+  }
+
+  // Bytes handed out since the last reset() (excluding alignment padding).
+  size_t bytes_allocated() const { return bytes_allocated_; }
+
+  // Bytes owned by the arena.
+  size_t capacity() const {
+    size_t total = 0;
+    for (const auto& chunk : chunks_) total += chunk.size;
+    for (const auto& chunk : large_chunks_) total += chunk.size;
+    return total;
+  }
+
+ private:
+  struct Chunk {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  static Chunk new_chunk(size_t size) {
+    return Chunk{std::unique_ptr<char[]>{new char[size]}, size};
+  }
+
+  static uintptr_t align_up(uintptr_t address, size_t alignment) {
+    return (address + alignment - 1) & ~(uintptr_t(alignment) - 1);
+  }
+
+  size_t chunk_size_;
+  std::vector<Chunk> chunks_;
+  std::vector<Chunk> large_chunks_;
+  size_t i_chunk_{0};
+  size_t offset_{0};
+  size_t bytes_allocated_{0};
+};
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+  DCHECK_EQ(alignment & (alignment - 1), 0) << "Non power of two alignment.";
+  bytes_allocated_ += size;
+
+  if (size + alignment > chunk_size_) {
+    large_chunks_.push_back(new_chunk(size + alignment));
+    const auto base = reinterpret_cast<uintptr_t>(
+        large_chunks_.back().data.get());
+    return reinterpret_cast<void*>(align_up(base, alignment));
+  }
+
+  while (true) {
+    if (i_chunk_ == chunks_.size()) chunks_.push_back(new_chunk(chunk_size_));
+
+    const auto base = reinterpret_cast<uintptr_t>(chunks_[i_chunk_].data.get());
+    const auto aligned = align_up(base + offset_, alignment);
+    if (aligned - base + size <= chunk_size_) {
+      offset_ = aligned - base + size;
+      return reinterpret_cast<void*>(aligned);
+    }
+
+    ++i_chunk_;
+    offset_ = 0;
+  }
+}
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_FRAME_ARENA_HPP_
@@ -0,0 +1,43 @@
+#include "frame_arena.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <benchmark/benchmark.h>
+
+namespace sparks {
+namespace {
+
+const int NUM_ALLOCATIONS = 256;
+
+size_t allocation_size(int i) { return 16 + (i % 7) * 24; }
+
+// A frame's worth of scratch allocations from every thread, freed in bulk.
+void BM_FrameArenaAllocate(benchmark::State& state) {
+  FrameArena arena;
+  for (auto _ : state) {
+    for (int i = 0; i < NUM_ALLOCATIONS; ++i) {
+      benchmark::DoNotOptimize(arena.allocate(allocation_size(i)));
+    }
+    arena.reset();
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_ALLOCATIONS);
+}
+BENCHMARK(BM_FrameArenaAllocate)->ThreadRange(1, 16)->UseRealTime();
+
+// The same allocations through malloc() and free(), for comparison.
+void BM_MallocFree(benchmark::State& state) {
+  void* pointers[NUM_ALLOCATIONS];
+  for (auto _ : state) {
+    for (int i = 0; i < NUM_ALLOCATIONS; ++i) {
+      pointers[i] = std::malloc(allocation_size(i));
+      benchmark::DoNotOptimize(pointers[i]);
+    }
+    for (auto pointer : pointers) std::free(pointer);
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_ALLOCATIONS);
+}
+BENCHMARK(BM_MallocFree)->ThreadRange(1, 16)->UseRealTime();
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,84 @@
+#include "frame_arena.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+bool is_aligned(const void* pointer, size_t alignment) {
+  return reinterpret_cast<uintptr_t>(pointer) % alignment == 0;
+}
+
+// Allocations fill a chunk before the next one is started, are aligned as
+// requested and don't overlap.
+TEST(FrameArenaTest, AllocationsFillChunks) {
+  FrameArena arena{1024};
+  char* first = static_cast<char*>(arena.allocate(100, 1));
+  char* second = static_cast<char*>(arena.allocate(100, 1));
+  EXPECT_EQ(first + 100, second);
+  EXPECT_EQ(1024u, arena.capacity());
+
+  for (size_t alignment : {2, 8, 64, 256}) {
+    void* aligned = arena.allocate(10, alignment);
+    EXPECT_TRUE(is_aligned(aligned, alignment)) << alignment;
+    std::memset(aligned, 0xff, 10);
+  }
+  EXPECT_EQ(240u, arena.bytes_allocated());
+  EXPECT_EQ(1024u, arena.capacity());
+
+  // Doesn't fit in what is left of the first chunk.
+  char* third = static_cast<char*>(arena.allocate(800, 1));
+  EXPECT_EQ(2048u, arena.capacity());
+  EXPECT_TRUE(third + 800 <= first || third >= first + 1024);
+  EXPECT_EQ(1040u, arena.bytes_allocated());
+}
+
+// Requests which don't fit in a chunk (alignment included) get a buffer of
+// their own, which reset() frees, and don't disturb the current chunk.
+TEST(FrameArenaTest, OversizeRequestsGetTheirOwnBuffer) {
+  FrameArena arena{1024};
+  char* small = static_cast<char*>(arena.allocate(16, 1));
+  void* large = arena.allocate(1020, 8);
+  EXPECT_TRUE(is_aligned(large, 8));
+  EXPECT_EQ(1024u + 1028u, arena.capacity());
+  std::memset(large, 0xff, 1020);
+  EXPECT_EQ(small + 16, arena.allocate(16, 1));
+  EXPECT_EQ(1052u, arena.bytes_allocated());
+
+  arena.reset();
+  EXPECT_EQ(0u, arena.bytes_allocated());
+  EXPECT_EQ(1024u, arena.capacity());
+}
+
+// reset() keeps the chunks and hands them out again from the start, so a
+// steady state allocates no memory.
+TEST(FrameArenaTest, ResetReusesChunks) {
+  FrameArena arena{1024};
+  void* first = nullptr;
+  for (int frame = 0; frame < 3; ++frame) {
+    void* frame_first = arena.allocate(512);
+    for (int i = 0; i < 5; ++i) arena.allocate(512);
+    if (frame == 0) first = frame_first;
+    EXPECT_EQ(first, frame_first);
+    EXPECT_EQ(3072u, arena.bytes_allocated());
+    EXPECT_EQ(3072u, arena.capacity());
+    arena.reset();
+  }
+
+  struct Point {
+    int x;
+    int y;
+  };
+  const Point* point = arena.create<Point>(Point{1, 2});
+  EXPECT_EQ(first, point);
+  EXPECT_EQ(2, point->y);
+  int64_t* array = arena.allocate_array<int64_t>(4);
+  EXPECT_TRUE(is_aligned(array, alignof(int64_t)));
+  EXPECT_EQ(sizeof(Point) + 4 * sizeof(int64_t), arena.bytes_allocated());
+}
+
+}  // namespace
+}  // namespace sparks
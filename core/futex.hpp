@@ -0,0 +1,51 @@
+#ifndef SPARKS_CORE_FUTEX_HPP_
+#define SPARKS_CORE_FUTEX_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace sparks {
+
+// Thin wrappers around the Linux futex syscall, for parking threads on a
+// 32-bit atomic without a mutex and condition variable. On other platforms
+// futex_wait() degrades to a yield and futex_wake() to a no-op, which keeps
+// callers (who must re-check their condition in a loop anyway) correct.
+
+// Blocks while *word == expected, until woken by futex_wake(). May return
+// spuriously.
+inline void futex_wait(std::atomic<uint32_t>& word, uint32_t expected) {
+#ifdef __linux__
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                "atomic<uint32_t> is not a plain word");
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE,
+          expected, nullptr, nullptr, 0);
+#else
+  if (word.load() == expected) std::this_thread::yield();
+#endif
+}
+
+// Wakes up to num_waiters threads blocked in futex_wait() on word.
+inline void futex_wake(std::atomic<uint32_t>& word, int num_waiters = 1) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE,
+          num_waiters, nullptr, nullptr, 0);
+#else
+  (void) word;
+  (void) num_waiters;
+#endif
+}
+
+inline void futex_wake_all(std::atomic<uint32_t>& word) {
+  futex_wake(word, INT32_MAX);
+}
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_FUTEX_HPP_
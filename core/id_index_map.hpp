@@ -0,0 +1,211 @@
+#ifndef SPARKS_CORE_ID_INDEX_MAP_HPP_
+#define SPARKS_CORE_ID_INDEX_MAP_HPP_
+
+#include "id_index_map_fwd.hpp"
+
+#include <glog/logging.h>
+
+namespace sparks {
+
+template<typename IdType, uint8_t OUTER_BITS>
+void BasicIdIndexMap<IdType, OUTER_BITS>::reserve_ids(size_type new_size) {
+  DCHECK_LE(new_size, MAX_SIZE);
+  const auto old_size = outer_to_index_.size();
+  if (new_size > old_size) {
+    outer_to_index_.resize(new_size);
+    for (auto i = old_size; i < new_size - 1; ++i) {
+      outer_to_index_[i] = static_cast<Id>(i + 1);
+    }
+    outer_to_index_[new_size - 1] = first_free_;
+    first_free_ = old_size;
+    if (last_free_ == INVALID_INDEX) last_free_ = new_size - 1;
+  }
+}
+
+template<typename IdType, uint8_t OUTER_BITS>
+void BasicIdIndexMap<IdType, OUTER_BITS>::reserve_indices(size_type new_size) {
+  DCHECK_LE(new_size, MAX_SIZE);
+  index_to_outer_.reserve(new_size);
+  reserve_ids(new_size);
+}
+
+template<typename IdType, uint8_t OUTER_BITS> inline
+bool BasicIdIndexMap<IdType, OUTER_BITS>::is_valid_id(Id id) const {
+  auto outer_id = id & OUTER_MASK;
+  return outer_id < outer_to_index_.size() &&
+         (id & INNER_MASK) == (outer_to_index_[outer_id] & INNER_MASK);
+}
+
+template<typename IdType, uint8_t OUTER_BITS> inline
+typename BasicIdIndexMap<IdType, OUTER_BITS>::size_type
+BasicIdIndexMap<IdType, OUTER_BITS>::index_of(Id id) const {
+  auto outer_id = id & OUTER_MASK;
+  DCHECK_LT(outer_id, outer_to_index_.size()) << "Index out of bounds.";
+
+  auto& entry = outer_to_index_[outer_id];
+  DCHECK_EQ(entry & INNER_MASK, id & INNER_MASK) << "Stale index used.";
+
+  auto index = entry & OUTER_MASK;
+  DCHECK_LT(index, index_to_outer_.size());
+  DCHECK_EQ(index_to_outer_[index], outer_id);
+
+  return index;
+}
+
+template<typename IdType, uint8_t OUTER_BITS> inline
+typename BasicIdIndexMap<IdType, OUTER_BITS>::Id
+BasicIdIndexMap<IdType, OUTER_BITS>::id_at(size_type index) const {
+  DCHECK_LT(index, index_to_outer_.size());
+  const auto outer_id = index_to_outer_[index];
+  return (outer_to_index_[outer_id] & INNER_MASK) | outer_id;
+}
+
+template<typename IdType, uint8_t OUTER_BITS>
+typename BasicIdIndexMap<IdType, OUTER_BITS>::Id
+    BasicIdIndexMap<IdType, OUTER_BITS>::create_id() {
+  const auto index = size();
+  DCHECK_LT(index, MAX_INDEX);
+  if (last_free_ == INVALID_INDEX) {
+    DCHECK_EQ(first_free_, INVALID_INDEX);
+    outer_to_index_.push_back(index | 0);
+    const auto outer_id = static_cast<Id>(outer_to_index_.size() - 1);
+    index_to_outer_.push_back(outer_id);
+    return outer_id;
+  } else {
+    DCHECK_NE(first_free_, INVALID_INDEX);
+    auto& free_index = outer_to_index_[first_free_];
+    const auto inner_id = free_index & INNER_MASK;
+    const auto outer_id = first_free_;
+    first_free_ = free_index & OUTER_MASK;
+    if (first_free_ == INVALID_INDEX) last_free_ = INVALID_INDEX;
+    free_index = inner_id | index;
+    index_to_outer_.push_back(outer_id);
+
+    return inner_id | outer_id;
+  }
+}
+
+template<typename IdType, uint8_t OUTER_BITS>
+typename BasicIdIndexMap<IdType, OUTER_BITS>::size_type
+    BasicIdIndexMap<IdType, OUTER_BITS>::free_id(Id freed_id) {
+  const auto outer_freed_id = freed_id & OUTER_MASK;
+  const auto inner_freed_id = freed_id & INNER_MASK;
+  DCHECK_LE(outer_freed_id, outer_to_index_.size());
+
+  auto& freed_entry = outer_to_index_[outer_freed_id];
+  DCHECK_EQ(inner_freed_id, freed_entry & INNER_MASK);
+
+  const auto index = freed_entry & OUTER_MASK;
+  const auto last_index = size() - 1;
+  if (index != last_index) {
+    // Move last index in place of the freed one and update the outer_to_index_
+    // entry of the last element to point to the new position.
+    const auto last_outer_id = index_to_outer_[index] = index_to_outer_.back();
+    auto& last_element_entry = outer_to_index_[last_outer_id];
+    last_element_entry = (last_element_entry & INNER_MASK) | index;
+  }
+  index_to_outer_.pop_back();
+
+  // Add freed entry at the end of free list and mark it as end-of-list.
+  freed_entry =
+      (((freed_entry & INNER_MASK) + (1 << OUTER_BITS)) & INNER_MASK) |
+      OUTER_MASK;
+  if (last_free_ == INVALID_INDEX) {
+    DCHECK_EQ(first_free_, INVALID_INDEX);
+    last_free_ = first_free_ = outer_freed_id;  // List was empty.
+  } else {
+    outer_to_index_[last_free_] &= INNER_MASK | outer_freed_id;
+    last_free_ = outer_freed_id;
+  }
+
+  return index;
+}
+
+template<typename IdType, uint8_t OUTER_BITS>
+template<typename IdOutputIter>
+IdOutputIter BasicIdIndexMap<IdType, OUTER_BITS>::create_ids(
+    size_type count, IdOutputIter ids_out) {
+  DCHECK_LE(size() + count, MAX_SIZE);
+  index_to_outer_.reserve(size() + count);
+  for (size_type i = 0; i < count; ++i) *ids_out++ = create_id();
+  return ids_out;
+}
+
+template<typename IdType, uint8_t OUTER_BITS>
+template<typename IdInputIter, typename MoveFunction>
+typename BasicIdIndexMap<IdType, OUTER_BITS>::size_type
+BasicIdIndexMap<IdType, OUTER_BITS>::free_ids(IdInputIter begin,
+                                              IdInputIter end,
+                                              MoveFunction move) {
+  // Invalidate the ids, marking their indices and chaining them into a list
+  // which is later appended to the free list.
+  freed_indices_.clear();
+  size_type batch_first = INVALID_INDEX, batch_last = INVALID_INDEX;
+  for (; begin != end; ++begin) {
+    const Id freed_id = *begin;
+    if (!is_valid_id(freed_id)) continue;  // Also skips repeated ids.
+
+    const auto outer_freed_id = freed_id & OUTER_MASK;
+    auto& freed_entry = outer_to_index_[outer_freed_id];
+    const auto index = freed_entry & OUTER_MASK;
+    freed_indices_.push_back(index);
+    index_to_outer_[index] = INVALID_INDEX;
+
+    freed_entry =
+        (((freed_entry & INNER_MASK) + (1 << OUTER_BITS)) & INNER_MASK) |
+        OUTER_MASK;
+    if (batch_last == INVALID_INDEX) {
+      batch_first = outer_freed_id;
+    } else {
+      outer_to_index_[batch_last] &= INNER_MASK | outer_freed_id;
+    }
+    batch_last = outer_freed_id;
+  }
+
+  const auto num_freed = static_cast<size_type>(freed_indices_.size());
+  if (num_freed == 0) return 0;
+
+  // Fill the holes below the new size with the surviving indices above it, so
+  // that every survivor moves at most once.
+  const auto new_size = size() - num_freed;
+  auto survivor = new_size;
+  for (auto hole : freed_indices_) {
+    if (hole >= new_size) continue;
+    while (index_to_outer_[survivor] == INVALID_INDEX) ++survivor;
+
+    const auto outer_id = index_to_outer_[hole] = index_to_outer_[survivor];
+    auto& entry = outer_to_index_[outer_id];
+    entry = (entry & INNER_MASK) | hole;
+    move(survivor, hole);
+    ++survivor;
+  }
+  index_to_outer_.resize(new_size);
+
+  // Splice the batch onto the end of the free list.
+  if (last_free_ == INVALID_INDEX) {
+    DCHECK_EQ(first_free_, INVALID_INDEX);
+    first_free_ = batch_first;
+  } else {
+    outer_to_index_[last_free_] &= INNER_MASK | batch_first;
+  }
+  last_free_ = batch_last;
+
+  return num_freed;
+}
+
+template<typename IdType, uint8_t OUTER_BITS> inline
+void BasicIdIndexMap<IdType, OUTER_BITS>::swap_indices(size_type a,
+                                                       size_type b) {
+  DCHECK_LT(a, size());
+  DCHECK_LT(b, size());
+  const auto outer_a = index_to_outer_[a];
+  const auto outer_b = index_to_outer_[b];
+  index_to_outer_[a] = outer_b;
+  index_to_outer_[b] = outer_a;
+  outer_to_index_[outer_a] = (outer_to_index_[outer_a] & INNER_MASK) | b;
+  outer_to_index_[outer_b] = (outer_to_index_[outer_b] & INNER_MASK) | a;
+}
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_ID_INDEX_MAP_HPP_
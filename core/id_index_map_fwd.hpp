@@ -0,0 +1,84 @@
+#ifndef SPARKS_CORE_ID_INDEX_MAP_FWD_HPP_
+#define SPARKS_CORE_ID_INDEX_MAP_FWD_HPP_
+
+#include <cstdint>
+#include <vector>
+
+namespace sparks {
+
+// Maps stable ids to indices into a packed array. Ids are made of an 'outer'
+// part (the position in outer_to_index_) and an 'inner' tag which is
+// incremented on every reuse of the outer part, catching stale ids.
+//
+// The map does not own any elements; containers keep one or more packed arrays
+// in sync with it, swap-removing from them as instructed by free_id().
+template<typename IdType, uint8_t OUTER_BITS>
+class BasicIdIndexMap {
+ public:
+  using Id = IdType;
+  using size_type = IdType;
+
+  static_assert(OUTER_BITS < sizeof(IdType) * 8,
+                "There needs to be at least one inner bit.");
+
+  static const Id OUTER_MASK = (1 << OUTER_BITS) - 1;
+  static const Id INNER_MASK = ~OUTER_MASK;
+  static const Id MAX_INDEX = OUTER_MASK - 1;
+  static const Id INVALID_INDEX = OUTER_MASK;
+  static const size_type MAX_SIZE = MAX_INDEX + 1;
+
+  inline void reserve_ids(size_type new_size);
+  inline void reserve_indices(size_type new_size);
+
+  inline bool is_valid_id(Id id) const;
+
+  // The packed index currently mapped to a valid id.
+  inline size_type index_of(Id id) const;
+
+  // The id mapped to a packed index < size().
+  inline Id id_at(size_type index) const;
+
+  // Maps a new id to index size().
+  inline Id create_id();
+
+  // Unmaps an id. The id which was mapped to the last index is re-mapped to
+  // the freed index, so the caller needs to move its last element into the
+  // returned index (unless it *is* the last index) and then pop it.
+  inline size_type free_id(Id freed_id);
+
+  // Maps `count` new ids to indices [size(), size() + count), writing them to
+  // `ids_out`.
+  template<typename IdOutputIter>
+  inline IdOutputIter create_ids(size_type count, IdOutputIter ids_out);
+
+  // Unmaps all the valid ids in [begin, end) at once (invalid and repeated ids
+  // are ignored) and returns how many were freed. The indices which remain
+  // past the new size() are re-mapped into the freed ones below it, calling
+  // `move(from, to)` once for each; the caller must mirror these moves in its
+  // arrays and then truncate them to size(). The freed ids are spliced onto
+  // the free list in one go.
+  template<typename IdInputIter, typename MoveFunction>
+  inline size_type free_ids(IdInputIter begin, IdInputIter end,
+                            MoveFunction move);
+
+  // Swaps the ids mapped to two packed indices; the caller swaps its elements.
+  inline void swap_indices(size_type a, size_type b);
+
+  size_type size() const {
+    return static_cast<size_type>(index_to_outer_.size());
+  }
+
+ private:
+  std::vector<size_type> outer_to_index_;
+  std::vector<size_type> index_to_outer_;
+
+  size_type first_free_ = INVALID_INDEX;
+  size_type last_free_ = INVALID_INDEX;
+
+  // Scratch space for free_ids(), kept around to avoid reallocations.
+  std::vector<size_type> freed_indices_;
+};
+
+}  // namespace
+
+#endif  // #ifndef SPARKS_CORE_ID_INDEX_MAP_FWD_HPP_
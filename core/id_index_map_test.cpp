@@ -0,0 +1,109 @@
+#include "id_index_map.hpp"
+
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+using IndexMap = BasicIdIndexMap<uint32_t, 8>;
+
+// Checks that every valid id maps to a distinct index and back.
+void expect_consistent(const IndexMap& map, const std::vector<uint32_t>& ids) {
+  ASSERT_EQ(ids.size(), size_t{map.size()});
+  std::set<uint32_t> indices;
+  for (auto id : ids) {
+    ASSERT_TRUE(map.is_valid_id(id));
+    const auto index = map.index_of(id);
+    ASSERT_LT(index, map.size());
+    EXPECT_EQ(id, map.id_at(index));
+    indices.insert(index);
+  }
+  EXPECT_EQ(ids.size(), indices.size());
+}
+
+TEST(IdIndexMapTest, CreateAndFree) {
+  IndexMap map;
+  EXPECT_EQ(0u, map.size());
+  EXPECT_FALSE(map.is_valid_id(0));
+
+  const auto a = map.create_id();
+  const auto b = map.create_id();
+  const auto c = map.create_id();
+  EXPECT_EQ(0u, map.index_of(a));
+  EXPECT_EQ(1u, map.index_of(b));
+  EXPECT_EQ(2u, map.index_of(c));
+
+  // Freeing a moves the last id (c) into its index.
+  EXPECT_EQ(0u, map.free_id(a));
+  EXPECT_FALSE(map.is_valid_id(a));
+  EXPECT_EQ(0u, map.index_of(c));
+  EXPECT_EQ(c, map.id_at(0));
+  expect_consistent(map, {b, c});
+
+  // Freeing the last index moves nothing.
+  EXPECT_EQ(1u, map.free_id(b));
+  expect_consistent(map, {c});
+}
+
+// Reusing an id's outer part bumps its tag, so the old id stays invalid.
+TEST(IdIndexMapTest, ReusedIdsGetNewTags) {
+  IndexMap map;
+  const auto first = map.create_id();
+  auto id = first;
+  for (int i = 0; i < 100; ++i) {
+    map.free_id(id);
+    const auto reused = map.create_id();
+    EXPECT_EQ(first & IndexMap::OUTER_MASK, reused & IndexMap::OUTER_MASK);
+    EXPECT_NE(id, reused);
+    EXPECT_FALSE(map.is_valid_id(id));
+    EXPECT_FALSE(map.is_valid_id(first));
+    id = reused;
+  }
+  expect_consistent(map, {id});
+}
+
+// Freed ids are reused oldest first, after reserve_ids()'s spare ones.
+TEST(IdIndexMapTest, FreeListIsFifo) {
+  IndexMap map;
+  map.reserve_ids(4);
+  std::vector<uint32_t> ids;
+  for (int i = 0; i < 4; ++i) ids.push_back(map.create_id());
+  EXPECT_EQ((std::vector<uint32_t>{0, 1, 2, 3}), ids);
+
+  map.free_id(ids[2]);
+  map.free_id(ids[0]);
+  EXPECT_EQ(2u, map.create_id() & IndexMap::OUTER_MASK);
+  EXPECT_EQ(0u, map.create_id() & IndexMap::OUTER_MASK);
+  EXPECT_EQ(4u, map.create_id());
+}
+
+// Random creates and frees against a reference set of live ids.
+TEST(IdIndexMapTest, RandomOperationsStayConsistent) {
+  IndexMap map;
+  std::vector<uint32_t> ids;
+  std::set<uint32_t> ever_freed;
+  std::mt19937 random{42};
+  for (int i = 0; i < 5000; ++i) {
+    if (ids.empty() || (ids.size() < IndexMap::MAX_SIZE && random() % 2)) {
+      const auto id = map.create_id();
+      EXPECT_EQ(0u, ever_freed.count(id)) << "Stale id handed out again.";
+      ids.push_back(id);
+    } else {
+      const auto i_freed = random() % ids.size();
+      map.free_id(ids[i_freed]);
+      ever_freed.insert(ids[i_freed]);
+      ids.erase(ids.begin() + i_freed);
+    }
+    if (i % 100 == 0) expect_consistent(map, ids);
+  }
+  expect_consistent(map, ids);
+  for (auto id : ever_freed) EXPECT_FALSE(map.is_valid_id(id));
+}
+
+}  // namespace
+}  // namespace sparks
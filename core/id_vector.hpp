@@ -2,9 +2,13 @@
 #define SPARKS_CORE_ID_VECTOR_HPP_
 
 #include "id_vector_fwd.hpp"
+#include "id_index_map.hpp"
 
-#include <glog/logging.h>
+#include <algorithm>
 #include <iostream>
+#include <utility>
+
+#include <glog/logging.h>
 
 namespace sparks {
 
@@ -17,18 +21,7 @@ BasicIdVector<ElemType, IdType, OUTER_BITS>::BasicIdVector(
 
 template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
 void BasicIdVector<ElemType, IdType, OUTER_BITS>::reserve_ids(size_type new_size) {
-  DCHECK_LE(new_size, MAX_SIZE);
-  const auto old_size = outer_to_index_.size();
-  if (new_size > old_size) {
-    outer_to_index_.resize(new_size);
-    for (auto i = old_size; i < new_size - 1; ++i) {
-      outer_to_index_[i] = static_cast<Id>(i + 1);
-    }
-    outer_to_index_[new_size - 1] = first_free_;
-    first_free_ = old_size;
-    if (last_free_ == INVALID_INDEX) last_free_ = new_size - 1;
-  }
-
+  ids_.reserve_ids(new_size);
 }
 
 template <typename ElemType, typename IdType, uint8_t OUTER_BITS>
@@ -36,14 +29,12 @@ void BasicIdVector<ElemType, IdType, OUTER_BITS>::reserve_elements(
     size_type new_size) {
   DCHECK_LE(new_size, MAX_SIZE);
   elements_.reserve(new_size);
-  reserve_ids(new_size);
+  ids_.reserve_indices(new_size);
 }
 
 template<typename ElemType, typename IdType, uint8_t OUTER_BITS> inline
 bool BasicIdVector<ElemType, IdType, OUTER_BITS>::is_valid_id(Id id) const {
-  auto outer_id = id & OUTER_MASK;
-  return outer_id < outer_to_index_.size() &&
-         (id & INNER_MASK) == (outer_to_index_[outer_id] & INNER_MASK);
+  return ids_.is_valid_id(id);
 }
 
 template<typename ElemType, typename IdType, uint8_t OUTER_BITS> inline
@@ -52,8 +43,7 @@ typename BasicIdVector<ElemType, IdType, OUTER_BITS>::Id BasicIdVector<
   DCHECK(iter <= elements_.end());
   DCHECK(iter >= elements_.begin());
   if (iter == elements_.end()) return INVALID_INDEX;
-  const auto outer_id = index_to_outer_[iter - elements_.begin()];
-  return (outer_to_index_[outer_id] & INNER_MASK) | outer_id;
+  return ids_.id_at(static_cast<size_type>(iter - elements_.begin()));
 }
 
 template <typename ElemType, typename IdType, uint8_t OUTER_BITS> inline
@@ -68,9 +58,8 @@ template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
 template<typename... Args> inline
 typename BasicIdVector<ElemType, IdType, OUTER_BITS>::Id
     BasicIdVector<ElemType, IdType, OUTER_BITS>::emplace(Args&&... args) {
-  const auto id = create_id();
+  const auto id = ids_.create_id();
   elements_.emplace_back(std::forward<Args>(args)...);
-  index_to_outer_.emplace_back(id & OUTER_MASK);
   return id;
 }
 
@@ -78,9 +67,8 @@ template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
 typename BasicIdVector<ElemType, IdType, OUTER_BITS>::Id inline
     BasicIdVector<ElemType, IdType, OUTER_BITS>::insert(
         const value_type &value) {
-  const auto id = create_id();
+  const auto id = ids_.create_id();
   elements_.push_back(value);
-  index_to_outer_.emplace_back(id & OUTER_MASK);
   return id;
 }
 
@@ -89,6 +77,35 @@ void BasicIdVector<ElemType, IdType, OUTER_BITS>::erase(Id id) {
   free_id(id);
 }
 
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
+template<typename IdOutputIter, typename... Args>
+IdOutputIter BasicIdVector<ElemType, IdType, OUTER_BITS>::emplace_batch(
+    size_type count, IdOutputIter ids_out, const Args&... args) {
+  elements_.reserve(elements_.size() + count);
+  for (size_type i = 0; i < count; ++i) elements_.emplace_back(args...);
+  return ids_.create_ids(count, ids_out);
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
+template<typename IdInputIter>
+typename BasicIdVector<ElemType, IdType, OUTER_BITS>::size_type
+BasicIdVector<ElemType, IdType, OUTER_BITS>::erase_batch(IdInputIter begin,
+                                                         IdInputIter end) {
+  const auto num_erased =
+      ids_.free_ids(begin, end, [this](size_type from, size_type to) {
+        elements_[to] = std::move(elements_[from]);
+      });
+  elements_.erase(elements_.begin() + ids_.size(), elements_.end());
+  return num_erased;
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
+template<typename IdRange> inline
+typename BasicIdVector<ElemType, IdType, OUTER_BITS>::size_type
+BasicIdVector<ElemType, IdType, OUTER_BITS>::erase_batch(const IdRange& ids) {
+  return erase_batch(ids.begin(), ids.end());
+}
+
 template<typename ElemType, typename IdType, uint8_t OUTER_BITS> inline
 ElemType& BasicIdVector<ElemType, IdType, OUTER_BITS>::operator[](Id id) {
   return const_cast<value_type&>(
@@ -99,74 +116,165 @@ ElemType& BasicIdVector<ElemType, IdType, OUTER_BITS>::operator[](Id id) {
 template<typename ElemType, typename IdType, uint8_t OUTER_BITS> inline
 const ElemType& BasicIdVector<ElemType, IdType, OUTER_BITS>::operator[](
     Id id) const {
-  auto outer_id = id & OUTER_MASK;
-  DCHECK_LT(outer_id, outer_to_index_.size()) << "Index out of bounds.";
+  auto element_index = ids_.index_of(id);
+  DCHECK_LT(element_index, elements_.size());
+  return elements_[element_index];
+}
 
-  auto& entry = outer_to_index_[outer_id];
-  DCHECK_EQ(entry & INNER_MASK, id & INNER_MASK) << "Stale index used.";
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
+template<typename Compare>
+void BasicIdVector<ElemType, IdType, OUTER_BITS>::begin_reorder(
+    Compare compare) {
+  std::vector<Id> order;
+  order.reserve(elements_.size());
+  for (size_type i = 0; i < size(); ++i) order.push_back(ids_.id_at(i));
+  begin_reorder_ids(std::move(order));
 
-  auto element_index = entry & OUTER_MASK;
-  DCHECK_LT(element_index, elements_.size());
-  DCHECK_EQ(index_to_outer_[element_index], outer_id);
+  reorder_sort_ = std::make_shared<TypedReorderSort<Compare>>(
+      std::move(compare));
+  reorder_buffer_.resize(reorder_ids_.size());
+  reorder_phase_ = ReorderPhase::SORT;
+  reorder_width_ = 1;
+  reorder_left_ = reorder_out_ = 0;
+  reorder_right_ = std::min<size_type>(1, reorder_ids_.size());
+}
 
-  return elements_[element_index];
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
+void BasicIdVector<ElemType, IdType, OUTER_BITS>::begin_reorder_ids(
+    std::vector<Id> order) {
+  reorder_ids_ = std::move(order);
+  reorder_sort_ = nullptr;
+  reorder_phase_ = ReorderPhase::APPLY;
+  reorder_out_ = reorder_place_ = 0;
 }
 
 template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
-typename BasicIdVector<ElemType, IdType, OUTER_BITS>::Id
-    BasicIdVector<ElemType, IdType, OUTER_BITS>::create_id() {
-  const auto element_index = static_cast<Id>(elements_.size());
-  DCHECK_LT(element_index, MAX_INDEX);
-  if (last_free_ == INVALID_INDEX) {
-    DCHECK_EQ(first_free_, INVALID_INDEX);
-    outer_to_index_.push_back(element_index | 0);
-    return outer_to_index_.size() - 1;
-  } else {
-    DCHECK_NE(first_free_, INVALID_INDEX);
-    auto& free_index = outer_to_index_[first_free_];
-    const auto inner_id = free_index & INNER_MASK;
-    const auto outer_id = first_free_;
-    first_free_ = free_index & OUTER_MASK;
-    if (first_free_ == INVALID_INDEX) last_free_ = INVALID_INDEX;
-    free_index = inner_id | element_index;
-
-    return inner_id | outer_id;
+bool BasicIdVector<ElemType, IdType, OUTER_BITS>::reorder_step(
+    size_type budget) {
+  if (reorder_phase_ == ReorderPhase::SORT) {
+    budget = reorder_sort_->step(*this, budget);
   }
+  if (reorder_phase_ == ReorderPhase::APPLY) reorder_apply(budget);
+  return reorder_phase_ == ReorderPhase::NONE;
 }
 
 template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
-void BasicIdVector<ElemType, IdType, OUTER_BITS>::free_id(Id freed_id) {
-  const auto outer_freed_id = freed_id & OUTER_MASK;
-  const auto inner_freed_id = freed_id & INNER_MASK;
-  DCHECK_LE(outer_freed_id, outer_to_index_.size());
+template<typename Compare>
+void BasicIdVector<ElemType, IdType, OUTER_BITS>::reorder(Compare compare) {
+  begin_reorder(std::move(compare));
+  while (!reorder_step(MAX_SIZE)) {}
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
+template<typename Compare>
+typename BasicIdVector<ElemType, IdType, OUTER_BITS>::size_type
+BasicIdVector<ElemType, IdType, OUTER_BITS>::reorder_sort(
+    const Compare& compare, size_type budget) {
+  const auto num_ids = static_cast<size_type>(reorder_ids_.size());
 
-  auto& freed_entry = outer_to_index_[outer_freed_id];
-  DCHECK_EQ(inner_freed_id, freed_entry & INNER_MASK);
+  // The merge of runs [left_begin, mid) and [mid, right_end) is in progress,
+  // with reorder_left_, reorder_right_ and reorder_out_ as cursors. Nothing
+  // moves during a step, so the elements at the two cursors are looked up
+  // once each, as they advance. Ids erased since begin_reorder() (null
+  // elements) sort after all the valid ones.
+  while (budget > 0 && reorder_width_ < num_ids) {
+    const auto width = reorder_width_;
+    const auto left_begin = reorder_out_ - (reorder_out_ % (2 * width));
+    const auto mid = std::min<size_type>(left_begin + width, num_ids);
+    const auto right_end = std::min<size_type>(mid + width, num_ids);
 
-  const auto element_index = freed_entry & OUTER_MASK;
-  // Move last element in place of freed element.
-  elements_[element_index] = std::move(elements_.back());
-  elements_.pop_back();
+    // Local copies of the cursors, which the stores to reorder_buffer_ cannot
+    // alias; the run to take from is selected without a branch.
+    auto i_left = reorder_left_;
+    auto i_right = reorder_right_;
+    auto i_out = reorder_out_;
+    const auto out_end = std::min<size_type>(right_end, i_out + budget);
+    budget -= out_end - i_out;
+
+    const value_type* left = reorder_element(i_left, mid);
+    const value_type* right = reorder_element(i_right, right_end);
+    while (i_out < out_end) {
+      const bool take_left =
+          i_left < mid && (i_right >= right_end || !right ||
+                           (left && !compare(*right, *left)));
+      reorder_buffer_[i_out++] = reorder_ids_[take_left ? i_left : i_right];
+      i_left += take_left;
+      i_right += !take_left;
+      const value_type* next = take_left ? reorder_element(i_left, mid)
+                                         : reorder_element(i_right, right_end);
+      left = take_left ? next : left;
+      right = take_left ? right : next;
+    }
+    reorder_left_ = i_left;
+    reorder_right_ = i_right;
+    reorder_out_ = i_out;
+    if (reorder_out_ < right_end) break;  // Out of budget mid-merge.
+
+    if (reorder_out_ == num_ids) {
+      // Pass complete, double the run width.
+      reorder_ids_.swap(reorder_buffer_);
+      reorder_width_ *= 2;
+      reorder_out_ = 0;
+    }
+    reorder_left_ = reorder_out_;
+    reorder_right_ = std::min<size_type>(reorder_out_ + reorder_width_,
+                                         num_ids);
+  }
+
+  if (reorder_width_ >= num_ids) {
+    reorder_phase_ = ReorderPhase::APPLY;
+    reorder_out_ = reorder_place_ = 0;
+  }
+  return budget;
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
+typename BasicIdVector<ElemType, IdType, OUTER_BITS>::size_type
+BasicIdVector<ElemType, IdType, OUTER_BITS>::reorder_apply(size_type budget) {
+  const auto num_ids = static_cast<size_type>(reorder_ids_.size());
+  for (; budget > 0 && reorder_out_ < num_ids && reorder_place_ < size();
+       --budget) {
+    const auto id = reorder_ids_[reorder_out_++];
+    if (!is_valid_id(id)) continue;
+
+    const auto index = ids_.index_of(id);
+    if (index != reorder_place_) {
+      using std::swap;
+      swap(elements_[index], elements_[reorder_place_]);
+      ids_.swap_indices(index, reorder_place_);
+    }
+    ++reorder_place_;
+  }
+
+  if (reorder_out_ == num_ids || reorder_place_ >= size()) end_reorder();
+  return budget;
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
+void BasicIdVector<ElemType, IdType, OUTER_BITS>::end_reorder() {
+  reorder_phase_ = ReorderPhase::NONE;
+  reorder_sort_ = nullptr;
+  reorder_ids_.clear();
+  reorder_buffer_.clear();
+}
 
-  index_to_outer_[element_index] = index_to_outer_.back();
-  index_to_outer_.pop_back();
-
-  // Update the outer_to_index_ entry of the last element to point to the new
-  // position.
-  auto& last_element_entry = outer_to_index_[index_to_outer_[element_index]];
-  last_element_entry = (last_element_entry & ~OUTER_MASK) | element_index;
-
-  // Add freed entry at the end of free list and mark it as end-of-list.
-  freed_entry =
-      (((freed_entry & INNER_MASK) + (1 << OUTER_BITS)) & INNER_MASK) |
-      OUTER_MASK;
-  if (last_free_ == INVALID_INDEX) {
-    DCHECK_EQ(first_free_, INVALID_INDEX);
-    last_free_ = first_free_ = outer_freed_id;  // List was empty.
-  } else {
-    outer_to_index_[last_free_] &= INNER_MASK | outer_freed_id;
-    last_free_ = outer_freed_id;
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
+const typename BasicIdVector<ElemType, IdType, OUTER_BITS>::value_type*
+BasicIdVector<ElemType, IdType, OUTER_BITS>::reorder_element(
+    size_type i, size_type end) const {
+  if (i >= end) return nullptr;
+  const auto id = reorder_ids_[i];
+  return is_valid_id(id) ? &elements_[ids_.index_of(id)] : nullptr;
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
+void BasicIdVector<ElemType, IdType, OUTER_BITS>::free_id(Id freed_id) {
+  const auto element_index = ids_.free_id(freed_id);
+  // Move last element in place of freed element.
+  if (element_index != elements_.size() - 1) {
+    elements_[element_index] = std::move(elements_.back());
   }
+  elements_.pop_back();
 }
 
 }  // namespace sparks
@@ -0,0 +1,101 @@
+#include "id_vector.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace sparks {
+namespace {
+
+struct Element {
+  explicit Element(int64_t x) : x{x} {}
+  int64_t x;
+};
+
+using IdVector = IdVector32<Element, 20>;
+using Id = IdVector::Id;
+
+// Emplaces a batch of state.range(0) elements, then erases them all.
+void BM_IdVectorEmplaceErase(benchmark::State& state) {
+  const auto batch = static_cast<IdVector::size_type>(state.range(0));
+  IdVector vector{batch, batch};
+  std::vector<Id> ids(batch);
+  for (auto _ : state) {
+    for (IdVector::size_type i = 0; i < batch; ++i) ids[i] = vector.emplace(i);
+    for (auto id : ids) vector.erase(id);
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_IdVectorEmplaceErase)->RangeMultiplier(8)->Range(8, 32768);
+
+// The same through emplace_batch() and erase_batch().
+void BM_IdVectorEmplaceEraseBatch(benchmark::State& state) {
+  const auto batch = static_cast<IdVector::size_type>(state.range(0));
+  IdVector vector{batch, batch};
+  std::vector<Id> ids(batch);
+  for (auto _ : state) {
+    vector.emplace_batch(batch, ids.begin(), 1);
+    vector.erase_batch(ids);
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_IdVectorEmplaceEraseBatch)->RangeMultiplier(8)->Range(8, 32768);
+
+// Lookups by id, hopping around the vector.
+void BM_IdVectorLookup(benchmark::State& state) {
+  const auto count = static_cast<IdVector::size_type>(state.range(0));
+  IdVector vector{count, count};
+  std::vector<Id> ids(count);
+  for (IdVector::size_type i = 0; i < count; ++i) ids[i] = vector.emplace(i);
+
+  int64_t sum = 0;
+  size_t i_id = 0;
+  for (auto _ : state) {
+    sum += vector[ids[i_id]].x;
+    i_id = (i_id + 7919) % count;
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IdVectorLookup)->RangeMultiplier(8)->Range(64, 262144);
+
+// Linear iteration over the packed elements, the reason the vector is packed.
+void BM_IdVectorIterate(benchmark::State& state) {
+  const auto count = static_cast<IdVector::size_type>(state.range(0));
+  IdVector vector{count, count};
+  for (IdVector::size_type i = 0; i < count; ++i) vector.emplace(i);
+
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (const auto& element : vector) sum += element.x;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_IdVectorIterate)->RangeMultiplier(8)->Range(64, 262144);
+
+uint32_t scramble(int64_t x) { return static_cast<uint32_t>(x * 2654435761u); }
+
+// A full incremental reordering of state.range(0) elements, in steps of 1024
+// units of work. Alternates between two unrelated orders, so that each run
+// starts from a scrambled one.
+void BM_IdVectorReorderSteps(benchmark::State& state) {
+  const auto count = static_cast<IdVector::size_type>(state.range(0));
+  IdVector vector{count, count};
+  for (IdVector::size_type i = 0; i < count; ++i) vector.emplace(i);
+
+  bool by_hash = false;
+  for (auto _ : state) {
+    vector.begin_reorder([by_hash](const Element& a, const Element& b) {
+      return by_hash ? scramble(a.x) < scramble(b.x) : a.x < b.x;
+    });
+    while (!vector.reorder_step(1024)) {}
+    by_hash = !by_hash;
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_IdVectorReorderSteps)->RangeMultiplier(8)->Range(64, 262144);
+
+}  // namespace
+}  // namespace sparks
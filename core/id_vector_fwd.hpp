@@ -2,8 +2,11 @@
 #define SPARKS_CORE_ID_VECTOR_FWD_HPP_
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
+#include "id_index_map_fwd.hpp"
+
 namespace sparks {
 
 template<typename ElemType, typename IdType, uint8_t OUTER_BITS>
@@ -16,15 +19,13 @@ class BasicIdVector {
   using value_type = ElemType;
   using reference_type = ElemType&;
   using pointer_type = ElemType*;
+  using IndexMap = BasicIdIndexMap<IdType, OUTER_BITS>;
 
-  static_assert(OUTER_BITS < sizeof(IdType) * 8,
-                "There needs to be at least one inner bit.");
-
-  static const Id OUTER_MASK = (1 << OUTER_BITS) - 1;
-  static const Id INNER_MASK = ~OUTER_MASK;
-  static const Id MAX_INDEX = OUTER_MASK - 1;
-  static const Id INVALID_INDEX = OUTER_MASK;
-  static const size_type MAX_SIZE = MAX_INDEX + 1;
+  static const Id OUTER_MASK = IndexMap::OUTER_MASK;
+  static const Id INNER_MASK = IndexMap::INNER_MASK;
+  static const Id MAX_INDEX = IndexMap::MAX_INDEX;
+  static const Id INVALID_INDEX = IndexMap::INVALID_INDEX;
+  static const size_type MAX_SIZE = IndexMap::MAX_SIZE;
 
   inline BasicIdVector(size_type min_ids, size_type min_elements);
 
@@ -40,9 +41,43 @@ class BasicIdVector {
   inline Id insert(const value_type& value);
 
   inline void erase(Id id);
+
+  // Emplaces `count` copies of value_type(args...) and writes their ids to
+  // `ids_out`.
+  template<typename IdOutputIter, typename ...Args>
+  inline IdOutputIter emplace_batch(size_type count, IdOutputIter ids_out,
+                                    const Args& ...args);
+
+  // Erases all the valid ids in a range. Unlike repeated erase() calls, every
+  // surviving element is moved at most once. Returns the number of erased
+  // elements.
+  template<typename IdInputIter>
+  inline size_type erase_batch(IdInputIter begin, IdInputIter end);
+  template<typename IdRange>
+  inline size_type erase_batch(const IdRange& ids);
   inline value_type& operator[](Id id);
   inline const value_type& operator[](Id id) const;
 
+  // Incremental reordering of the packed elements, e.g. to restore spatial or
+  // parent-before-child order after swap-removes have scrambled it. Ids stay
+  // valid throughout and the vector may be modified between steps, in which
+  // case the final order is only approximately the requested one.
+  //
+  // begin_reorder() snapshots the current ids to be sorted by `compare`,
+  // begin_reorder_ids() takes the desired order directly (stale ids are
+  // skipped). reorder_step() then does at most `budget` units of work (one
+  // unit is a merge output while sorting or an element swap/skip while
+  // applying) and returns true once the reordering is complete.
+  template<typename Compare>
+  inline void begin_reorder(Compare compare);
+  inline void begin_reorder_ids(std::vector<Id> order);
+  inline bool reorder_step(size_type budget);
+  bool is_reordering() const { return reorder_phase_ != ReorderPhase::NONE; }
+
+  // Reorders all the elements in one go.
+  template<typename Compare>
+  inline void reorder(Compare compare);
+
   bool empty() const { return elements_.empty(); }
   size_type size() const { return static_cast<size_type>(elements_.size()); }
   size_type capacity() const {
@@ -59,15 +94,52 @@ class BasicIdVector {
   iterator end() { return elements_.end(); }
 
  private:
-  inline Id create_id();
+  enum class ReorderPhase { NONE, SORT, APPLY };
+
+  // The comparator of begin_reorder(), behind one virtual call per
+  // reorder_step() so that the merge loop is instantiated for (and inlines)
+  // the comparator itself.
+  struct ReorderSort {
+    virtual ~ReorderSort() {}
+    virtual size_type step(BasicIdVector& vector, size_type budget) const = 0;
+  };
+
+  template<typename Compare>
+  struct TypedReorderSort : ReorderSort {
+    explicit TypedReorderSort(Compare compare) : compare(std::move(compare)) {}
+
+    size_type step(BasicIdVector& vector, size_type budget) const override {
+      return vector.reorder_sort(compare, budget);
+    }
+
+    Compare compare;
+  };
+
   inline void free_id(Id freed_id);
 
-  std::vector<size_type> outer_to_index_;
-  std::vector<size_type> index_to_outer_;
+  // Budgeted bottom-up merge sort of reorder_ids_; returns remaining budget.
+  template<typename Compare>
+  inline size_type reorder_sort(const Compare& compare, size_type budget);
+  inline size_type reorder_apply(size_type budget);
+  inline void end_reorder();
+
+  // The element of reorder_ids_[i], or null if i is end or the id was erased
+  // since begin_reorder().
+  inline const value_type* reorder_element(size_type i, size_type end) const;
+
+  IndexMap ids_;
   std::vector<value_type> elements_;
 
-  size_type first_free_ = INVALID_INDEX;
-  size_type last_free_ = INVALID_INDEX;
+  // Incremental reordering state.
+  ReorderPhase reorder_phase_ = ReorderPhase::NONE;
+  std::shared_ptr<const ReorderSort> reorder_sort_;
+  std::vector<Id> reorder_ids_;
+  std::vector<Id> reorder_buffer_;
+  size_type reorder_width_ = 0;   // Run width of the current merge pass.
+  size_type reorder_left_ = 0;    // Cursor in the left run.
+  size_type reorder_right_ = 0;   // Cursor in the right run.
+  size_type reorder_out_ = 0;     // Merge output / next id to place.
+  size_type reorder_place_ = 0;   // Next packed index to fill.
 };
 
 template<class ElemType, uint8_t OUTER_BITS = 24>
@@ -0,0 +1,274 @@
+#include "id_vector.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+using Vector = IdVector32<int>;
+
+// Fills a vector with the values [0, count) in a scrambled order and records
+// the id of each.
+std::map<uint32_t, int> fill_scrambled(Vector& vector, int count,
+                                       uint32_t seed) {
+  std::vector<int> values(count);
+  for (int i = 0; i < count; ++i) values[i] = i;
+  std::shuffle(values.begin(), values.end(), std::mt19937{seed});
+
+  std::map<uint32_t, int> reference;
+  for (auto value : values) reference[vector.emplace(value)] = value;
+  return reference;
+}
+
+// Every id in `reference` (and no other) maps to its value.
+void expect_matches(const Vector& vector,
+                    const std::map<uint32_t, int>& reference) {
+  ASSERT_EQ(reference.size(), size_t{vector.size()});
+  for (const auto& id_and_value : reference) {
+    ASSERT_TRUE(vector.is_valid_id(id_and_value.first));
+    EXPECT_EQ(id_and_value.second, vector[id_and_value.first]);
+  }
+}
+
+TEST(IdVectorTest, ReorderSortsAndKeepsIds) {
+  Vector vector{0, 0};
+  const auto reference = fill_scrambled(vector, 1000, 1);
+  vector.reorder(std::less<int>{});
+  EXPECT_FALSE(vector.is_reordering());
+  EXPECT_TRUE(std::is_sorted(vector.begin(), vector.end()));
+  expect_matches(vector, reference);
+
+  // Descending, and with the runs' sizes not a power of two.
+  vector.erase(reference.begin()->first);
+  vector.reorder(std::greater<int>{});
+  EXPECT_TRUE(std::is_sorted(vector.begin(), vector.end(),
+                             std::greater<int>{}));
+}
+
+// The same result as reorder(), in steps which do at most `budget` work each:
+// sorting n elements takes n * ceil(log2(n)) units, applying at most n more.
+TEST(IdVectorTest, ReorderStepIsBudgeted) {
+  const int NUM_ELEMENTS = 64;
+  for (uint32_t budget : {1u, 3u, 64u, 1000u}) {
+    Vector vector{0, 0};
+    const auto reference = fill_scrambled(vector, NUM_ELEMENTS, budget);
+    vector.begin_reorder(std::less<int>{});
+    EXPECT_TRUE(vector.is_reordering());
+
+    uint32_t num_steps = 1;
+    while (!vector.reorder_step(budget)) ++num_steps;
+    EXPECT_FALSE(vector.is_reordering());
+    EXPECT_LE(num_steps, (NUM_ELEMENTS * 7 + budget - 1) / budget);
+    if (budget == 1) {
+      EXPECT_GE(num_steps, uint32_t{NUM_ELEMENTS * 6});
+    }
+
+    EXPECT_TRUE(std::is_sorted(vector.begin(), vector.end()));
+    expect_matches(vector, reference);
+  }
+}
+
+// Elements emplaced while sorting end up after the sorted ones.
+TEST(IdVectorTest, EmplaceWhileSorting) {
+  const int NUM_ELEMENTS = 64;
+  Vector vector{0, 0};
+  auto reference = fill_scrambled(vector, NUM_ELEMENTS, 2);
+  vector.begin_reorder(std::less<int>{});
+
+  // Sorting takes 64 * 6 units, so all of these happen before applying.
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_FALSE(vector.reorder_step(1));
+    if (i % 2 == 0) {
+      const int value = NUM_ELEMENTS + i;
+      reference[vector.emplace(value)] = value;
+    }
+  }
+  while (!vector.reorder_step(7)) {}
+
+  expect_matches(vector, reference);
+  const auto first_new = vector.begin() + NUM_ELEMENTS;
+  EXPECT_TRUE(std::is_sorted(vector.begin(), first_new));
+  EXPECT_EQ(NUM_ELEMENTS - 1, *(first_new - 1));
+  EXPECT_TRUE(std::all_of(first_new, vector.end(),
+                          [](int x) { return x >= NUM_ELEMENTS; }));
+}
+
+// Elements erased while sorting are skipped; the survivors stay reachable
+// through their ids (their order is only approximate).
+TEST(IdVectorTest, EraseWhileSorting) {
+  Vector vector{0, 0};
+  auto reference = fill_scrambled(vector, 64, 3);
+  vector.begin_reorder(std::less<int>{});
+
+  std::mt19937 random{3};
+  for (int i = 0; i < 32; ++i) {
+    ASSERT_FALSE(vector.reorder_step(3));
+    auto erased = reference.begin();
+    std::advance(erased, random() % reference.size());
+    vector.erase(erased->first);
+    reference.erase(erased);
+  }
+  while (!vector.reorder_step(7)) {}
+  expect_matches(vector, reference);
+
+  // Another reorder without interference sorts them exactly.
+  vector.reorder(std::less<int>{});
+  EXPECT_TRUE(std::is_sorted(vector.begin(), vector.end()));
+  expect_matches(vector, reference);
+}
+
+// Arbitrary modifications during both phases leave the order approximate but
+// the ids intact.
+TEST(IdVectorTest, ModifyWhileReordering) {
+  Vector vector{0, 0};
+  auto reference = fill_scrambled(vector, 200, 4);
+  std::mt19937 random{5};
+  for (int round = 0; round < 20; ++round) {
+    vector.begin_reorder(std::less<int>{});
+    while (!vector.reorder_step(5)) {
+      // Keep the size around 200 so that every round takes as long.
+      if (reference.size() >= 200 || random() % 2) {
+        auto erased = reference.begin();
+        std::advance(erased, random() % reference.size());
+        vector.erase(erased->first);
+        reference.erase(erased);
+      } else {
+        const int value = static_cast<int>(random() % 1000);
+        reference[vector.emplace(value)] = value;
+      }
+    }
+    expect_matches(vector, reference);
+  }
+}
+
+// begin_reorder_ids() places the given ids first, in order, skipping stale
+// ones; the remaining elements follow.
+TEST(IdVectorTest, ReorderToGivenIds) {
+  Vector vector{0, 0};
+  std::vector<uint32_t> ids;
+  for (int i = 0; i < 10; ++i) ids.push_back(vector.emplace(i));
+  const auto stale = ids[5];
+  vector.erase(stale);
+
+  vector.begin_reorder_ids({ids[9], stale, ids[2], ids[7], ids[0]});
+  while (!vector.reorder_step(1)) {}
+
+  const std::vector<int> prefix(vector.begin(), vector.begin() + 4);
+  EXPECT_EQ((std::vector<int>{9, 2, 7, 0}), prefix);
+  std::vector<int> rest(vector.begin() + 4, vector.end());
+  std::sort(rest.begin(), rest.end());
+  EXPECT_EQ((std::vector<int>{1, 3, 4, 6, 8}), rest);
+  for (int i = 0; i < 10; ++i) {
+    if (i != 5) {
+      EXPECT_EQ(i, vector[ids[i]]);
+    }
+  }
+}
+
+// Counts the moves into elements, to check that erase_batch() moves each
+// survivor at most once.
+struct Counted {
+  explicit Counted(int value) : value{value} {}
+  Counted(const Counted&) = default;
+  Counted(Counted&&) = default;
+  Counted& operator=(const Counted&) = default;
+  Counted& operator=(Counted&& other) {
+    value = other.value;
+    ++num_moves;
+    return *this;
+  }
+
+  int value;
+
+  static int num_moves;
+};
+
+int Counted::num_moves = 0;
+
+TEST(IdVectorTest, EmplaceBatch) {
+  Vector vector{0, 0};
+  const auto single = vector.emplace(-1);
+  std::vector<uint32_t> ids;
+  vector.emplace_batch(100, std::back_inserter(ids), 42);
+  ASSERT_EQ(100u, ids.size());
+  EXPECT_EQ(101u, vector.size());
+  EXPECT_EQ(-1, vector[single]);
+  for (auto id : ids) EXPECT_EQ(42, vector[id]);
+
+  // Batches reuse freed ids, with new tags.
+  const auto freed = ids.front();
+  vector.erase(freed);
+  std::vector<uint32_t> more(3);
+  EXPECT_EQ(more.end(), vector.emplace_batch(3, more.begin(), 7));
+  EXPECT_EQ(freed & Vector::OUTER_MASK, more[0] & Vector::OUTER_MASK);
+  EXPECT_NE(freed, more[0]);
+  EXPECT_FALSE(vector.is_valid_id(freed));
+  for (auto id : more) EXPECT_EQ(7, vector[id]);
+}
+
+TEST(IdVectorTest, EraseBatch) {
+  const int NUM_ELEMENTS = 100;
+  IdVector32<Counted> vector{0, 0};
+  std::vector<uint32_t> ids;
+  for (int i = 0; i < NUM_ELEMENTS; ++i) ids.push_back(vector.emplace(i));
+
+  // Every third id, plus a repeated and a stale one which are ignored.
+  const auto stale = ids[1];
+  vector.erase(stale);
+  std::vector<uint32_t> erased;
+  for (int i = 0; i < NUM_ELEMENTS; i += 3) erased.push_back(ids[i]);
+  erased.push_back(ids[0]);
+  erased.push_back(stale);
+
+  Counted::num_moves = 0;
+  const auto num_erased = vector.erase_batch(erased);
+  EXPECT_EQ(34u, num_erased);
+  EXPECT_EQ(uint32_t{NUM_ELEMENTS - 35}, vector.size());
+  EXPECT_LE(Counted::num_moves, 34);
+
+  for (int i = 0; i < NUM_ELEMENTS; ++i) {
+    const bool alive = i % 3 != 0 && i != 1;
+    ASSERT_EQ(alive, vector.is_valid_id(ids[i])) << i;
+    if (alive) {
+      EXPECT_EQ(i, vector[ids[i]].value);
+    }
+  }
+  EXPECT_EQ(0u, vector.erase_batch(erased));
+}
+
+// Batched and single operations in a random mix against a reference map.
+TEST(IdVectorTest, RandomBatchesMatchReference) {
+  Vector vector{0, 0};
+  std::map<uint32_t, int> reference;
+  std::mt19937 random{6};
+  for (int round = 0; round < 200; ++round) {
+    const int value = round;
+    std::vector<uint32_t> ids;
+    vector.emplace_batch(random() % 20, std::back_inserter(ids), value);
+    for (auto id : ids) EXPECT_TRUE(reference.emplace(id, value).second);
+
+    std::vector<uint32_t> erased;
+    for (const auto& id_and_value : reference) {
+      if (random() % 4 == 0) erased.push_back(id_and_value.first);
+    }
+    EXPECT_EQ(erased.size(), size_t{vector.erase_batch(erased)});
+    for (auto id : erased) reference.erase(id);
+
+    if (!reference.empty() && random() % 2) {
+      vector.erase(reference.begin()->first);
+      reference.erase(reference.begin());
+    }
+    expect_matches(vector, reference);
+  }
+}
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,209 @@
+#include "io_ring.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <glog/logging.h>
+
+namespace sparks {
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && \
+    defined(IORING_FEAT_RW_CUR_POS)
+
+namespace {
+
+int io_uring_setup(uint32_t num_entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, num_entries, params));
+}
+
+int io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete,
+                   uint32_t flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+void* map_ring(int fd, size_t size, off_t offset) {
+  void* ring = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, offset);
+  return ring == MAP_FAILED ? nullptr : ring;
+}
+
+uint32_t* ring_field(void* ring, uint32_t offset) {
+  return reinterpret_cast<uint32_t*>(static_cast<char*>(ring) + offset);
+}
+
+}  // namespace
+
+std::unique_ptr<IoRing> IoRing::create(uint32_t num_entries) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  const int fd = io_uring_setup(num_entries, &params);
+  if (fd < 0) {
+    LOG(WARNING) << "io_uring unavailable: " << std::strerror(errno);
+    return nullptr;
+  }
+
+  std::unique_ptr<IoRing> ring{new IoRing};
+  ring->fd_ = fd;
+  // IORING_FEAT_RW_CUR_POS came with IORING_OP_READ, in Linux 5.6.
+  if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+    LOG(WARNING) << "io_uring lacks IORING_OP_READ.";
+    return nullptr;
+  }
+
+  ring->submission_ring_size_ =
+      params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  ring->completion_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    ring->submission_ring_size_ = ring->completion_ring_size_ = std::max(
+        ring->submission_ring_size_, ring->completion_ring_size_);
+  }
+
+  ring->submission_ring_ =
+      map_ring(fd, ring->submission_ring_size_, IORING_OFF_SQ_RING);
+  if (!ring->submission_ring_) return nullptr;
+  if (single_mmap) {
+    ring->completion_ring_ = ring->submission_ring_;
+  } else {
+    ring->completion_ring_ =
+        map_ring(fd, ring->completion_ring_size_, IORING_OFF_CQ_RING);
+    if (!ring->completion_ring_) return nullptr;
+  }
+  ring->submission_entries_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  ring->submission_entries_ =
+      map_ring(fd, ring->submission_entries_size_, IORING_OFF_SQES);
+  if (!ring->submission_entries_) return nullptr;
+
+  void* sq = ring->submission_ring_;
+  ring->submission_head_ = ring_field(sq, params.sq_off.head);
+  ring->submission_tail_ = ring_field(sq, params.sq_off.tail);
+  ring->submission_mask_ = *ring_field(sq, params.sq_off.ring_mask);
+  ring->num_submission_entries_ = params.sq_entries;
+  ring->submission_array_ = ring_field(sq, params.sq_off.array);
+
+  void* cq = ring->completion_ring_;
+  ring->completion_head_ = ring_field(cq, params.cq_off.head);
+  ring->completion_tail_ = ring_field(cq, params.cq_off.tail);
+  ring->completion_mask_ = *ring_field(cq, params.cq_off.ring_mask);
+  ring->completion_entries_ = ring_field(cq, params.cq_off.cqes);
+  ring->num_completion_entries_ = params.cq_entries;
+  return ring;
+}
+
+IoRing::~IoRing() {
+  if (submission_entries_) {
+    munmap(submission_entries_, submission_entries_size_);
+  }
+  if (completion_ring_ && completion_ring_ != submission_ring_) {
+    munmap(completion_ring_, completion_ring_size_);
+  }
+  if (submission_ring_) munmap(submission_ring_, submission_ring_size_);
+  if (fd_ >= 0) close(fd_);
+}
+
+bool IoRing::prepare_read(int fd, void* buffer, uint32_t length,
+                          uint64_t offset, uint64_t user_data) {
+  return prepare(IORING_OP_READ, fd, buffer, length, offset, user_data);
+}
+
+bool IoRing::prepare_nop(uint64_t user_data) {
+  return prepare(IORING_OP_NOP, -1, nullptr, 0, 0, user_data);
+}
+
+bool IoRing::prepare(uint8_t opcode, int fd, void* buffer, uint32_t length,
+                     uint64_t offset, uint64_t user_data) {
+  const uint32_t tail = *submission_tail_;
+  const uint32_t head = __atomic_load_n(submission_head_, __ATOMIC_ACQUIRE);
+  if (tail - head == num_submission_entries_) return false;
+
+  const uint32_t index = tail & submission_mask_;
+  auto& entry = static_cast<io_uring_sqe*>(submission_entries_)[index];
+  std::memset(&entry, 0, sizeof(entry));
+  entry.opcode = opcode;
+  entry.fd = fd;
+  entry.addr = reinterpret_cast<uint64_t>(buffer);
+  entry.len = length;
+  entry.off = offset;
+  entry.user_data = user_data;
+
+  submission_array_[index] = index;
+  __atomic_store_n(submission_tail_, tail + 1, __ATOMIC_RELEASE);
+  ++num_prepared_;
+  return true;
+}
+
+int IoRing::submit() {
+  int num_submitted = 0;
+  while (num_prepared_ > 0) {
+    const int result = io_uring_enter(fd_, num_prepared_, 0, 0);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      return -errno;
+    }
+    // Nothing consumed would make no progress however often it is retried.
+    if (result == 0) return -EBUSY;
+    num_prepared_ -= result;
+    num_submitted += result;
+  }
+  return num_submitted;
+}
+
+void IoRing::wait() {
+  while (__atomic_load_n(completion_tail_, __ATOMIC_ACQUIRE) ==
+         *completion_head_) {
+    if (io_uring_enter(fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+        errno != EINTR) {
+      LOG(FATAL) << "io_uring_enter: " << std::strerror(errno);
+    }
+  }
+}
+
+bool IoRing::pop_completion(Completion& completion) {
+  const uint32_t head = *completion_head_;
+  if (head == __atomic_load_n(completion_tail_, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+
+  const auto& entry =
+      static_cast<io_uring_cqe*>(completion_entries_)[head & completion_mask_];
+  completion.user_data = entry.user_data;
+  completion.result = entry.res;
+  __atomic_store_n(completion_head_, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+#else  // io_uring is not available.
+
+std::unique_ptr<IoRing> IoRing::create(uint32_t) { return nullptr; }
+
+IoRing::~IoRing() {}
+
+bool IoRing::prepare_read(int, void*, uint32_t, uint64_t, uint64_t) {
+  return false;
+}
+
+bool IoRing::prepare_nop(uint64_t) { return false; }
+
+bool IoRing::prepare(uint8_t, int, void*, uint32_t, uint64_t, uint64_t) {
+  return false;
+}
+
+int IoRing::submit() { return -ENOSYS; }
+
+void IoRing::wait() {}
+
+bool IoRing::pop_completion(Completion&) { return false; }
+
+#endif
+
+}  // namespace sparks
@@ -0,0 +1,103 @@
+#ifndef SPARKS_CORE_IO_RING_HPP_
+#define SPARKS_CORE_IO_RING_HPP_
+
+#include <cstdint>
+#include <memory>
+
+namespace sparks {
+
+// A minimal io_uring for asynchronous reads, on the raw syscalls rather than
+// liburing. Reads are prepared into the submission queue, submitted with a
+// single syscall, and their results reaped from the completion queue by one
+// consumer thread, which can block in wait() meanwhile.
+//
+// prepare_*() and submit() must be serialized by the caller; wait() and
+// reap() may run concurrently with them, on one thread.
+class IoRing {
+ public:
+  // Returns nullptr where io_uring (with IORING_OP_READ, Linux 5.6) is not
+  // available: other platforms, older kernels or a seccomp filter.
+  static std::unique_ptr<IoRing> create(uint32_t num_entries);
+
+  ~IoRing();
+
+  IoRing(const IoRing&) = delete;
+  IoRing& operator=(const IoRing&) = delete;
+
+  // The most operations which can be in flight without the completion queue
+  // overflowing.
+  uint32_t max_in_flight() const { return num_completion_entries_; }
+
+  // Queues a read like pread(fd, buffer, length, offset), whose result will
+  // be reaped with user_data. Returns false if the submission queue is full.
+  bool prepare_read(int fd, void* buffer, uint32_t length, uint64_t offset,
+                    uint64_t user_data);
+
+  // Queues an operation which does nothing, e.g. to wake up wait().
+  bool prepare_nop(uint64_t user_data);
+
+  // Submits the prepared operations. Returns the number submitted or -errno,
+  // which is -EBUSY if the kernel consumed none of them.
+  int submit();
+
+  // Blocks until there is at least one completion to reap.
+  void wait();
+
+  // Calls callback(user_data, result) for every completed operation, where
+  // result is what the syscall would have returned, or -errno. Returns the
+  // number of completions.
+  template <typename Callback>
+  uint32_t reap(Callback&& callback);
+
+ private:
+  struct Completion {
+    uint64_t user_data;
+    int32_t result;
+  };
+
+  IoRing() = default;
+
+  bool prepare(uint8_t opcode, int fd, void* buffer, uint32_t length,
+               uint64_t offset, uint64_t user_data);
+
+  // Pops the next completion into completion, if there is one.
+  bool pop_completion(Completion& completion);
+
+  int fd_{-1};
+  uint32_t num_completion_entries_{0};
+  uint32_t num_prepared_{0};
+
+  // The mmap()ed rings, shared with the kernel.
+  void* submission_ring_{nullptr};
+  size_t submission_ring_size_{0};
+  void* completion_ring_{nullptr};
+  size_t completion_ring_size_{0};
+  void* submission_entries_{nullptr};
+  size_t submission_entries_size_{0};
+
+  // Pointers into the rings.
+  uint32_t* submission_head_{nullptr};
+  uint32_t* submission_tail_{nullptr};
+  uint32_t submission_mask_{0};
+  uint32_t num_submission_entries_{0};
+  uint32_t* submission_array_{nullptr};
+  uint32_t* completion_head_{nullptr};
+  uint32_t* completion_tail_{nullptr};
+  uint32_t completion_mask_{0};
+  void* completion_entries_{nullptr};
+};
+
+template <typename Callback>
+uint32_t IoRing::reap(Callback&& callback) {
+  uint32_t num_completions = 0;
+  Completion completion;
+  while (pop_completion(completion)) {
+    callback(completion.user_data, completion.result);
+    ++num_completions;
+  }
+  return num_completions;
+}
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_IO_RING_HPP_
@@ -0,0 +1,170 @@
+#ifndef SPARKS_CORE_MPMC_QUEUE_HPP_
+#define SPARKS_CORE_MPMC_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "cache_line.hpp"
+
+namespace sparks {
+
+// A bounded, lock-free queue between any number of producer and consumer
+// threads, after Dmitry Vyukov's: every cell carries a sequence number which
+// says whose turn it is. A cell at position p is free for the producer
+// claiming p when its sequence is p, holds an element for the consumer
+// claiming p when it is p + 1, and is freed for the producer of the next lap
+// by setting it to p + CAPACITY. Claiming a position is a single CAS on the
+// tail (or head) index, and producers and consumers only meet on the cells.
+template <class Element_, size_t CAPACITY_BITS, typename Size_ = uint32_t>
+class alignas(CACHE_LINE_SIZE) MpmcQueue {
+ public:
+  using Element = Element_;
+  using Size = Size_;
+
+  static const Size CAPACITY{1uL << CAPACITY_BITS};
+
+  static_assert(std::is_pod<Element_>::value, "queue element type is non-POD");
+  static_assert(CAPACITY > 1, "capacity below two");
+  static_assert(static_cast<Size>(CAPACITY) == CAPACITY &&
+                    CAPACITY <= (Size{1} << (sizeof(Size) * 8 - 2)),
+                "capacity incompatible with Size");
+
+ private:
+  using AtomicIdx = std::atomic<Size>;
+  using Difference = typename std::make_signed<Size>::type;
+
+  static const Size MASK = CAPACITY - 1;
+
+  struct Cell {
+    AtomicIdx sequence;
+    Element element;
+  };
+
+ public:
+  MpmcQueue() : cells_{new Cell[CAPACITY]} {
+    for (Size i = 0; i < CAPACITY; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  ~MpmcQueue() { delete[] cells_; }
+
+  MpmcQueue(const MpmcQueue&) = delete;
+  MpmcQueue(MpmcQueue&&) = delete;
+
+  MpmcQueue& operator=(const MpmcQueue&) = delete;
+  MpmcQueue& operator=(MpmcQueue&&) = delete;
+
+  // Approximate while other threads use the queue.
+  bool empty() const { return size() == 0; }
+  Size size() const {
+    const auto head = head_.load(std::memory_order_acquire);
+    const auto size = static_cast<Difference>(
+        tail_.load(std::memory_order_acquire) - head);
+    return size > 0 ? static_cast<Size>(size) : 0;
+  }
+
+  // Returns false if the queue is full.
+  bool push(Element new_value) {
+    Size position;
+    if (claim_push(1, position) == 0) return false;
+    Cell& cell = cells_[position & MASK];
+    cell.element = new_value;
+    cell.sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Pushes the first values of [first, first + count) for which there are
+  // consecutive free cells, claiming them with a single CAS, and returns how
+  // many that was. Consumers may pull each as soon as it is written.
+  Size push_batch(const Element* first, Size count) {
+    Size position;
+    count = claim_push(count, position);
+    for (Size i = 0; i < count; ++i) {
+      Cell& cell = cells_[(position + i) & MASK];
+      cell.element = first[i];
+      cell.sequence.store(position + i + 1, std::memory_order_release);
+    }
+    return count;
+  }
+
+  // Returns false if the queue is empty.
+  bool pull(Element& to) {
+    Size position;
+    if (claim_pull(1, position) == 0) return false;
+    Cell& cell = cells_[position & MASK];
+    to = cell.element;
+    cell.sequence.store(position + CAPACITY, std::memory_order_release);
+    return true;
+  }
+
+  // Pulls up to max_count consecutive elements into to, claiming them with a
+  // single CAS, and returns how many it did.
+  Size pull_batch(Element* to, Size max_count) {
+    Size position;
+    const Size count = claim_pull(max_count, position);
+    for (Size i = 0; i < count; ++i) {
+      Cell& cell = cells_[(position + i) & MASK];
+      to[i] = cell.element;
+      cell.sequence.store(position + i + CAPACITY,
+                          std::memory_order_release);
+    }
+    return count;
+  }
+
+ private:
+  // Claims up to max_count consecutive positions from index whose cells have
+  // the sequence number position + offset, storing the first in position.
+  // Returns how many were claimed; none only if the first cell isn't ready.
+  Size claim(AtomicIdx& index, Size offset, Size max_count, Size& position) {
+    position = index.load(std::memory_order_relaxed);
+    while (max_count > 0) {
+      // Cells are only ever made ready for the position which claims them,
+      // so those seen ready now still are if the CAS succeeds.
+      Size count = 0;
+      Difference lag = 0;
+      while (count < max_count) {
+        const auto sequence = cells_[(position + count) & MASK].sequence.load(
+            std::memory_order_acquire);
+        lag = static_cast<Difference>(sequence - (position + count + offset));
+        if (lag != 0) break;
+        ++count;
+      }
+
+      if (count > 0) {
+        if (index.compare_exchange_weak(position, position + count,
+                                        std::memory_order_relaxed)) {
+          return count;
+        }
+      } else if (lag < 0) {
+        // The cell still belongs to the previous lap: full (or empty).
+        return 0;
+      } else {
+        // Another thread claimed the position already.
+        position = index.load(std::memory_order_relaxed);
+      }
+    }
+    return 0;
+  }
+
+  Size claim_push(Size max_count, Size& position) {
+    return claim(tail_, 0, max_count, position);
+  }
+
+  Size claim_pull(Size max_count, Size& position) {
+    return claim(head_, 1, max_count, position);
+  }
+
+  Cell* cells_;
+
+  // The next position to push to.
+  alignas(CACHE_LINE_SIZE) AtomicIdx tail_{0};
+
+  // The next position to pull from.
+  alignas(CACHE_LINE_SIZE) AtomicIdx head_{0};
+};
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_MPMC_QUEUE_HPP_
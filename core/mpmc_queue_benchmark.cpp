@@ -0,0 +1,72 @@
+#include "blocking_queue.hpp"
+#include "mpmc_queue.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace sparks {
+namespace {
+
+using Element = uint32_t;
+using Queue = MpmcQueue<Element, 10>;
+
+// Single-threaded: push a batch of state.range(0) elements then pull them.
+void BM_MpmcQueuePushPull(benchmark::State& state) {
+  Queue queue;
+  const auto batch = static_cast<Element>(state.range(0));
+  Element to = 0;
+  for (auto _ : state) {
+    for (Element i = 0; i < batch; ++i) queue.push(i);
+    for (Element i = 0; i < batch; ++i) queue.pull(to);
+    benchmark::DoNotOptimize(to);
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_MpmcQueuePushPull)->RangeMultiplier(8)->Range(8, 512);
+
+// Even threads produce, odd ones consume, state.range(0) elements at a time
+// (one by one for 1, else with push_batch() and pull_batch()).
+void BM_MpmcQueueThroughput(benchmark::State& state) {
+  static Queue queue;
+  const auto batch_size = static_cast<Element>(state.range(0));
+  std::vector<Element> batch(batch_size);
+  int64_t num_moved = 0;
+  if (state.thread_index() % 2 == 0) {
+    for (auto _ : state) {
+      num_moved += batch_size == 1 ? queue.push(0)
+                                   : queue.push_batch(batch.data(), batch_size);
+    }
+  } else {
+    for (auto _ : state) {
+      num_moved += batch_size == 1 ? queue.pull(batch[0])
+                                   : queue.pull_batch(batch.data(), batch_size);
+    }
+  }
+  benchmark::DoNotOptimize(batch.data());
+  state.SetItemsProcessed(num_moved);
+}
+BENCHMARK(BM_MpmcQueueThroughput)
+    ->ArgName("batch")
+    ->Arg(1)->Arg(16)
+    ->ThreadRange(2, 8)
+    ->UseRealTime();
+
+// The same through a BlockingQueue, one element at a time. Every thread runs
+// as many iterations, so each push finds a pull.
+void BM_BlockingMpmcQueueThroughput(benchmark::State& state) {
+  static BlockingQueue<Queue> queue;
+  Element to = 0;
+  if (state.thread_index() % 2 == 0) {
+    for (auto _ : state) queue.push(0);
+  } else {
+    for (auto _ : state) queue.pull(to);
+  }
+  benchmark::DoNotOptimize(to);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BlockingMpmcQueueThroughput)->ThreadRange(2, 8)->UseRealTime();
+
+}  // namespace
+}  // namespace sparks
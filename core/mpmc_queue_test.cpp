@@ -0,0 +1,144 @@
+#include "mpmc_queue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+using Element = uint32_t;
+using SmallQueue = MpmcQueue<Element, 2>;
+using LargeQueue = MpmcQueue<Element, 8>;
+
+TEST(MpmcQueueTest, SingleThreaded) {
+  SmallQueue small;
+  Element to;
+
+  EXPECT_TRUE(small.empty());
+  EXPECT_EQ(0, small.size());
+  EXPECT_FALSE(small.pull(to));
+
+  EXPECT_TRUE(small.push(1));
+  EXPECT_TRUE(small.push(2));
+  EXPECT_TRUE(small.push(3));
+  EXPECT_TRUE(small.push(4));
+  EXPECT_FALSE(small.push(5));
+  EXPECT_EQ(4, small.size());
+
+  EXPECT_TRUE(small.pull(to)); EXPECT_EQ(1, to);
+  EXPECT_TRUE(small.pull(to)); EXPECT_EQ(2, to);
+  EXPECT_EQ(2, small.size());
+
+  // Wraps around, into the cells' next lap.
+  EXPECT_TRUE(small.push(5));
+  EXPECT_TRUE(small.push(6));
+  EXPECT_FALSE(small.push(7));
+
+  EXPECT_TRUE(small.pull(to)); EXPECT_EQ(3, to);
+  EXPECT_TRUE(small.pull(to)); EXPECT_EQ(4, to);
+  EXPECT_TRUE(small.pull(to)); EXPECT_EQ(5, to);
+  EXPECT_TRUE(small.pull(to)); EXPECT_EQ(6, to);
+  EXPECT_FALSE(small.pull(to));
+  EXPECT_TRUE(small.empty());
+}
+
+TEST(MpmcQueueTest, Batches) {
+  SmallQueue small;
+  const Element values[] = {1, 2, 3, 4, 5, 6};
+  Element to[6] = {};
+
+  EXPECT_EQ(0, small.pull_batch(to, 6));
+  EXPECT_EQ(3, small.push_batch(values, 3));
+  EXPECT_EQ(1, small.push_batch(values + 3, 3));  // Only room for one.
+  EXPECT_EQ(0, small.push_batch(values + 4, 2));
+
+  EXPECT_EQ(2, small.pull_batch(to, 2));
+  EXPECT_EQ(1, to[0]);
+  EXPECT_EQ(2, to[1]);
+
+  EXPECT_EQ(2, small.push_batch(values + 4, 2));
+  EXPECT_EQ(4, small.pull_batch(to, 6));
+  EXPECT_EQ(3, to[0]);
+  EXPECT_EQ(4, to[1]);
+  EXPECT_EQ(5, to[2]);
+  EXPECT_EQ(6, to[3]);
+  EXPECT_TRUE(small.empty());
+}
+
+// Every value must be pulled exactly once, and each consumer must see the
+// values of each producer in the order they were pushed.
+TEST(MpmcQueueTest, ManyProducersManyConsumers) {
+  const int NUM_PRODUCERS = 4;
+  const int NUM_CONSUMERS = 4;
+  const Element VALUES_PER_PRODUCER = 1 << 16;
+  const Element MAX_BATCH = 7;
+  const Element PRODUCER_SHIFT = 24;
+  LargeQueue queue;
+
+  std::vector<std::atomic<uint32_t>> times_pulled(NUM_PRODUCERS *
+                                                  VALUES_PER_PRODUCER);
+  for (auto& count : times_pulled) count.store(0);
+  std::atomic<uint32_t> num_pulled{0};
+  std::atomic<bool> in_order{true};
+
+  std::vector<std::thread> threads;
+  for (int i_producer = 0; i_producer < NUM_PRODUCERS; ++i_producer) {
+    threads.emplace_back([&queue, i_producer, VALUES_PER_PRODUCER, MAX_BATCH,
+                          PRODUCER_SHIFT] {
+      Element batch[MAX_BATCH];
+      Element next = 0;
+      while (next < VALUES_PER_PRODUCER) {
+        const Element batch_size = std::min(
+            (next + i_producer) % MAX_BATCH + 1, VALUES_PER_PRODUCER - next);
+        for (Element i = 0; i < batch_size; ++i) {
+          batch[i] = Element(i_producer) << PRODUCER_SHIFT | (next + i);
+        }
+        const Element num_pushed = batch_size == 1
+                                       ? Element{queue.push(batch[0])}
+                                       : queue.push_batch(batch, batch_size);
+        next += num_pushed;
+        if (num_pushed == 0) std::this_thread::yield();
+      }
+    });
+  }
+
+  const Element total = NUM_PRODUCERS * VALUES_PER_PRODUCER;
+  for (int i_consumer = 0; i_consumer < NUM_CONSUMERS; ++i_consumer) {
+    threads.emplace_back([&, i_consumer] {
+      std::vector<int64_t> last_seen(NUM_PRODUCERS, -1);
+      Element batch[MAX_BATCH];
+      Element num_tries = 0;
+      while (num_pulled.load() < total) {
+        const Element max_count = (num_tries++ + i_consumer) % MAX_BATCH + 1;
+        const Element count = max_count == 1
+                                  ? Element{queue.pull(batch[0])}
+                                  : queue.pull_batch(batch, max_count);
+        for (Element i = 0; i < count; ++i) {
+          const Element producer = batch[i] >> PRODUCER_SHIFT;
+          const Element value = batch[i] & ((1 << PRODUCER_SHIFT) - 1);
+          if (value <= last_seen[producer]) in_order.store(false);
+          last_seen[producer] = value;
+          times_pulled[producer * VALUES_PER_PRODUCER + value].fetch_add(1);
+        }
+        num_pulled.fetch_add(count);
+        if (count == 0) std::this_thread::yield();
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_TRUE(in_order.load());
+  EXPECT_EQ(total, num_pulled.load());
+  Element num_not_once = 0;
+  for (const auto& count : times_pulled) num_not_once += count.load() != 1;
+  EXPECT_EQ(0, num_not_once);
+  EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,450 @@
+#ifndef SPARKS_CORE_PARALLEL_HPP_
+#define SPARKS_CORE_PARALLEL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "scheduler.hpp"
+
+namespace sparks {
+namespace parallel {
+
+// Parallel algorithms on the Scheduler. Like everything running on it they
+// never block their node: each takes a done callback which runs, on whichever
+// node finishes last, once the algorithm has completed, and may start the
+// next step. The calling task returns as soon as it has done its share.
+//
+// The input is cut into chunks of `grain` elements (0 picks a grain giving
+// every node CHUNKS_PER_NODE chunks) which are handed out by recursive
+// halving: the task holding a range of chunks spawns its upper half and keeps
+// the lower one, so that thieves take the largest pieces of work left.
+
+const size_t CHUNKS_PER_NODE = 8;
+
+namespace detail {
+
+inline size_t num_chunks(const SchedulerNode& node, size_t size,
+                         size_t grain) {
+  if (size == 0) return 0;
+  if (grain == 0) return std::min(size, node.num_nodes() * CHUNKS_PER_NODE);
+  return (size + grain - 1) / grain;
+}
+
+// Chunk i_chunk of num_chunks spans [chunk_begin(i), chunk_begin(i + 1)).
+inline size_t chunk_begin(size_t i_chunk, size_t num_chunks, size_t size) {
+  return i_chunk * size / num_chunks;
+}
+
+// Calls body(i_chunk) for every chunk in [0, num_chunks), then done(node).
+template <class Body, class Done>
+class ForChunks {
+ public:
+  static void start(SchedulerNode& node, size_t num_chunks, Body body,
+                    Done done) {
+    if (num_chunks == 0) {
+      done(node);
+      return;
+    }
+    auto* job = new ForChunks{std::move(body), std::move(done)};
+    job->run(node, 0, num_chunks);
+  }
+
+ private:
+  ForChunks(Body body, Done done)
+      : body_{std::move(body)}, done_{std::move(done)} {}
+
+  void run(SchedulerNode& node, size_t begin, size_t end) {
+    while (end - begin > 1) {
+      const size_t middle = begin + (end - begin) / 2;
+      pending_.fetch_add(1, std::memory_order_relaxed);
+      ForChunks* job = this;
+      node.new_task([job, middle, end](SchedulerNode& node) {
+        job->run(node, middle, end);
+      });
+      end = middle;
+    }
+
+    body_(begin);
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      done_(node);
+      delete this;
+    }
+  }
+
+  Body body_;
+  Done done_;
+
+  // Ranges still running, starting with the whole range.
+  std::atomic<size_t> pending_{1};
+};
+
+template <class Body, class Done>
+void for_chunks(SchedulerNode& node, size_t num_chunks, Body body,
+                Done done) {
+  ForChunks<Body, Done>::start(node, num_chunks, std::move(body),
+                               std::move(done));
+}
+
+// The first k elements of the stable merge of a[0, na) and b[0, nb) are
+// a[0, i) and b[0, k - i); returns i.
+template <class Iterator, class Compare>
+size_t merge_split(size_t k, Iterator a, size_t na, Iterator b, size_t nb,
+                   Compare comp) {
+  size_t low = k > nb ? k - nb : 0;
+  size_t high = std::min(k, na);
+  while (low < high) {
+    const size_t i = low + (high - low) / 2;
+    // a[i] precedes b[k - i - 1], so the first k take more of a.
+    if (!comp(b[k - i - 1], a[i])) {
+      low = i + 1;
+    } else {
+      high = i;
+    }
+  }
+  return low;
+}
+
+template <class Iterator, class T, class Op, class Done>
+void scan(SchedulerNode& node, Iterator first, Iterator last,
+          Iterator d_first, std::unique_ptr<T> init, Op op, Done done,
+          size_t grain);
+
+}  // namespace detail
+
+// Calls body(i) for every i in [begin, end), then done(node).
+template <class Index, class Body, class Done>
+void parallel_for(SchedulerNode& node, Index begin, Index end, Body body,
+                  Done done, size_t grain = 0) {
+  const size_t size = end > begin ? end - begin : 0;
+  const size_t num_chunks = detail::num_chunks(node, size, grain);
+  detail::for_chunks(node, num_chunks, [=](size_t i_chunk) {
+    const Index chunk_end =
+        begin + detail::chunk_begin(i_chunk + 1, num_chunks, size);
+    for (Index i = begin + detail::chunk_begin(i_chunk, num_chunks, size);
+         i < chunk_end; ++i) {
+      body(i);
+    }
+  }, std::move(done));
+}
+
+// Folds transform(x) for every x in [first, last) into init with op, which
+// must be associative, then calls done(node, result).
+template <class Iterator, class T, class ReduceOp, class Transform,
+          class Done>
+void transform_reduce(SchedulerNode& node, Iterator first, Iterator last,
+                      T init, ReduceOp reduce_op, Transform transform,
+                      Done done, size_t grain = 0) {
+  const size_t size = std::distance(first, last);
+  const size_t num_chunks = detail::num_chunks(node, size, grain);
+  auto partials = std::make_shared<std::vector<T>>(num_chunks, init);
+
+  detail::for_chunks(node, num_chunks, [=](size_t i_chunk) {
+    auto it = first + detail::chunk_begin(i_chunk, num_chunks, size);
+    const auto chunk_end =
+        first + detail::chunk_begin(i_chunk + 1, num_chunks, size);
+    T partial = transform(*it);
+    while (++it != chunk_end) partial = reduce_op(partial, transform(*it));
+    (*partials)[i_chunk] = partial;
+  }, [=](SchedulerNode& node) {
+    T result = init;
+    for (const auto& partial : *partials) result = reduce_op(result, partial);
+    done(node, result);
+  });
+}
+
+// Folds [first, last) into init with op, which must be associative, then
+// calls done(node, result).
+template <class Iterator, class T, class Op, class Done>
+void reduce(SchedulerNode& node, Iterator first, Iterator last, T init, Op op,
+            Done done, size_t grain = 0) {
+  using Value = typename std::iterator_traits<Iterator>::value_type;
+  transform_reduce(node, first, last, std::move(init), std::move(op),
+                   [](const Value& value) -> const Value& { return value; },
+                   std::move(done), grain);
+}
+
+// Writes the running folds of [first, last) to d_first (which may be first),
+// including each element in its own fold, then calls done(node).
+template <class Iterator, class Op, class Done>
+void inclusive_scan(SchedulerNode& node, Iterator first, Iterator last,
+                    Iterator d_first, Op op, Done done, size_t grain = 0) {
+  using Value = typename std::iterator_traits<Iterator>::value_type;
+  detail::scan(node, first, last, d_first, std::unique_ptr<Value>{},
+               std::move(op), std::move(done), grain);
+}
+
+// Writes the running folds of [first, last) into init to d_first (which may
+// be first), excluding each element from its own fold, then calls done(node).
+template <class Iterator, class T, class Op, class Done>
+void exclusive_scan(SchedulerNode& node, Iterator first, Iterator last,
+                    Iterator d_first, T init, Op op, Done done,
+                    size_t grain = 0) {
+  detail::scan(node, first, last, d_first,
+               std::unique_ptr<T>{new T(std::move(init))}, std::move(op),
+               std::move(done), grain);
+}
+
+// Sorts [first, last) with comp, then calls done(node). A merge sort: chunks
+// are sorted in parallel, then merged pairwise, every merge itself split into
+// pieces of equal output size so that all nodes stay busy until the last
+// round. Needs a buffer as large as the input.
+template <class Iterator, class Compare, class Done>
+void sort(SchedulerNode& node, Iterator first, Iterator last, Compare comp,
+          Done done, size_t grain = 0);
+
+template <class Iterator, class Done>
+void sort(SchedulerNode& node, Iterator first, Iterator last, Done done,
+          size_t grain = 0) {
+  using Value = typename std::iterator_traits<Iterator>::value_type;
+  sort(node, first, last, std::less<Value>{}, std::move(done), grain);
+}
+
+// Moves the elements of [first, last) satisfying pred before those which do
+// not, keeping their relative order, then calls done(node, middle) with the
+// first element of the second group. Needs a buffer as large as the input.
+template <class Iterator, class Predicate, class Done>
+void partition(SchedulerNode& node, Iterator first, Iterator last,
+               Predicate pred, Done done, size_t grain = 0);
+
+namespace detail {
+
+// A null init makes an inclusive scan.
+template <class Iterator, class T, class Op, class Done>
+void scan(SchedulerNode& node, Iterator first, Iterator last,
+          Iterator d_first, std::unique_ptr<T> init, Op op, Done done,
+          size_t grain) {
+  const size_t size = std::distance(first, last);
+  const size_t num_chunks = detail::num_chunks(node, size, grain);
+  if (num_chunks == 0) {
+    done(node);
+    return;
+  }
+
+  // Pass 1 folds every chunk; the prefixes of those folds are then the
+  // offsets with which pass 2 scans each chunk.
+  struct State {
+    std::vector<T> folds;
+    std::vector<T> offsets;
+    std::unique_ptr<T> init;
+  };
+  std::shared_ptr<State> state{new State{{}, {}, std::move(init)}};
+  state->folds.reserve(num_chunks);
+  for (size_t i_chunk = 0; i_chunk < num_chunks; ++i_chunk) {
+    state->folds.push_back(*(first + chunk_begin(i_chunk, num_chunks, size)));
+  }
+
+  for_chunks(node, num_chunks, [=](size_t i_chunk) {
+    auto it = first + chunk_begin(i_chunk, num_chunks, size);
+    const auto chunk_end = first + chunk_begin(i_chunk + 1, num_chunks, size);
+    T fold = *it;
+    while (++it != chunk_end) fold = op(fold, *it);
+    state->folds[i_chunk] = fold;
+  }, [=](SchedulerNode& node) {
+    // Chunk 0 of an inclusive scan has no offset; its slot stays unused.
+    state->offsets.reserve(num_chunks);
+    state->offsets.push_back(state->init ? *state->init : state->folds[0]);
+    for (size_t i_chunk = 1; i_chunk < num_chunks; ++i_chunk) {
+      const auto& previous = state->offsets.back();
+      const auto& fold = state->folds[i_chunk - 1];
+      state->offsets.push_back(state->init || i_chunk > 1
+                                   ? op(previous, fold) : fold);
+    }
+
+    for_chunks(node, num_chunks, [=](size_t i_chunk) {
+      const size_t chunk_first = chunk_begin(i_chunk, num_chunks, size);
+      const size_t chunk_last = chunk_begin(i_chunk + 1, num_chunks, size);
+      auto in = first + chunk_first;
+      auto out = d_first + chunk_first;
+      const auto in_end = first + chunk_last;
+      if (state->init) {
+        T fold = state->offsets[i_chunk];
+        for (; in != in_end; ++in, ++out) {
+          T next = op(fold, *in);
+          *out = std::move(fold);
+          fold = std::move(next);
+        }
+      } else {
+        T fold = i_chunk == 0 ? *in : op(state->offsets[i_chunk], *in);
+        *out = fold;
+        while (++in != in_end) *++out = fold = op(fold, *in);
+      }
+    }, done);
+  });
+}
+
+template <class Iterator, class Compare, class Done>
+class MergeSort {
+ public:
+  using Value = typename std::iterator_traits<Iterator>::value_type;
+
+  static void start(SchedulerNode& node, Iterator first, Iterator last,
+                    Compare comp, Done done, size_t grain) {
+    const size_t size = std::distance(first, last);
+    if (size < 2) {
+      done(node);
+      return;
+    }
+
+    // A power of two, so that every round merges pairs of equal runs.
+    size_t num_chunks = 1;
+    while (num_chunks < detail::num_chunks(node, size, grain)) {
+      num_chunks *= 2;
+    }
+
+    std::shared_ptr<MergeSort> job{new MergeSort{
+        first, size, num_chunks, std::move(comp), std::move(done)}};
+    for_chunks(node, num_chunks, [job](size_t i_chunk) {
+      std::sort(job->first_ + job->chunk_begin(i_chunk),
+                job->first_ + job->chunk_begin(i_chunk + 1), job->comp_);
+    }, [job](SchedulerNode& node) { merge_runs(node, job, 1, false); });
+  }
+
+ private:
+  MergeSort(Iterator first, size_t size, size_t num_chunks, Compare comp,
+            Done done)
+      : first_{first}, size_{size}, num_chunks_{num_chunks},
+        comp_{std::move(comp)}, done_{std::move(done)}, buffer_(size) {}
+
+  size_t chunk_begin(size_t i_chunk) const {
+    return detail::chunk_begin(i_chunk, num_chunks_, size_);
+  }
+
+  // Merges runs of run_chunks chunks pairwise, from the buffer if
+  // from_buffer, then starts the next round; the merge of each pair is split
+  // into 2 * run_chunks pieces.
+  static void merge_runs(SchedulerNode& node, std::shared_ptr<MergeSort> job,
+                         size_t run_chunks, bool from_buffer) {
+    if (run_chunks == job->num_chunks_) {
+      if (!from_buffer) {
+        job->done_(node);
+        return;
+      }
+      for_chunks(node, job->num_chunks_, [job](size_t i_chunk) {
+        std::move(job->buffer_.begin() + job->chunk_begin(i_chunk),
+                  job->buffer_.begin() + job->chunk_begin(i_chunk + 1),
+                  job->first_ + job->chunk_begin(i_chunk));
+      }, [job](SchedulerNode& node) { job->done_(node); });
+      return;
+    }
+
+    for_chunks(node, job->num_chunks_, [=](size_t i_piece) {
+      if (from_buffer) {
+        job->merge_piece(job->buffer_.begin(), job->first_, run_chunks,
+                          i_piece);
+      } else {
+        job->merge_piece(job->first_, job->buffer_.begin(), run_chunks,
+                          i_piece);
+      }
+    }, [=](SchedulerNode& node) {
+      merge_runs(node, job, run_chunks * 2, !from_buffer);
+    });
+  }
+
+  template <class From, class To>
+  void merge_piece(From from, To to, size_t run_chunks, size_t i_piece) {
+    const size_t pieces_per_merge = 2 * run_chunks;
+    const size_t i_merge_chunk = i_piece / pieces_per_merge * pieces_per_merge;
+    const size_t a_first = chunk_begin(i_merge_chunk);
+    const size_t b_first = chunk_begin(i_merge_chunk + run_chunks);
+    const size_t na = b_first - a_first;
+    const size_t nb = chunk_begin(i_merge_chunk + pieces_per_merge) - b_first;
+
+    const size_t i_in_merge = i_piece % pieces_per_merge;
+    const size_t k_first = i_in_merge * (na + nb) / pieces_per_merge;
+    const size_t k_last = (i_in_merge + 1) * (na + nb) / pieces_per_merge;
+    const auto a = from + a_first;
+    const auto b = from + b_first;
+    const size_t ia_first = merge_split(k_first, a, na, b, nb, comp_);
+    const size_t ia_last = merge_split(k_last, a, na, b, nb, comp_);
+
+    std::merge(std::make_move_iterator(a + ia_first),
+               std::make_move_iterator(a + ia_last),
+               std::make_move_iterator(b + (k_first - ia_first)),
+               std::make_move_iterator(b + (k_last - ia_last)),
+               to + a_first + k_first, comp_);
+  }
+
+  Iterator first_;
+  size_t size_;
+  size_t num_chunks_;
+  Compare comp_;
+  Done done_;
+  std::vector<Value> buffer_;
+};
+
+}  // namespace detail
+
+template <class Iterator, class Compare, class Done>
+void sort(SchedulerNode& node, Iterator first, Iterator last, Compare comp,
+          Done done, size_t grain) {
+  detail::MergeSort<Iterator, Compare, Done>::start(
+      node, first, last, std::move(comp), std::move(done), grain);
+}
+
+template <class Iterator, class Predicate, class Done>
+void partition(SchedulerNode& node, Iterator first, Iterator last,
+               Predicate pred, Done done, size_t grain) {
+  using Value = typename std::iterator_traits<Iterator>::value_type;
+  const size_t size = std::distance(first, last);
+  const size_t num_chunks = detail::num_chunks(node, size, grain);
+
+  // Pass 1 counts the matches of every chunk, from which follows where each
+  // chunk's elements go; pass 2 moves them there in a buffer and pass 3 moves
+  // the buffer back.
+  struct State {
+    std::vector<size_t> num_matches;
+    std::vector<Value> buffer;
+  };
+  std::shared_ptr<State> state{
+      new State{std::vector<size_t>(num_chunks), std::vector<Value>(size)}};
+
+  const auto chunk_begin = [=](size_t i_chunk) {
+    return detail::chunk_begin(i_chunk, num_chunks, size);
+  };
+
+  detail::for_chunks(node, num_chunks, [=](size_t i_chunk) {
+    state->num_matches[i_chunk] = std::count_if(
+        first + chunk_begin(i_chunk), first + chunk_begin(i_chunk + 1), pred);
+  }, [=](SchedulerNode& node) {
+    // Turn the counts into the index of each chunk's first match.
+    size_t total_matches = 0;
+    for (auto& num_matches : state->num_matches) {
+      const size_t chunk_matches = num_matches;
+      num_matches = total_matches;
+      total_matches += chunk_matches;
+    }
+
+    detail::for_chunks(node, num_chunks, [=](size_t i_chunk) {
+      auto match = state->buffer.begin() + state->num_matches[i_chunk];
+      auto mismatch = state->buffer.begin() + total_matches +
+                      (chunk_begin(i_chunk) - state->num_matches[i_chunk]);
+      const auto chunk_end = first + chunk_begin(i_chunk + 1);
+      for (auto it = first + chunk_begin(i_chunk); it != chunk_end; ++it) {
+        if (pred(*it)) {
+          *match++ = std::move(*it);
+        } else {
+          *mismatch++ = std::move(*it);
+        }
+      }
+    }, [=](SchedulerNode& node) {
+      detail::for_chunks(node, num_chunks, [=](size_t i_chunk) {
+        std::move(state->buffer.begin() + chunk_begin(i_chunk),
+                  state->buffer.begin() + chunk_begin(i_chunk + 1),
+                  first + chunk_begin(i_chunk));
+      }, [=](SchedulerNode& node) { done(node, first + total_matches); });
+    });
+  });
+}
+
+}  // namespace parallel
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_PARALLEL_HPP_
@@ -0,0 +1,256 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace sparks {
+namespace {
+
+// Every parallel algorithm against its serial std:: counterpart, on
+// state.range(0) elements; the parallel ones on state.range(1) nodes.
+
+using Value = uint32_t;
+
+const std::vector<Value>& random_values(size_t size) {
+  static std::vector<Value> values;
+  if (values.size() != size) {
+    std::mt19937 engine{42};
+    values.resize(size);
+    for (auto& value : values) value = engine();
+  }
+  return values;
+}
+
+// As in scheduler_benchmark.cpp, a single Scheduler runs all the iterations
+// of a benchmark: each iteration calls next() once it is done.
+class Driver {
+ public:
+  using Start = std::function<void(Driver&, SchedulerNode&)>;
+
+  Driver(benchmark::State& state, Start start)
+      : state_{&state}, start_{std::move(start)} {}
+
+  void next(SchedulerNode& node) {
+    if (state_->KeepRunning()) {
+      start_(*this, node);
+    } else {
+      node.stop_scheduler();
+    }
+  }
+
+  void run() {
+    Scheduler scheduler{static_cast<size_t>(state_->range(1))};
+    Driver* driver = this;
+    scheduler.run([driver](SchedulerNode& node) { driver->next(node); });
+  }
+
+ private:
+  benchmark::State* state_;
+  Start start_;
+};
+
+// Arguments: {size} for serial benchmarks.
+void serial_sizes(benchmark::internal::Benchmark* bench) {
+  bench->ArgName("size")->Unit(benchmark::kMillisecond)->UseRealTime();
+  for (int64_t size : {1000000, 10000000, 100000000}) bench->Arg(size);
+}
+
+// Arguments: {size, nodes} for parallel benchmarks.
+void parallel_sizes(benchmark::internal::Benchmark* bench) {
+  bench->ArgNames({"size", "nodes"})
+      ->Unit(benchmark::kMillisecond)
+      ->UseRealTime();
+  for (int64_t size : {1000000, 10000000, 100000000}) {
+    for (int64_t num_nodes = 1; num_nodes <= 8; num_nodes *= 2) {
+      bench->Args({size, num_nodes});
+    }
+  }
+}
+
+// Function objects rather than functions, so that both sides can inline them.
+struct Plus {
+  uint64_t operator()(uint64_t a, uint64_t b) const { return a + b; }
+};
+
+struct Square {
+  uint64_t operator()(Value x) const { return uint64_t{x} * x; }
+};
+
+struct IsEven {
+  bool operator()(Value x) const { return x % 2 == 0; }
+};
+
+void BM_StdForEach(benchmark::State& state) {
+  auto values = random_values(state.range(0));
+  for (auto _ : state) {
+    for (auto& value : values) value = value * 3 + 1;
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdForEach)->Apply(serial_sizes);
+
+void BM_ParallelFor(benchmark::State& state) {
+  auto values = random_values(state.range(0));
+  Value* data = values.data();
+  Driver driver{state, [data, &values](Driver& driver, SchedulerNode& node) {
+    Driver* d = &driver;
+    parallel::parallel_for(node, size_t{0}, values.size(),
+                           [data](size_t i) { data[i] = data[i] * 3 + 1; },
+                           [d](SchedulerNode& node) { d->next(node); });
+  }};
+  driver.run();
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParallelFor)->Apply(parallel_sizes);
+
+void BM_StdAccumulate(benchmark::State& state) {
+  const auto& values = random_values(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        std::accumulate(values.begin(), values.end(), uint64_t{0}, Plus{}));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdAccumulate)->Apply(serial_sizes);
+
+void BM_ParallelReduce(benchmark::State& state) {
+  const auto& values = random_values(state.range(0));
+  Driver driver{state, [&values](Driver& driver, SchedulerNode& node) {
+    Driver* d = &driver;
+    parallel::reduce(node, values.begin(), values.end(), uint64_t{0}, Plus{},
+                     [d](SchedulerNode& node, uint64_t sum) {
+      benchmark::DoNotOptimize(sum);
+      d->next(node);
+    });
+  }};
+  driver.run();
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParallelReduce)->Apply(parallel_sizes);
+
+// Sum of squares.
+void BM_StdInnerProduct(benchmark::State& state) {
+  const auto& values = random_values(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(std::inner_product(
+        values.begin(), values.end(), values.begin(), uint64_t{0}, Plus{},
+        [](Value a, Value b) { return uint64_t{a} * b; }));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdInnerProduct)->Apply(serial_sizes);
+
+void BM_ParallelTransformReduce(benchmark::State& state) {
+  const auto& values = random_values(state.range(0));
+  Driver driver{state, [&values](Driver& driver, SchedulerNode& node) {
+    Driver* d = &driver;
+    parallel::transform_reduce(node, values.begin(), values.end(),
+                               uint64_t{0}, Plus{}, Square{},
+                               [d](SchedulerNode& node, uint64_t sum) {
+      benchmark::DoNotOptimize(sum);
+      d->next(node);
+    });
+  }};
+  driver.run();
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParallelTransformReduce)->Apply(parallel_sizes);
+
+void BM_StdPartialSum(benchmark::State& state) {
+  const auto& values = random_values(state.range(0));
+  std::vector<Value> out(values.size());
+  for (auto _ : state) {
+    std::partial_sum(values.begin(), values.end(), out.begin());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdPartialSum)->Apply(serial_sizes);
+
+void BM_ParallelInclusiveScan(benchmark::State& state) {
+  auto values = random_values(state.range(0));
+  std::vector<Value> out(values.size());
+  Driver driver{state, [&values, &out](Driver& driver, SchedulerNode& node) {
+    Driver* d = &driver;
+    parallel::inclusive_scan(node, values.begin(), values.end(), out.begin(),
+                             [](Value a, Value b) { return a + b; },
+                             [d](SchedulerNode& node) { d->next(node); });
+  }};
+  driver.run();
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParallelInclusiveScan)->Apply(parallel_sizes);
+
+void BM_StdSort(benchmark::State& state) {
+  const auto& source = random_values(state.range(0));
+  std::vector<Value> values;
+  for (auto _ : state) {
+    state.PauseTiming();
+    values = source;
+    state.ResumeTiming();
+    std::sort(values.begin(), values.end());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdSort)->Apply(serial_sizes);
+
+void BM_ParallelSort(benchmark::State& state) {
+  const auto& source = random_values(state.range(0));
+  std::vector<Value> values;
+  Driver driver{state, [&](Driver& driver, SchedulerNode& node) {
+    state.PauseTiming();
+    values = source;
+    state.ResumeTiming();
+    Driver* d = &driver;
+    parallel::sort(node, values.begin(), values.end(),
+                   [d](SchedulerNode& node) { d->next(node); });
+  }};
+  driver.run();
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParallelSort)->Apply(parallel_sizes);
+
+// parallel::partition() is stable, so compare with std::stable_partition().
+void BM_StdStablePartition(benchmark::State& state) {
+  const auto& source = random_values(state.range(0));
+  std::vector<Value> values;
+  for (auto _ : state) {
+    state.PauseTiming();
+    values = source;
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(
+        std::stable_partition(values.begin(), values.end(), IsEven{}));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdStablePartition)->Apply(serial_sizes);
+
+void BM_ParallelPartition(benchmark::State& state) {
+  using Iterator = std::vector<Value>::iterator;
+  const auto& source = random_values(state.range(0));
+  std::vector<Value> values;
+  Driver driver{state, [&](Driver& driver, SchedulerNode& node) {
+    state.PauseTiming();
+    values = source;
+    state.ResumeTiming();
+    Driver* d = &driver;
+    parallel::partition(node, values.begin(), values.end(), IsEven{},
+                        [d](SchedulerNode& node, Iterator middle) {
+      benchmark::DoNotOptimize(middle);
+      d->next(node);
+    });
+  }};
+  driver.run();
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParallelPartition)->Apply(parallel_sizes);
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,234 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+const size_t NUM_NODES = 4;
+const size_t SIZE = 100000;
+
+// Small grains give many chunks, and many merge rounds in sort().
+const size_t SMALL_GRAIN = 100;
+
+std::vector<int64_t> random_values(size_t size, int64_t max_value) {
+  std::mt19937_64 engine{42};
+  std::uniform_int_distribution<int64_t> distribution{0, max_value};
+  std::vector<int64_t> values(size);
+  for (auto& value : values) value = distribution(engine);
+  return values;
+}
+
+TEST(ParallelTest, ParallelForVisitsEveryIndexOnce) {
+  std::vector<std::atomic<int>> visits(SIZE);
+  for (auto& count : visits) count.store(0);
+
+  Scheduler scheduler{NUM_NODES};
+  scheduler.run([&visits](SchedulerNode& node) {
+    auto* v = &visits;
+    parallel::parallel_for(node, size_t{0}, SIZE,
+                           [v](size_t i) { ++(*v)[i]; },
+                           [](SchedulerNode& node) { node.stop_scheduler(); });
+  });
+
+  for (size_t i = 0; i < SIZE; ++i) ASSERT_EQ(1, visits[i].load()) << i;
+}
+
+TEST(ParallelTest, ReduceAndTransformReduce) {
+  struct Results {
+    std::vector<int64_t> values;
+    int64_t sum = -1;
+    int64_t sum_of_squares = -1;
+    int64_t empty_sum = -1;
+  } results;
+  results.values = random_values(SIZE, 1000);
+
+  Scheduler scheduler{NUM_NODES};
+  scheduler.run([&results](SchedulerNode& node) {
+    Results* r = &results;
+    const auto plus = [](int64_t a, int64_t b) { return a + b; };
+    parallel::reduce(node, r->values.begin(), r->values.end(), int64_t{7},
+                     plus, [r, plus](SchedulerNode& node, int64_t sum) {
+      r->sum = sum;
+      parallel::transform_reduce(
+          node, r->values.begin(), r->values.end(), int64_t{0}, plus,
+          [](int64_t x) { return x * x; },
+          [r, plus](SchedulerNode& node, int64_t sum) {
+        r->sum_of_squares = sum;
+        parallel::reduce(node, r->values.end(), r->values.end(), int64_t{3},
+                         plus, [r](SchedulerNode& node, int64_t sum) {
+          r->empty_sum = sum;
+          node.stop_scheduler();
+        });
+      }, SMALL_GRAIN);
+    });
+  });
+
+  const auto& values = results.values;
+  EXPECT_EQ(std::accumulate(values.begin(), values.end(), int64_t{7}),
+            results.sum);
+  EXPECT_EQ(std::inner_product(values.begin(), values.end(), values.begin(),
+                               int64_t{0}),
+            results.sum_of_squares);
+  EXPECT_EQ(3, results.empty_sum);
+}
+
+TEST(ParallelTest, InclusiveAndExclusiveScan) {
+  struct Results {
+    std::vector<int64_t> values;
+    std::vector<int64_t> inclusive;
+    std::vector<int64_t> exclusive;
+  } results;
+  results.values = random_values(SIZE, 1000);
+  results.inclusive.resize(SIZE);
+  results.exclusive = results.values;
+
+  Scheduler scheduler{NUM_NODES};
+  scheduler.run([&results](SchedulerNode& node) {
+    Results* r = &results;
+    const auto plus = [](int64_t a, int64_t b) { return a + b; };
+    parallel::inclusive_scan(
+        node, r->values.begin(), r->values.end(), r->inclusive.begin(), plus,
+        [r, plus](SchedulerNode& node) {
+      // In place, this time.
+      parallel::exclusive_scan(
+          node, r->exclusive.begin(), r->exclusive.end(),
+          r->exclusive.begin(), int64_t{5}, plus,
+          [](SchedulerNode& node) { node.stop_scheduler(); }, SMALL_GRAIN);
+    });
+  });
+
+  std::vector<int64_t> expected(SIZE);
+  std::partial_sum(results.values.begin(), results.values.end(),
+                   expected.begin());
+  EXPECT_EQ(expected, results.inclusive);
+
+  int64_t fold = 5;
+  for (size_t i = 0; i < SIZE; ++i) {
+    expected[i] = fold;
+    fold += results.values[i];
+  }
+  EXPECT_EQ(expected, results.exclusive);
+}
+
+TEST(ParallelTest, Sort) {
+  struct Results {
+    std::vector<int64_t> few_chunks;
+    std::vector<int64_t> many_chunks;
+    std::vector<int64_t> single;
+  } results;
+  results.few_chunks = random_values(SIZE, 1000000);
+  results.many_chunks = random_values(SIZE + 17, 100);
+  results.single = {42};
+
+  auto expected_few = results.few_chunks;
+  auto expected_many = results.many_chunks;
+  std::sort(expected_few.begin(), expected_few.end());
+  std::sort(expected_many.begin(), expected_many.end(),
+            std::greater<int64_t>{});
+
+  Scheduler scheduler{NUM_NODES};
+  scheduler.run([&results](SchedulerNode& node) {
+    Results* r = &results;
+    parallel::sort(node, r->few_chunks.begin(), r->few_chunks.end(),
+                   [r](SchedulerNode& node) {
+      parallel::sort(node, r->many_chunks.begin(), r->many_chunks.end(),
+                     std::greater<int64_t>{}, [r](SchedulerNode& node) {
+        parallel::sort(node, r->single.begin(), r->single.end(),
+                       [](SchedulerNode& node) { node.stop_scheduler(); });
+      }, SMALL_GRAIN);
+    });
+  });
+
+  EXPECT_EQ(expected_few, results.few_chunks);
+  EXPECT_EQ(expected_many, results.many_chunks);
+  EXPECT_EQ(std::vector<int64_t>{42}, results.single);
+}
+
+TEST(ParallelTest, PartitionIsStable) {
+  struct Results {
+    std::vector<int64_t> values;
+    size_t num_matches = 0;
+  } results;
+  results.values = random_values(SIZE, 1000000);
+  const auto is_even = [](int64_t x) { return x % 2 == 0; };
+
+  auto expected = results.values;
+  const auto expected_middle =
+      std::stable_partition(expected.begin(), expected.end(), is_even);
+
+  Scheduler scheduler{NUM_NODES};
+  scheduler.run([&results](SchedulerNode& node) {
+    Results* r = &results;
+    parallel::partition(node, r->values.begin(), r->values.end(),
+                        [](int64_t x) { return x % 2 == 0; },
+                        [r](SchedulerNode& node,
+                            std::vector<int64_t>::iterator middle) {
+      r->num_matches = middle - r->values.begin();
+      node.stop_scheduler();
+    }, SMALL_GRAIN);
+  });
+
+  EXPECT_EQ(expected, results.values);
+  EXPECT_EQ(expected_middle - expected.begin(), results.num_matches);
+}
+
+// Every algorithm calls done on an empty range, without touching it.
+TEST(ParallelTest, EmptyRanges) {
+  struct Results {
+    std::vector<int64_t> empty;
+    std::vector<int64_t> out{-1};
+    int num_done = 0;
+    bool middle_is_first = false;
+  } results;
+
+  Scheduler scheduler{NUM_NODES};
+  scheduler.run([&results](SchedulerNode& node) {
+    Results* r = &results;
+    const auto plus = [](int64_t a, int64_t b) { return a + b; };
+    parallel::parallel_for(
+        node, size_t{0}, size_t{0}, [r](size_t) { r->num_done = -100; },
+        [r, plus](SchedulerNode& node) {
+      ++r->num_done;
+      parallel::inclusive_scan(
+          node, r->empty.begin(), r->empty.end(), r->out.begin(), plus,
+          [r, plus](SchedulerNode& node) {
+        ++r->num_done;
+        parallel::exclusive_scan(
+            node, r->empty.begin(), r->empty.end(), r->out.begin(),
+            int64_t{5}, plus, [r](SchedulerNode& node) {
+          ++r->num_done;
+          parallel::sort(node, r->empty.begin(), r->empty.end(),
+                         [r](SchedulerNode& node) {
+            ++r->num_done;
+            parallel::partition(
+                node, r->empty.begin(), r->empty.end(),
+                [](int64_t x) { return x % 2 == 0; },
+                [r](SchedulerNode& node,
+                    std::vector<int64_t>::iterator middle) {
+              ++r->num_done;
+              r->middle_is_first = middle == r->empty.begin();
+              node.stop_scheduler();
+            });
+          });
+        }, SMALL_GRAIN);
+      });
+    });
+  });
+
+  EXPECT_EQ(5, results.num_done);
+  EXPECT_TRUE(results.middle_is_first);
+  EXPECT_EQ(std::vector<int64_t>{-1}, results.out);
+}
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,162 @@
+#ifndef SPARKS_CORE_RESOURCE_TRACKER_HPP_
+#define SPARKS_CORE_RESOURCE_TRACKER_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "executor.hpp"
+
+namespace sparks {
+
+// Derives task dependencies from the resources tasks access, rather than
+// having every edge wired by hand. A resource is any piece of shared state,
+// e.g. a component type or a buffer, and is identified by a ResourceId from
+// new_resource(). Each task declares the resources it reads and those it
+// writes; it then runs after the last task writing any of them and, for
+// those it writes, after every task reading them since. Readers of the same
+// resource run in parallel, writers in the order they were added.
+//
+// Only the edges needed for that ordering are added: a writer depends on
+// the readers following the previous write, not on the write itself, which
+// they already depend on.
+//
+// Not thread-safe: a single thread (or a single task at a time, like the
+// epoch task in test.cpp which adds the next frame) must add the tasks.
+class ResourceTracker {
+ public:
+  using ResourceId = uint32_t;
+  using TaskId = Executor::TaskId;
+  using ThreadId = Executor::ThreadId;
+
+  explicit ResourceTracker(Executor& executor) : executor_(executor) {}
+
+  ResourceTracker(const ResourceTracker&) = delete;
+  ResourceTracker& operator=(const ResourceTracker&) = delete;
+
+  Executor& executor() { return executor_; }
+
+  ResourceId new_resource() {
+    resources_.emplace_back();
+    return static_cast<ResourceId>(resources_.size() - 1);
+  }
+
+  // Adds a task to the Executor, depending on every earlier task which
+  // accesses its resources conflictingly. A resource both read and written
+  // only needs to be listed as written.
+  template <typename ClosureType,
+            typename ReadRange = ::std::initializer_list<ResourceId>,
+            typename WriteRange = ::std::initializer_list<ResourceId>>
+  TaskId add_task(ClosureType&& closure, const ReadRange& reads,
+                  const WriteRange& writes = {},
+                  ThreadId affinity = Executor::NO_AFFINITY);
+
+  // Adds an epoch task (see Executor::add_epoch_task()) which runs after
+  // every task added so far which accesses a resource, and before any added
+  // afterwards which does.
+  template <typename ClosureType>
+  TaskId add_epoch_task(ClosureType&& closure,
+                        ThreadId affinity = Executor::NO_AFFINITY);
+
+ private:
+  struct Resource {
+    TaskId last_writer{Executor::INVALID_TASK};
+
+    // The tasks reading the resource since last_writer was added.
+    std::vector<TaskId> readers;
+  };
+
+  Resource& resource(ResourceId id) {
+    DCHECK_LT(id, resources_.size()) << "Unknown resource.";
+    return resources_[id];
+  }
+
+  // Sorts and deduplicates dependencies_, which may name a task repeatedly.
+  void unique_dependencies() {
+    std::sort(dependencies_.begin(), dependencies_.end());
+    dependencies_.erase(
+        std::unique(dependencies_.begin(), dependencies_.end()),
+        dependencies_.end());
+  }
+
+  Executor& executor_;
+  std::vector<Resource> resources_;
+
+  // Scratch space for the dependencies of the task being added.
+  std::vector<TaskId> dependencies_;
+};
+
+template <typename ClosureType, typename ReadRange, typename WriteRange>
+ResourceTracker::TaskId ResourceTracker::add_task(ClosureType&& closure,
+                                                  const ReadRange& reads,
+                                                  const WriteRange& writes,
+                                                  ThreadId affinity) {
+  dependencies_.clear();
+  for (ResourceId id : reads) {
+    const auto& read = resource(id);
+    if (read.last_writer != Executor::INVALID_TASK) {
+      dependencies_.push_back(read.last_writer);
+    }
+  }
+  for (ResourceId id : writes) {
+    const auto& written = resource(id);
+    if (!written.readers.empty()) {
+      dependencies_.insert(dependencies_.end(), written.readers.begin(),
+                           written.readers.end());
+    } else if (written.last_writer != Executor::INVALID_TASK) {
+      dependencies_.push_back(written.last_writer);
+    }
+  }
+  unique_dependencies();
+
+  const TaskId task_id =
+      executor_.add_task(std::forward<ClosureType>(closure),
+                         dependencies_.begin(), dependencies_.end(), affinity);
+  if (task_id == Executor::INVALID_TASK) return task_id;
+
+  for (ResourceId id : writes) {
+    auto& written = resource(id);
+    written.last_writer = task_id;
+    written.readers.clear();
+  }
+  for (ResourceId id : reads) {
+    auto& read = resource(id);
+    // A resource also written by this task needs no reader entry.
+    if (read.last_writer != task_id) read.readers.push_back(task_id);
+  }
+  return task_id;
+}
+
+template <typename ClosureType>
+ResourceTracker::TaskId ResourceTracker::add_epoch_task(ClosureType&& closure,
+                                                        ThreadId affinity) {
+  dependencies_.clear();
+  for (const auto& each : resources_) {
+    if (!each.readers.empty()) {
+      dependencies_.insert(dependencies_.end(), each.readers.begin(),
+                           each.readers.end());
+    } else if (each.last_writer != Executor::INVALID_TASK) {
+      dependencies_.push_back(each.last_writer);
+    }
+  }
+  unique_dependencies();
+
+  const TaskId task_id = executor_.add_epoch_task(
+      std::forward<ClosureType>(closure), dependencies_.begin(),
+      dependencies_.end(), affinity);
+  if (task_id == Executor::INVALID_TASK) return task_id;
+
+  // Acts as a write of every resource.
+  for (auto& each : resources_) {
+    each.last_writer = task_id;
+    each.readers.clear();
+  }
+  return task_id;
+}
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_RESOURCE_TRACKER_HPP_
@@ -0,0 +1,122 @@
+#include "resource_tracker.hpp"
+#include "executor_test_util.hpp"
+
+#include <atomic>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+using ResourceId = ResourceTracker::ResourceId;
+
+// Adds tasks to a tracker with no workers, then runs them all.
+class ResourceTrackerTest : public ::testing::Test {
+ protected:
+  ResourceTrackerTest() : tracker_{executor_} {}
+
+  void run(int num_threads) {
+    ExecutorThreads threads{executor_, num_threads};
+    ASSERT_TRUE(wait_until_idle(executor_));
+  }
+
+  Executor executor_;
+  ResourceTracker tracker_;
+  TaskLog log_;
+};
+
+TEST_F(ResourceTrackerTest, ReadersRunBetweenWriters) {
+  const ResourceId a = tracker_.new_resource();
+  tracker_.add_task(Logged{&log_, 1}, {}, {a});
+  tracker_.add_task(Rendezvous{&log_, 2, 3}, {a});
+  tracker_.add_task(Rendezvous{&log_, 3, 2}, {a});
+  tracker_.add_task(Logged{&log_, 4}, {}, {a});
+  tracker_.add_task(Logged{&log_, 5}, {a});
+  run(3);
+
+  EXPECT_TRUE(log_.ended_before(1, 2));
+  EXPECT_TRUE(log_.ended_before(1, 3));
+  EXPECT_TRUE(overlapped(log_, 2, 3));
+  EXPECT_TRUE(log_.ended_before(2, 4));
+  EXPECT_TRUE(log_.ended_before(3, 4));
+  EXPECT_TRUE(log_.ended_before(4, 5));
+}
+
+TEST_F(ResourceTrackerTest, WritersRunInOrder) {
+  const ResourceId a = tracker_.new_resource();
+  for (int i = 0; i < 10; ++i) tracker_.add_task(Logged{&log_, i}, {}, {a});
+  run(3);
+
+  for (int i = 1; i < 10; ++i) EXPECT_TRUE(log_.ended_before(i - 1, i)) << i;
+}
+
+// Tasks on different resources don't wait for each other; one touching both
+// waits for both.
+TEST_F(ResourceTrackerTest, ResourcesAreIndependent) {
+  const ResourceId a = tracker_.new_resource();
+  const ResourceId b = tracker_.new_resource();
+  tracker_.add_task(Rendezvous{&log_, 1, 2}, {}, {a});
+  tracker_.add_task(Rendezvous{&log_, 2, 1}, {}, {b});
+  tracker_.add_task(Logged{&log_, 3}, {a}, {b});
+  run(2);
+
+  EXPECT_TRUE(overlapped(log_, 1, 2));
+  EXPECT_TRUE(log_.ended_before(1, 3));
+  EXPECT_TRUE(log_.ended_before(2, 3));
+}
+
+// A resource both read and written by a task counts as written: later
+// readers follow it, and so do later writers even with no reader between.
+TEST_F(ResourceTrackerTest, ReadAndWriteOfOneResource) {
+  const ResourceId a = tracker_.new_resource();
+  tracker_.add_task(Logged{&log_, 1}, {a}, {a});
+  tracker_.add_task(Logged{&log_, 2}, {a}, {a});
+  tracker_.add_task(Logged{&log_, 3}, {a});
+  tracker_.add_task(Logged{&log_, 4}, {a}, {a});
+  run(3);
+
+  EXPECT_TRUE(log_.ended_before(1, 2));
+  EXPECT_TRUE(log_.ended_before(2, 3));
+  EXPECT_TRUE(log_.ended_before(3, 4));
+}
+
+// An epoch task follows every earlier access and precedes every later one.
+TEST_F(ResourceTrackerTest, EpochTaskSeparatesAccesses) {
+  const ResourceId a = tracker_.new_resource();
+  const ResourceId b = tracker_.new_resource();
+  tracker_.add_task(Logged{&log_, 1}, {}, {a});
+  tracker_.add_task(Logged{&log_, 2}, {b});
+  tracker_.add_epoch_task(Logged{&log_, 3});
+  tracker_.add_task(Logged{&log_, 4}, {a});
+  tracker_.add_task(Logged{&log_, 5}, {}, {b});
+  run(3);
+
+  EXPECT_TRUE(log_.ended_before(1, 3));
+  EXPECT_TRUE(log_.ended_before(2, 3));
+  EXPECT_TRUE(log_.ended_before(3, 4));
+  EXPECT_TRUE(log_.ended_before(3, 5));
+}
+
+// The last writer of a resource may have completed (and its task id been
+// reused by an unrelated task) by the time a reader is added; the reader must
+// not wait for the unrelated task.
+TEST_F(ResourceTrackerTest, CompletedWriterIsNotWaitedFor) {
+  const ResourceId a = tracker_.new_resource();
+  ExecutorThreads threads{executor_, 2};
+  tracker_.add_task(Logged{&log_, 1}, {}, {a});
+  ASSERT_TRUE(wait_until_idle(executor_));
+
+  std::atomic<bool> release{false};
+  std::atomic<bool>* const release_ptr = &release;
+  executor_.add_task([release_ptr] {
+    wait_until([release_ptr] { return release_ptr->load(); });
+  });
+  tracker_.add_task(Logged{&log_, 2}, {a});
+  EXPECT_TRUE(wait_until([this] { return log_.started(2); }));
+  release = true;
+  ASSERT_TRUE(wait_until_idle(executor_));
+  EXPECT_TRUE(log_.ended_before(1, 2));
+}
+
+}  // namespace
+}  // namespace sparks
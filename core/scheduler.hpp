@@ -0,0 +1,591 @@
+#ifndef SPARKS_CORE_SCHEDULER_HPP_
+#define SPARKS_CORE_SCHEDULER_HPP_
+
+#include "atomic_id_vector.hpp"
+#include "work_stealing_queue.hpp"
+#include "arraydelegate.hpp"
+#include "unique_pulse.hpp"
+#include "cache_line.hpp"
+#include "aligned_allocator.hpp"
+#include "clock.hpp"
+#include "cpu_topology.hpp"
+
+#include <boost/lockfree/stack.hpp>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#undef DLOG
+#define DLOG if(false) LOG(INFO)
+
+namespace sparks {
+
+class Scheduler;
+class SchedulerNode;
+struct Task;
+
+// Each node keeps a queue per priority and runs (and steals) the most urgent
+// tasks first. Levels which were never used cost nothing.
+enum TaskPriority : uint8_t {
+  HIGH_PRIORITY,
+  NORMAL_PRIORITY,
+  LOW_PRIORITY,
+  NUM_PRIORITIES
+};
+
+// A set of tasks with a continuation which runs once all of them are done:
+// how a task waits for its children, or for an event, without blocking its
+// node. Get one from SchedulerNode::new_group(), spawn() the children and
+// pass the rest of the parent's work to then(). The continuation runs as a
+// new task on whichever node finishes the last child, after which the group
+// is released.
+class TaskGroup {
+ public:
+  using Continuation = sparks::arraydelegate<void(SchedulerNode&)>;
+
+  TaskGroup() = default;
+
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup(TaskGroup&&) = delete;
+
+  TaskGroup& operator=(const TaskGroup&) = delete;
+  TaskGroup& operator=(TaskGroup&&) = delete;
+
+  // Children may spawn further tasks into their group, as long as they do so
+  // before returning.
+  template <class Function>
+  inline void spawn(SchedulerNode& node, Function&& work,
+                    TaskPriority priority = NORMAL_PRIORITY);
+
+  // Makes the continuation also wait for something which is not a task of
+  // this group, e.g. a nested group or a Signal, until a matching release().
+  void hold() { pending_.fetch_add(1, std::memory_order_relaxed); }
+  inline void release(SchedulerNode& node);
+
+  // Sets the continuation; must be called exactly once, after the creating
+  // task's last spawn() and hold().
+  template <class Function>
+  inline void then(SchedulerNode& node, Function&& continuation);
+
+ private:
+  friend class SchedulerNode;
+
+  inline void arrive(SchedulerNode& node);
+
+  // Unfinished children and holds, plus one until then() is called.
+  std::atomic<uint32_t> pending_{1};
+  Continuation continuation_;
+  uint32_t id_;
+};
+
+class Scheduler {
+ public:
+  using NodeId = uint16_t;
+
+  static const size_t SCHEDULER_MAX_NODES = 32;
+  static const size_t SCHEDULER_MAX_UNSCHEDULED_TASKS_BITS = 24;
+  static const size_t SCHEDULER_MAX_GROUPS_BITS = 16;
+  static const NodeId NO_AFFINITY = static_cast<NodeId>(-1);
+  static const NodeId INVALID_NODE = static_cast<NodeId>(-1);
+
+  // Distances between nodes, by what their CPUs share (see steal_distance()).
+  static const int SMT_SIBLING_DISTANCE = 0;
+  static const int SHARED_L3_DISTANCE = 1;
+  static const int NUMA_LOCAL_DISTANCE = 2;
+  static const int REMOTE_DISTANCE = 3;
+
+  static const uint32_t DEFAULT_REMOTE_STEAL_PENALTY = 4;
+
+ private:
+  struct Task;
+  using TaskVector =
+    BasicAtomicIdVector<Task, uint32_t, SCHEDULER_MAX_UNSCHEDULED_TASKS_BITS>;
+  using GroupVector =
+    BasicAtomicIdVector<TaskGroup, uint32_t, SCHEDULER_MAX_GROUPS_BITS>;
+
+ public:
+  friend class SchedulerNode;
+
+  using TaskId = TaskVector::Id;
+
+  static const TaskId INVALID_TASK = TaskVector::INVALID_ID;
+
+  // If given, node i runs on placement[i] (see CpuTopology::place_workers()),
+  // including node 0, whose thread is the one calling run(). Nodes are only
+  // constructed by run(), each by its own thread once placed, so that their
+  // queues are allocated on their NUMA node.
+  explicit Scheduler(size_t num_nodes,
+                     std::vector<WorkerPlacement> placement = {});
+  ~Scheduler();
+
+  Scheduler(const Scheduler&) = delete;
+  Scheduler(Scheduler&&) = delete;
+
+  Scheduler& operator=(const Scheduler&) = delete;
+  Scheduler& operator=(Scheduler&&) = delete;
+
+  // Runs root on node 0 and every node's tasks until stop_scheduler(). Can
+  // only be called once.
+  template <class Function>
+  void run(Function&& root);
+
+  // Only valid once run() has started the node.
+  inline SchedulerNode& get_node(NodeId node_id);
+
+  size_t num_nodes() const { return num_nodes_; }
+
+  // How far apart two nodes' CPUs are. Without a placement every node counts
+  // as NUMA-local to every other.
+  int steal_distance(NodeId a, NodeId b) const;
+
+  // Idle nodes steal from SMT siblings first, then from nodes sharing an L3,
+  // then from the rest of their NUMA node, and only once that many sweeps of
+  // their NUMA node came back empty do they steal from remote nodes, whose
+  // tasks drag their data across the socket interconnect. Set before run().
+  void set_remote_steal_penalty(uint32_t sweeps) {
+    remote_steal_penalty_ = sweeps;
+  }
+  uint32_t remote_steal_penalty() const { return remote_steal_penalty_; }
+
+ private:
+  using WorkItem = sparks::arraydelegate<void(SchedulerNode&)>;
+
+  struct Task {
+    template <class Function>
+    Task(Function&& iwork) : work{std::forward<Function>(iwork)} {}
+
+    WorkItem work;
+  };
+
+  Task& get_task(TaskId id) { return tasks_[id]; }
+
+  // Constructs and attaches a node on its own thread, then waits until every
+  // node is, since any of them may be stolen from or delegated to.
+  inline void start_node(NodeId node_id);
+
+  void erase_task(TaskId id) { tasks_.erase(id); }
+
+  // Nodes are aligned to cache lines (see SchedulerNode), which new[] does not
+  // guarantee before C++17.
+  using NodeAllocator = AlignedAllocator<SchedulerNode, CACHE_LINE_SIZE>;
+
+  SchedulerNode* nodes_;
+  size_t num_nodes_;
+  std::atomic<size_t> num_started_nodes_{0};
+  std::vector<WorkerPlacement> placement_;
+  uint32_t remote_steal_penalty_{DEFAULT_REMOTE_STEAL_PENALTY};
+  TaskVector tasks_;
+  GroupVector groups_;
+};
+
+
+// A node is mostly touched by its own thread; the state other nodes write to,
+// to delegate tasks to it or to steal from it, is on cache lines of its own.
+// So are nodes, which live next to each other in the Scheduler.
+class alignas(CACHE_LINE_SIZE) SchedulerNode {
+ public:
+  friend class Scheduler;
+  friend class TaskGroup;
+
+  using TaskId = Scheduler::TaskId;
+  using NodeId = Scheduler::NodeId;
+
+  static const TaskId INVALID_TASK = Scheduler::INVALID_TASK;
+  static const NodeId INVALID_NODE = Scheduler::INVALID_NODE;
+  static const NodeId NO_AFFINITY = Scheduler::NO_AFFINITY;
+
+  SchedulerNode() {}
+
+  void attach(Scheduler& scheduler, NodeId this_id);
+
+  SchedulerNode(const SchedulerNode&) = delete;
+  SchedulerNode(SchedulerNode&&) = delete;
+
+  SchedulerNode& operator=(const SchedulerNode&) = delete;
+  SchedulerNode& operator=(SchedulerNode&&) = delete;
+
+  template <class Function>
+  void new_task(Function&& work, TaskPriority priority = NORMAL_PRIORITY);
+
+  void node_loop();
+  void stop_scheduler();
+
+  // A new, empty task group, allocated from storage preallocated by the
+  // Scheduler.
+  inline TaskGroup& new_group();
+
+  NodeId get_id() const { return this_id_; }
+  size_t num_nodes() const { return scheduler_->num_nodes(); }
+
+  // The nodes this one steals from, in order (see attach()); the first
+  // num_local_victims() are on its NUMA node.
+  const std::vector<NodeId>& victims() const { return victims_; }
+  size_t num_local_victims() const { return num_local_victims_; }
+
+ private:
+  using WorkItem = Scheduler::WorkItem;
+  using Task = Scheduler::Task;
+
+  static const size_t SCHEDULER_MAX_SCHEDULED_TASKS_BITS = 8;
+  static const size_t SCHEDULER_MAX_AFFINE_TASKS_BITS = 8;
+
+  // While several priorities are in use, every STARVATION_LIMIT-th local pull
+  // takes the least urgent task instead, so that a steady stream of urgent
+  // tasks cannot starve bulk work.
+  static const uint32_t STARVATION_LIMIT = 32;
+
+  using TaskStealingQueue =
+    WorkStealingQueue<TaskId, SCHEDULER_MAX_SCHEDULED_TASKS_BITS>;
+
+  bool wakeup_and_steal_from(NodeId from) {
+    if (available_.exchange(false, std::memory_order_acq_rel)) {
+      steal_from_.store(from, std::memory_order_release);
+      wakeup_.pulse();
+      return true;
+    }
+    return false;
+  }
+
+  void stop() {
+    stop_flag_.store(true);
+    wakeup_.pulse();
+  }
+
+  void release_group(TaskGroup& group) {
+    scheduler_->groups_.erase(
+        static_cast<Scheduler::GroupVector::Id>(group.id_));
+  }
+
+  void execute(TaskId task_id) {
+    Task& task = scheduler_->get_task(task_id);
+    task.work(*this);
+    scheduler_->erase_task(task_id);
+  }
+
+  inline void deplete_local_queue();
+
+  // Pulls one of this node's own tasks, most urgent first.
+  bool unique_pull(TaskId& task_id) {
+    const auto used = used_priorities_.load(std::memory_order_relaxed);
+    if ((used & (used - 1)) == 0) {
+      return used != 0 && queues_[__builtin_ctz(used)].unique_pull(task_id);
+    }
+
+    if (++num_pulls_since_least_urgent_ == STARVATION_LIMIT) {
+      num_pulls_since_least_urgent_ = 0;
+      for (int level = NUM_PRIORITIES - 1; level >= 0; --level) {
+        if ((used >> level & 1) && queues_[level].unique_pull(task_id)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    for (int level = 0; level < NUM_PRIORITIES; ++level) {
+      if ((used >> level & 1) && queues_[level].unique_pull(task_id)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Pulls a task from another node, most urgent first.
+  bool shared_pull(TaskId& task_id) {
+    const auto used = used_priorities_.load(std::memory_order_acquire);
+    for (int level = 0; level < NUM_PRIORITIES; ++level) {
+      if ((used >> level & 1) && queues_[level].shared_pull(task_id)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t num_queued_tasks() const {
+    const auto used = used_priorities_.load(std::memory_order_relaxed);
+    size_t num_tasks = 0;
+    for (int level = 0; level < NUM_PRIORITIES; ++level) {
+      if (used >> level & 1) num_tasks += queues_[level].size();
+    }
+    return num_tasks;
+  }
+
+  bool steal_and_execute(NodeId from) {
+    TaskId task_id;
+    if (scheduler_->get_node(from).shared_pull(task_id)) {
+      DLOG << get_id() << ": Stole task from " << from;
+      execute(task_id);
+      return true;
+    }
+    return false;
+  }
+
+  // Steals from the nearest node which has a task, trying remote ones only if
+  // include_remote.
+  bool steal_nearest_and_execute(bool include_remote, NodeId& stolen_from) {
+    const auto num_victims =
+        include_remote ? victims_.size() : num_local_victims_;
+    for (size_t i_victim = 0; i_victim < num_victims; ++i_victim) {
+      if (steal_and_execute(victims_[i_victim])) {
+        stolen_from = victims_[i_victim];
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Read by every node, written rarely.
+  Scheduler* scheduler_{nullptr};
+  NodeId this_id_{INVALID_NODE};
+
+  // Bit i is set once a task of priority i has been queued on this node; only
+  // those queues are ever looked at. Written by the owning node only.
+  std::atomic<uint32_t> used_priorities_{0};
+  std::atomic<bool> stop_flag_{false};
+
+  // Used by the owning node only.
+  uint32_t num_pulls_since_least_urgent_{0};
+
+  // The other nodes, nearest first; ties are broken by ring order, so that
+  // equidistant nodes do not all pick the same victim. The first
+  // num_local_victims_ are on this node's NUMA node.
+  std::vector<NodeId> victims_;
+  size_t num_local_victims_{0};
+
+  // Each padded to cache lines of their own.
+  TaskStealingQueue queues_[NUM_PRIORITIES];
+
+  // Written by the nodes delegating tasks to this one.
+  alignas(CACHE_LINE_SIZE) std::atomic<bool> available_{false};
+  std::atomic<NodeId> steal_from_{INVALID_NODE};
+  UniquePulse wakeup_;
+};
+
+inline Scheduler::Scheduler(size_t num_nodes,
+                            std::vector<WorkerPlacement> placement)
+    : placement_{std::move(placement)} {
+  CHECK(placement_.empty() || placement_.size() == num_nodes)
+      << "Need a placement for every node.";
+  nodes_ = NodeAllocator{}.allocate(num_nodes_ = num_nodes);
+}
+
+inline Scheduler::~Scheduler() {
+  // run() returns only once every node has started, if it was called at all.
+  if (num_started_nodes_.load() > 0) {
+    for (size_t i_node = 0; i_node < num_nodes_; ++i_node) {
+      nodes_[i_node].~SchedulerNode();
+    }
+  }
+  NodeAllocator{}.deallocate(nodes_, num_nodes_);
+}
+
+SchedulerNode& Scheduler::get_node(NodeId node_id) { return nodes_[node_id]; }
+
+inline int Scheduler::steal_distance(NodeId a, NodeId b) const {
+  if (placement_.empty()) return NUMA_LOCAL_DISTANCE;
+  const auto& from = placement_[a];
+  const auto& to = placement_[b];
+  if (from.numa_node != to.numa_node) return REMOTE_DISTANCE;
+  if (from.l3_group != to.l3_group) return NUMA_LOCAL_DISTANCE;
+  if (from.core != to.core) return SHARED_L3_DISTANCE;
+  return SMT_SIBLING_DISTANCE;
+}
+
+inline void Scheduler::start_node(NodeId node_id) {
+  new (&nodes_[node_id]) SchedulerNode;
+  nodes_[node_id].attach(*this, node_id);
+  ++num_started_nodes_;
+  while (num_started_nodes_.load() < num_nodes_) std::this_thread::yield();
+}
+
+template <class Function>
+void Scheduler::run(Function&& root) {
+  CHECK_EQ(num_started_nodes_.load(), 0u) << "Scheduler::run() called twice.";
+  std::vector<std::thread> threads;
+  auto num_additional_threads = num_nodes() - 1;
+  threads.reserve(num_additional_threads);
+
+  for (int i_thread = 0; i_thread < num_additional_threads; ++i_thread) {
+    threads.emplace_back([this, i_thread]{
+      // Pin before the node is constructed, so that its queues, the thread's
+      // stack and its allocations come from its own NUMA node.
+      if (!placement_.empty()) apply_placement(placement_[i_thread + 1]);
+      start_node(i_thread + 1);
+      get_node(i_thread + 1).node_loop();
+    });
+  }
+
+  std::unique_ptr<ScopedPlacement> root_placement;
+  if (!placement_.empty()) {
+    root_placement.reset(new ScopedPlacement{placement_[0]});
+  }
+  start_node(0);
+
+  Stopwatch stopwatch;
+  get_node(0).new_task(root);
+  get_node(0).node_loop();
+
+  for (auto& thread : threads) thread.join();
+  LOG(INFO) << stopwatch.elapsed_seconds();
+}
+
+inline void SchedulerNode::stop_scheduler() {
+  CHECK(scheduler_ != nullptr);
+  if (!stop_flag_.exchange(true)) {
+    DLOG << "Stopping scheduler...";
+    for (int i_node = 0; i_node < scheduler_->num_nodes(); ++i_node) {
+      scheduler_->get_node(i_node).stop();
+    }
+  }
+}
+
+inline void SchedulerNode::deplete_local_queue() {
+  TaskId task_id;
+  while (unique_pull(task_id)) {
+    DLOG << get_id() << ": Executing own task.";
+    execute(task_id);
+  }
+}
+
+template <class Function>
+void SchedulerNode::new_task(Function&& work, TaskPriority priority) {
+  TaskId new_task_id;
+  Task* new_task;
+  std::tie(new_task_id, new_task) = scheduler_->tasks_.emplace(std::forward<Function>(work));
+  DCHECK(new_task != nullptr);
+
+  DCHECK_LT(priority, NUM_PRIORITIES);
+  const auto used = used_priorities_.load(std::memory_order_relaxed);
+  if (!(used >> priority & 1)) {
+    used_priorities_.store(used | 1u << priority, std::memory_order_release);
+  }
+
+  while (!queues_[priority].unique_push(new_task_id))  {
+    TaskId pulled_id;
+    if (unique_pull(pulled_id)) execute(pulled_id);
+  }
+
+  // Try to delegate the task to another node if there's more than one task on
+  // the queue.
+  for (size_t i_victim = 0;
+       num_queued_tasks() > 1 && i_victim < victims_.size(); ++i_victim) {
+    const auto i_node = victims_[i_victim];
+    if (scheduler_->get_node(i_node).wakeup_and_steal_from(this_id_)) {
+      DLOG << get_id() << ": Explicitly delegated task to " << i_node;
+      return;
+    }
+  }
+}
+
+TaskGroup& SchedulerNode::new_group() {
+  Scheduler::GroupVector::Id group_id;
+  TaskGroup* group;
+  std::tie(group_id, group) = scheduler_->groups_.emplace();
+  CHECK(group != nullptr) << "Too many task groups.";
+  group->id_ = static_cast<uint32_t>(group_id);
+  return *group;
+}
+
+template <class Function>
+void TaskGroup::spawn(SchedulerNode& node, Function&& work,
+                      TaskPriority priority) {
+  pending_.fetch_add(1, std::memory_order_relaxed);
+  TaskGroup* group = this;
+  node.new_task([group, work](SchedulerNode& node) {
+    work(node);
+    group->arrive(node);
+  }, priority);
+}
+
+void TaskGroup::release(SchedulerNode& node) { arrive(node); }
+
+template <class Function>
+void TaskGroup::then(SchedulerNode& node, Function&& continuation) {
+  continuation_ = std::forward<Function>(continuation);
+  arrive(node);
+}
+
+void TaskGroup::arrive(SchedulerNode& node) {
+  if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    TaskGroup* group = this;
+    node.new_task([group](SchedulerNode& node) {
+      group->continuation_(node);
+      node.release_group(*group);
+    });
+  }
+}
+
+inline void SchedulerNode::attach(Scheduler& scheduler, NodeId this_id) {
+  CHECK(!scheduler_);
+  scheduler_ = &scheduler;
+  this_id_ = this_id;
+
+  const auto num_nodes = scheduler.num_nodes();
+  victims_.clear();
+  for (NodeId i_node = 1; i_node < num_nodes; ++i_node) {
+    victims_.push_back((this_id + i_node) % num_nodes);
+  }
+  std::stable_sort(victims_.begin(), victims_.end(),
+                   [&scheduler, this_id](NodeId a, NodeId b) {
+    return scheduler.steal_distance(this_id, a) <
+           scheduler.steal_distance(this_id, b);
+  });
+  num_local_victims_ = 0;
+  while (num_local_victims_ < victims_.size() &&
+         scheduler.steal_distance(this_id, victims_[num_local_victims_]) <
+             Scheduler::REMOTE_DISTANCE) {
+    ++num_local_victims_;
+  }
+
+  steal_from_.store(victims_.empty() ? this_id : victims_.front());
+}
+
+inline void SchedulerNode::node_loop() {
+  CHECK(scheduler_);
+  CHECK(this_id_ != INVALID_NODE);
+  const auto remote_steal_penalty = scheduler_->remote_steal_penalty();
+  const bool all_victims_local = num_local_victims_ == victims_.size();
+  uint32_t num_empty_runs = 0;
+  NodeId steal_id;
+  DLOG << get_id() << ": Node running. Depleting initial queue...";
+  deplete_local_queue();
+  available_.store(true);
+  while (!stop_flag_.load()) {
+    const bool include_remote = num_empty_runs >= remote_steal_penalty;
+    if (steal_nearest_and_execute(include_remote, steal_id)) {
+      if (!available_.exchange(false, std::memory_order_acq_rel)) {
+        auto new_steal_id = steal_from_.load(std::memory_order_acquire);
+        if (steal_id != new_steal_id && steal_and_execute(new_steal_id)) {
+          steal_id = new_steal_id;
+          DLOG << get_id() << ": Dealing with interleaved wakeup from "
+                    << steal_id;
+        }
+      }
+      num_empty_runs = 0;
+    } else if (include_remote || all_victims_local) {
+      DLOG << get_id() << ": Enough empty runs, sleeping...";
+      wakeup_.wait();
+      steal_id = steal_from_.load(std::memory_order_acquire);
+      DLOG << get_id() << ": Woken up by " << steal_id << ". Doing task..";
+      steal_and_execute(steal_id);
+      DLOG << get_id() << ": Going back to stealing.";
+      num_empty_runs = 0;
+    } else {
+      ++num_empty_runs;
+      continue;
+    }
+
+    TaskId pulled_id;
+    while (unique_pull(pulled_id)) execute(pulled_id);
+    available_.store(true, std::memory_order_release);
+  }
+}
+
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_SCHEDULER_HPP_
+
@@ -0,0 +1,345 @@
+#include "scheduler.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace sparks {
+namespace {
+
+// Constructing a Scheduler is expensive (its task vector has a fixed 2^24
+// capacity) and a Scheduler can only run() once, so every benchmark run uses a
+// single Scheduler and drives the iterations from inside it: each workload
+// calls Driver::next() from its last task, which either starts the next
+// iteration or stops the scheduler.
+class Driver {
+ public:
+  using Start = std::function<void(Driver&, SchedulerNode&)>;
+
+  Driver(benchmark::State& state, Start start)
+      : state_{&state}, start_{std::move(start)} {}
+
+  void next(SchedulerNode& node) {
+    if (state_->KeepRunning()) {
+      start_(*this, node);
+    } else {
+      node.stop_scheduler();
+    }
+  }
+
+  void run(std::vector<WorkerPlacement> placement = {}) {
+    Scheduler scheduler{static_cast<size_t>(state_->range(0)),
+                        std::move(placement)};
+    Driver* driver = this;
+    scheduler.run([driver](SchedulerNode& node) { driver->next(node); });
+  }
+
+ private:
+  benchmark::State* state_;
+  Start start_;
+};
+
+void burn(int64_t iterations) {
+  for (int64_t i = 0; i < iterations; ++i) benchmark::DoNotOptimize(i);
+}
+
+const int64_t TASK_WORK = 256;
+
+// Arguments: {num_nodes}.
+void thread_sweep(benchmark::internal::Benchmark* bench) {
+  bench->ArgName("nodes")->UseRealTime();
+  for (int64_t num_nodes = 1; num_nodes <= 8; num_nodes *= 2) {
+    bench->Arg(num_nodes);
+  }
+}
+
+// The 40x40x40 fork tree from sandbox.cpp, with lighter leaves.
+const int FORK_FANOUT = 40;
+
+struct ForkTree {
+  Driver* driver;
+  std::atomic<int> leaves_left;
+};
+
+void BM_SchedulerForkTree(benchmark::State& state) {
+  ForkTree tree;
+  Driver driver{state, [&tree](Driver&, SchedulerNode& node) {
+    tree.leaves_left.store(FORK_FANOUT * FORK_FANOUT * FORK_FANOUT);
+    ForkTree* t = &tree;
+    for (int i = 0; i < FORK_FANOUT; ++i) {
+      node.new_task([t](SchedulerNode& node) {
+        for (int j = 0; j < FORK_FANOUT; ++j) {
+          node.new_task([t](SchedulerNode& node) {
+            for (int k = 0; k < FORK_FANOUT; ++k) {
+              node.new_task([t](SchedulerNode& node) {
+                burn(TASK_WORK);
+                if (t->leaves_left.fetch_sub(1) == 1) t->driver->next(node);
+              });
+            }
+          });
+        }
+      });
+    }
+  }};
+  tree.driver = &driver;
+  driver.run();
+  state.SetItemsProcessed(
+      state.iterations() * FORK_FANOUT * FORK_FANOUT * FORK_FANOUT);
+}
+BENCHMARK(BM_SchedulerForkTree)->Apply(thread_sweep);
+
+// The fork tree on two sockets, with flat (range(1) == 0) or hierarchical
+// victim selection, counting the tasks which ran on another socket than the
+// task which spawned them, i.e. whose data crossed the interconnect. On a
+// single-socket machine the nodes are split into two halves as if they were on
+// separate sockets: that shows the difference in steal locality, but not its
+// cost.
+struct SocketForkTree {
+  Driver* driver;
+  std::vector<int> socket_of_node;
+  std::atomic<int> leaves_left;
+  std::atomic<int64_t> cross_socket_tasks;
+
+  template <class Function>
+  void spawn(SchedulerNode& node, Function&& work) {
+    SocketForkTree* t = this;
+    const auto parent_socket = socket_of_node[node.get_id()];
+    node.new_task([t, parent_socket, work](SchedulerNode& node) {
+      if (t->socket_of_node[node.get_id()] != parent_socket) {
+        t->cross_socket_tasks.fetch_add(1, std::memory_order_relaxed);
+      }
+      work(node);
+    });
+  }
+};
+
+std::vector<WorkerPlacement> two_socket_placement(size_t num_nodes) {
+  const auto topology = CpuTopology::detect();
+  auto placement = topology.place_workers(num_nodes);
+  if (topology.num_numa_nodes() == 1) {
+    for (size_t i_node = 0; i_node < num_nodes; ++i_node) {
+      placement[i_node].numa_node = static_cast<int>(i_node * 2 / num_nodes);
+      placement[i_node].l3_group = placement[i_node].numa_node;
+    }
+  }
+  return placement;
+}
+
+void BM_SchedulerForkTreeSockets(benchmark::State& state) {
+  const auto num_nodes = static_cast<size_t>(state.range(0));
+  auto placement = two_socket_placement(num_nodes);
+
+  SocketForkTree tree;
+  tree.cross_socket_tasks.store(0);
+  for (const auto& node_placement : placement) {
+    tree.socket_of_node.push_back(node_placement.numa_node);
+  }
+
+  // Flat stealing: same CPUs, but the Scheduler is not told where they are.
+  if (state.range(1) == 0) {
+    for (auto& node_placement : placement) {
+      node_placement.l3_group = 0;
+      node_placement.numa_node = 0;
+    }
+  }
+
+  Driver driver{state, [&tree](Driver&, SchedulerNode& node) {
+    tree.leaves_left.store(FORK_FANOUT * FORK_FANOUT * FORK_FANOUT);
+    SocketForkTree* t = &tree;
+    for (int i = 0; i < FORK_FANOUT; ++i) {
+      t->spawn(node, [t](SchedulerNode& node) {
+        for (int j = 0; j < FORK_FANOUT; ++j) {
+          t->spawn(node, [t](SchedulerNode& node) {
+            for (int k = 0; k < FORK_FANOUT; ++k) {
+              t->spawn(node, [t](SchedulerNode& node) {
+                burn(TASK_WORK);
+                if (t->leaves_left.fetch_sub(1) == 1) t->driver->next(node);
+              });
+            }
+          });
+        }
+      });
+    }
+  }};
+  tree.driver = &driver;
+  driver.run(std::move(placement));
+  state.SetItemsProcessed(
+      state.iterations() * FORK_FANOUT * FORK_FANOUT * FORK_FANOUT);
+  state.counters["cross_socket_tasks"] = benchmark::Counter(
+      tree.cross_socket_tasks.load(), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_SchedulerForkTreeSockets)
+    ->ArgNames({"nodes", "hierarchical"})
+    ->ArgsProduct({{2, 4, 8}, {0, 1}})
+    ->UseRealTime();
+
+// A chain of tasks each of which spawns the next one.
+const int CHAIN_LENGTH = 1024;
+
+void chain_link(Driver* driver, int index, SchedulerNode& node) {
+  burn(TASK_WORK);
+  if (index + 1 == CHAIN_LENGTH) {
+    driver->next(node);
+  } else {
+    node.new_task([driver, index](SchedulerNode& node) {
+      chain_link(driver, index + 1, node);
+    });
+  }
+}
+
+void BM_SchedulerChain(benchmark::State& state) {
+  Driver driver{state, [](Driver& driver, SchedulerNode& node) {
+    Driver* d = &driver;
+    node.new_task([d](SchedulerNode& node) { chain_link(d, 0, node); });
+  }};
+  driver.run();
+  state.SetItemsProcessed(state.iterations() * CHAIN_LENGTH);
+}
+BENCHMARK(BM_SchedulerChain)->Apply(thread_sweep);
+
+// One task spawns FAN_WIDTH tasks, the last of which to finish spawns a join
+// task. The Scheduler has no dependencies, so the join is an atomic counter.
+const int FAN_WIDTH = 1024;
+
+struct Fan {
+  Driver* driver;
+  int64_t work;
+  std::atomic<int> pending;
+};
+
+void fan_out(Fan* fan, SchedulerNode& node) {
+  fan->pending.store(FAN_WIDTH);
+  for (int i = 0; i < FAN_WIDTH; ++i) {
+    node.new_task([fan](SchedulerNode& node) {
+      burn(fan->work);
+      if (fan->pending.fetch_sub(1) == 1) {
+        node.new_task([fan](SchedulerNode& node) { fan->driver->next(node); });
+      }
+    });
+  }
+}
+
+void BM_SchedulerFanOutFanIn(benchmark::State& state) {
+  Fan fan;
+  fan.work = TASK_WORK;
+  Driver driver{state, [&fan](Driver&, SchedulerNode& node) {
+    Fan* f = &fan;
+    node.new_task([f](SchedulerNode& node) { fan_out(f, node); });
+  }};
+  fan.driver = &driver;
+  driver.run();
+  state.SetItemsProcessed(state.iterations() * FAN_WIDTH);
+}
+BENCHMARK(BM_SchedulerFanOutFanIn)->Apply(thread_sweep);
+
+// Same shape as the fan, but the tasks do no work: measures per-task overhead.
+void BM_SchedulerEmptyTasks(benchmark::State& state) {
+  Fan fan;
+  fan.work = 0;
+  Driver driver{state, [&fan](Driver&, SchedulerNode& node) {
+    fan_out(&fan, node);
+  }};
+  fan.driver = &driver;
+  driver.run();
+  state.SetItemsProcessed(state.iterations() * FAN_WIDTH);
+}
+BENCHMARK(BM_SchedulerEmptyTasks)->Apply(thread_sweep);
+
+// The frame graph from core/test.cpp. Tasks with more than one dependency are
+// spawned by whichever of their dependencies finishes last; frame_end only
+// needs to wait for audio and render_end since every other task precedes one
+// of them.
+struct Frame {
+  using Step = void (*)(Frame*, SchedulerNode&);
+
+  void spawn(SchedulerNode& node, Step step) {
+    Frame* frame = this;
+    node.new_task([frame, step](SchedulerNode& node) { step(frame, node); });
+  }
+
+  void arrive(SchedulerNode& node, std::atomic<int>& pending, Step step) {
+    if (pending.fetch_sub(1) == 1) spawn(node, step);
+  }
+
+  Driver* driver;
+  std::atomic<int> gameplay_pending;
+  std::atomic<int> render_start_pending;
+  std::atomic<int> render_end_pending;
+  std::atomic<int> frame_end_pending;
+};
+
+void frame_end(Frame* f, SchedulerNode& node) { f->driver->next(node); }
+
+void render_end(Frame* f, SchedulerNode& node) {
+  f->arrive(node, f->frame_end_pending, frame_end);
+}
+
+void render(Frame* f, SchedulerNode& node) {
+  burn(TASK_WORK);
+  f->arrive(node, f->render_end_pending, render_end);
+}
+
+void render_start(Frame* f, SchedulerNode& node) {
+  for (int i = 0; i < 4; ++i) f->spawn(node, render);
+}
+
+void audio(Frame* f, SchedulerNode& node) {
+  burn(TASK_WORK);
+  f->arrive(node, f->frame_end_pending, frame_end);
+}
+
+void gameplay(Frame* f, SchedulerNode& node) {
+  burn(TASK_WORK);
+  f->spawn(node, audio);
+  f->arrive(node, f->render_start_pending, render_start);
+}
+
+void anim(Frame* f, SchedulerNode& node) {
+  burn(TASK_WORK);
+  f->arrive(node, f->gameplay_pending, gameplay);
+  f->arrive(node, f->render_start_pending, render_start);
+}
+
+void scene(Frame* f, SchedulerNode& node) {
+  burn(TASK_WORK);
+  f->spawn(node, anim);
+  f->arrive(node, f->gameplay_pending, gameplay);
+  f->arrive(node, f->render_start_pending, render_start);
+}
+
+void ai_or_ctrl(Frame* f, SchedulerNode& node) {
+  burn(TASK_WORK);
+  f->arrive(node, f->gameplay_pending, gameplay);
+}
+
+void gui(Frame* f, SchedulerNode& node) {
+  burn(TASK_WORK);
+  f->arrive(node, f->render_start_pending, render_start);
+}
+
+void frame_start(Frame* f, SchedulerNode& node) {
+  f->spawn(node, scene);
+  f->spawn(node, ai_or_ctrl);
+  f->spawn(node, ai_or_ctrl);
+  f->spawn(node, gui);
+}
+
+void BM_SchedulerFrameDag(benchmark::State& state) {
+  Frame frame;
+  Driver driver{state, [&frame](Driver&, SchedulerNode& node) {
+    frame.gameplay_pending.store(4);
+    frame.render_start_pending.store(4);
+    frame.render_end_pending.store(4);
+    frame.frame_end_pending.store(2);
+    frame.spawn(node, frame_start);
+  }};
+  frame.driver = &driver;
+  driver.run();
+}
+BENCHMARK(BM_SchedulerFrameDag)->Apply(thread_sweep);
+
+}  // namespace
+}  // namespace sparks
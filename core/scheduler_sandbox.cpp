@@ -1,5 +1,4 @@
 #include "scheduler.hpp"
-#include <SDL2/SDL.h>
 
 namespace {
   std::atomic<int> tasks_left{0};
@@ -14,7 +13,8 @@ bool task_done() {
 int main() {
   google::InitGoogleLogging("sparks");
   google::LogToStderr();
-  sparks::Scheduler scheduler{4};
+  sparks::Scheduler scheduler{
+      4, sparks::CpuTopology::detect().place_workers(4)};
 
   tasks_left.store(64000);
   scheduler.run([] (sparks::SchedulerNode& node){
@@ -0,0 +1,170 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+// A single node, so that the order in which tasks run is deterministic: all
+// tasks are queued by the root task before any of them runs.
+struct Order {
+  std::vector<TaskPriority> ran;
+  size_t num_tasks = 0;
+
+  void spawn(SchedulerNode& node, TaskPriority priority) {
+    Order* order = this;
+    ++num_tasks;
+    node.new_task([order, priority](SchedulerNode& node) {
+      order->ran.push_back(priority);
+      if (order->ran.size() == order->num_tasks) node.stop_scheduler();
+    }, priority);
+  }
+};
+
+TEST(SchedulerTest, UrgentTasksRunFirst) {
+  Order order;
+
+  Scheduler scheduler{1};
+  scheduler.run([&order](SchedulerNode& node) {
+    for (int i = 0; i < 4; ++i) order.spawn(node, LOW_PRIORITY);
+    for (int i = 0; i < 4; ++i) order.spawn(node, NORMAL_PRIORITY);
+    for (int i = 0; i < 4; ++i) order.spawn(node, HIGH_PRIORITY);
+  });
+
+  ASSERT_EQ(12, order.ran.size());
+  for (int i = 0; i < 12; ++i) {
+    EXPECT_EQ(i / 4, order.ran[i]) << "task " << i;
+  }
+}
+
+TEST(SchedulerTest, LowPriorityIsNotStarved) {
+  const int NUM_URGENT = 128;
+  Order order;
+
+  Scheduler scheduler{1};
+  scheduler.run([&order](SchedulerNode& node) {
+    order.spawn(node, LOW_PRIORITY);
+    for (int i = 0; i < NUM_URGENT; ++i) order.spawn(node, HIGH_PRIORITY);
+  });
+
+  ASSERT_EQ(NUM_URGENT + 1, order.ran.size());
+  size_t low_at = 0;
+  while (order.ran[low_at] != LOW_PRIORITY) ++low_at;
+  EXPECT_LT(low_at, NUM_URGENT);
+}
+
+// Two sockets of four nodes: on each, the first two are SMT siblings, the
+// third shares their L3 and the fourth has an L3 of its own. CPUs are folded
+// onto the machine's, so that run() can pin to them.
+std::vector<WorkerPlacement> two_socket_placement() {
+  const int num_cpus =
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  std::vector<WorkerPlacement> placement;
+  for (int socket = 0; socket < 2; ++socket) {
+    const int base = 4 * socket;
+    placement.push_back({base % num_cpus, base, base, socket});
+    placement.push_back({(base + 1) % num_cpus, base, base, socket});
+    placement.push_back({(base + 2) % num_cpus, base + 2, base, socket});
+    placement.push_back({(base + 3) % num_cpus, base + 3, base + 3, socket});
+  }
+  return placement;
+}
+
+TEST(SchedulerTest, StealDistance) {
+  const int SMT_SIBLING = Scheduler::SMT_SIBLING_DISTANCE;
+  const int SHARED_L3 = Scheduler::SHARED_L3_DISTANCE;
+  const int NUMA_LOCAL = Scheduler::NUMA_LOCAL_DISTANCE;
+  const int REMOTE = Scheduler::REMOTE_DISTANCE;
+  Scheduler scheduler{8, two_socket_placement()};
+  EXPECT_EQ(SMT_SIBLING, scheduler.steal_distance(0, 1));
+  EXPECT_EQ(SHARED_L3, scheduler.steal_distance(0, 2));
+  EXPECT_EQ(SHARED_L3, scheduler.steal_distance(2, 1));
+  EXPECT_EQ(NUMA_LOCAL, scheduler.steal_distance(3, 0));
+  EXPECT_EQ(REMOTE, scheduler.steal_distance(0, 4));
+  EXPECT_EQ(REMOTE, scheduler.steal_distance(7, 3));
+  EXPECT_EQ(SMT_SIBLING, scheduler.steal_distance(5, 4));
+
+  Scheduler unplaced{8};
+  EXPECT_EQ(NUMA_LOCAL, unplaced.steal_distance(0, 4));
+}
+
+// Victims are ordered SMT sibling, shared L3, rest of the NUMA node, then
+// remote nodes; within each, in ring order from the node.
+TEST(SchedulerTest, VictimsNearestFirst) {
+  using NodeIds = std::vector<Scheduler::NodeId>;
+  Scheduler scheduler{8, two_socket_placement()};
+  const struct {
+    Scheduler::NodeId node;
+    NodeIds victims;
+  } cases[] = {{0, {1, 2, 3, 4, 5, 6, 7}},
+               {2, {0, 1, 3, 4, 5, 6, 7}},
+               {3, {0, 1, 2, 4, 5, 6, 7}},
+               {5, {4, 6, 7, 0, 1, 2, 3}},
+               {7, {4, 5, 6, 0, 1, 2, 3}}};
+  for (const auto& c : cases) {
+    SchedulerNode node;
+    node.attach(scheduler, c.node);
+    EXPECT_EQ(c.victims, node.victims()) << "node " << c.node;
+    EXPECT_EQ(3u, node.num_local_victims()) << "node " << c.node;
+  }
+
+  // Without a placement, every node is local.
+  Scheduler unplaced{4};
+  SchedulerNode node;
+  node.attach(unplaced, 1);
+  EXPECT_EQ((NodeIds{2, 3, 0}), node.victims());
+  EXPECT_EQ(3u, node.num_local_victims());
+}
+
+// Which nodes ran a root task's children, each of which waits a while for
+// another node to run one.
+struct StealLog {
+  static const int NUM_TASKS = 8;
+
+  void run(SchedulerNode& root) {
+    StealLog* log = this;
+    for (int i = 0; i < NUM_TASKS; ++i) {
+      root.new_task([log](SchedulerNode& node) {
+        log->ran_on[node.get_id()] = true;
+        const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+        while (!log->ran_on[1] && std::chrono::steady_clock::now() < deadline) {
+          std::this_thread::yield();
+        }
+        if (++log->num_done == NUM_TASKS) node.stop_scheduler();
+      });
+    }
+  }
+
+  std::atomic<bool> ran_on[2] = {{false}, {false}};
+  std::atomic<int> num_done{0};
+};
+
+// A node only steals from another socket once it has found its own empty
+// remote_steal_penalty() times over: never, with the largest penalty.
+TEST(SchedulerTest, RemoteStealsWaitForThePenalty) {
+  const std::vector<WorkerPlacement> placement = two_socket_placement();
+  for (uint32_t penalty : {0u, 4u, UINT32_MAX}) {
+    StealLog log;
+    Scheduler scheduler{2, {placement[0], placement[4]}};
+    EXPECT_EQ(3, scheduler.steal_distance(0, 1));
+    scheduler.set_remote_steal_penalty(penalty);
+    EXPECT_EQ(penalty, scheduler.remote_steal_penalty());
+    scheduler.run([&log](SchedulerNode& node) { log.run(node); });
+
+    EXPECT_EQ(int{StealLog::NUM_TASKS}, log.num_done.load());
+    EXPECT_EQ(penalty != UINT32_MAX, log.ran_on[1].load())
+        << "penalty " << penalty;
+  }
+}
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,183 @@
+#ifndef SPARKS_CORE_SHARED_ID_VECTOR_HPP_
+#define SPARKS_CORE_SHARED_ID_VECTOR_HPP_
+
+#include "shared_id_vector_fwd.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include <glog/logging.h>
+
+namespace sparks {
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS,
+         uint8_t PAGE_BITS>
+BasicSharedIdVector<ElemType, IdType, OUTER_BITS, PAGE_BITS>::
+    BasicSharedIdVector(size_type capacity) {
+  for (auto& page : pages_) page.store(nullptr, std::memory_order_relaxed);
+  DCHECK_LE(capacity, MAX_SIZE);
+  while (this->capacity() < capacity) add_page();
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS,
+         uint8_t PAGE_BITS>
+BasicSharedIdVector<ElemType, IdType, OUTER_BITS, PAGE_BITS>::
+    ~BasicSharedIdVector() {
+  const auto num_pages = num_pages_.load();
+  const auto max_index = capacity();
+  for (size_type i_page = 0; i_page < num_pages; ++i_page) {
+    Entry* page = pages_[i_page].load();
+    const size_type page_begin = i_page << PAGE_BITS;
+    for (size_type i = 0; i < PAGE_SIZE && page_begin + i < max_index; ++i) {
+      if ((page[i].id.load() & OUTER_MASK) == page_begin + i) {
+        reinterpret_cast<value_type*>(page[i].data)->~value_type();
+      }
+    }
+    delete[] page;
+  }
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS,
+         uint8_t PAGE_BITS>
+typename BasicSharedIdVector<ElemType, IdType, OUTER_BITS, PAGE_BITS>::size_type
+BasicSharedIdVector<ElemType, IdType, OUTER_BITS, PAGE_BITS>::capacity()
+    const {
+  return static_cast<size_type>(std::min<size_t>(
+      static_cast<size_t>(num_pages_.load()) << PAGE_BITS, MAX_SIZE));
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS,
+         uint8_t PAGE_BITS>
+bool BasicSharedIdVector<ElemType, IdType, OUTER_BITS, PAGE_BITS>::is_valid_id(
+    Id id) const {
+  const auto outer_id = id & OUTER_MASK;
+  if (outer_id >= MAX_SIZE) return false;
+  Entry* page = pages_[outer_id >> PAGE_BITS].load(std::memory_order_acquire);
+  return page && page[outer_id & PAGE_MASK].id.load() == id;
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS,
+         uint8_t PAGE_BITS>
+template<typename... Args>
+typename BasicSharedIdVector<ElemType, IdType, OUTER_BITS, PAGE_BITS>::Id
+BasicSharedIdVector<ElemType, IdType, OUTER_BITS, PAGE_BITS>::emplace(
+    Args&&... args) {
+  Id head_mirror, new_head;
+  size_type index;
+  do {
+    head_mirror = free_head_.load();
+    index = head_mirror & OUTER_MASK;
+    if (index == INVALID_INDEX) {
+      if (!add_page()) return INVALID_INDEX;
+      continue;
+    }
+
+    // The head's inner part is a counter which changes on every push and pop,
+    // so the CAS fails if the entry has been popped (and maybe pushed back)
+    // since we read its link.
+    const auto next_index = entry(index).id.load() & OUTER_MASK;
+    new_head = increment_tag(head_mirror) | next_index;
+  } while (index == INVALID_INDEX ||
+           !free_head_.compare_exchange_weak(head_mirror, new_head));
+
+  Entry& new_entry = entry(index);
+  new (reinterpret_cast<value_type*>(new_entry.data)) value_type(
+      std::forward<Args>(args)...);
+  size_.fetch_add(1, std::memory_order_relaxed);
+
+  const Id new_id = (new_entry.id.load() & INNER_MASK) | index;
+  new_entry.id.store(new_id);
+  return new_id;
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS,
+         uint8_t PAGE_BITS>
+bool BasicSharedIdVector<ElemType, IdType, OUTER_BITS, PAGE_BITS>::erase(
+    Id freed_id) {
+  const auto outer_freed_id = freed_id & OUTER_MASK;
+  if (!is_valid_id(freed_id)) return false;
+
+  // Claim the entry by bumping its tag. It keeps pointing at itself until it
+  // is pushed onto the free list, so it is neither free nor valid meanwhile.
+  Entry& freed_entry = entry(outer_freed_id);
+  Id expected = freed_id;
+  const Id claimed = increment_tag(freed_id) | outer_freed_id;
+  if (!freed_entry.id.compare_exchange_strong(expected, claimed)) {
+    return false;  // Lost the race against another erase().
+  }
+
+  // Destroy stored object.
+  reinterpret_cast<value_type*>(freed_entry.data)->~value_type();
+  size_.fetch_sub(1, std::memory_order_relaxed);
+
+  push_free(outer_freed_id, freed_entry);
+  return true;
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS,
+         uint8_t PAGE_BITS>
+ElemType& BasicSharedIdVector<ElemType, IdType, OUTER_BITS, PAGE_BITS>::
+operator[](Id id) {
+  return const_cast<value_type&>(
+      const_cast<const BasicSharedIdVector&>(*this)[id]);
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS,
+         uint8_t PAGE_BITS>
+const ElemType& BasicSharedIdVector<ElemType, IdType, OUTER_BITS, PAGE_BITS>::
+operator[](Id id) const {
+  DCHECK(is_valid_id(id)) << "Stale index used: " << id;
+  return *reinterpret_cast<const value_type*>(entry(id & OUTER_MASK).data);
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS,
+         uint8_t PAGE_BITS>
+typename BasicSharedIdVector<ElemType, IdType, OUTER_BITS, PAGE_BITS>::Entry&
+BasicSharedIdVector<ElemType, IdType, OUTER_BITS, PAGE_BITS>::entry(
+    size_type index) const {
+  DCHECK_LT(index, MAX_SIZE);
+  Entry* page = pages_[index >> PAGE_BITS].load(std::memory_order_acquire);
+  DCHECK(page != nullptr);
+  return page[index & PAGE_MASK];
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS,
+         uint8_t PAGE_BITS>
+bool BasicSharedIdVector<ElemType, IdType, OUTER_BITS, PAGE_BITS>::add_page() {
+  auto i_page = num_pages_.load();
+  do {
+    if (i_page == MAX_PAGES) return false;
+  } while (!num_pages_.compare_exchange_weak(i_page, i_page + 1));
+
+  // Chain the page's entries together; the last index of the last page is
+  // INVALID_INDEX, so that page has one entry less.
+  const size_type page_begin = i_page << PAGE_BITS;
+  const size_type page_end = std::min<size_t>(
+      static_cast<size_t>(page_begin) + PAGE_SIZE, MAX_SIZE);
+  Entry* page = new Entry[PAGE_SIZE];
+  for (size_type i = page_begin; i < page_end; ++i) {
+    page[i - page_begin].id.store(i + 1, std::memory_order_relaxed);
+  }
+  pages_[i_page].store(page, std::memory_order_release);
+
+  push_free(page_begin, page[page_end - 1 - page_begin]);
+  return true;
+}
+
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS,
+         uint8_t PAGE_BITS>
+void BasicSharedIdVector<ElemType, IdType, OUTER_BITS, PAGE_BITS>::push_free(
+    size_type first, Entry& last) {
+  const Id last_tag = last.id.load() & INNER_MASK;
+  Id head_mirror = free_head_.load(), new_head;
+  do {
+    last.id.store(last_tag | (head_mirror & OUTER_MASK));
+    new_head = increment_tag(head_mirror) | first;
+  } while (!free_head_.compare_exchange_weak(head_mirror, new_head));
+}
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_SHARED_ID_VECTOR_HPP_
@@ -0,0 +1,34 @@
+#include "shared_id_vector.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace sparks {
+namespace {
+
+struct Element {
+  explicit Element(int64_t x) : x{x} {}
+  int64_t x;
+};
+
+using SharedIdVector = BasicSharedIdVector<Element, uint32_t, 20>;
+using Id = SharedIdVector::Id;
+
+// Every thread emplaces a batch of elements into the same vector, then erases
+// them, as concurrent task submitters do.
+void BM_SharedIdVectorEmplaceErase(benchmark::State& state) {
+  static SharedIdVector vector{1 << 16};
+  const size_t batch = 64;
+  std::vector<Id> ids(batch);
+  for (auto _ : state) {
+    for (size_t i = 0; i < batch; ++i) ids[i] = vector.emplace(i);
+    for (auto id : ids) vector.erase(id);
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_SharedIdVectorEmplaceErase)->ThreadRange(1, 8)->UseRealTime();
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,103 @@
+#ifndef SPARKS_CORE_SHARED_ID_VECTOR_FWD_HPP_
+#define SPARKS_CORE_SHARED_ID_VECTOR_FWD_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+namespace sparks {
+
+// A concurrent version of BasicStableIdVector: emplace(), erase() and
+// is_valid_id() may be called from any number of threads without locking.
+// Elements never move and are allocated in pages of 2^PAGE_BITS entries which
+// are only freed with the vector.
+//
+// Accessing an element through operator[] is not synchronized with erasing
+// it; the caller needs to ensure the id stays valid while it is being used.
+template<typename ElemType, typename IdType, uint8_t OUTER_BITS,
+         uint8_t PAGE_BITS = 8>
+class BasicSharedIdVector {
+ public:
+  using Id = IdType;
+  using size_type = IdType;
+  using value_type = ElemType;
+  using reference_type = ElemType&;
+  using pointer_type = ElemType*;
+
+  static_assert(OUTER_BITS < sizeof(IdType) * 8,
+                "There needs to be at least one inner bit.");
+  static_assert(PAGE_BITS <= OUTER_BITS, "Page larger than max size.");
+
+  static const Id OUTER_MASK = (1 << OUTER_BITS) - 1;
+  static const Id INNER_MASK = ~OUTER_MASK;
+  static const Id MAX_INDEX = OUTER_MASK - 1;
+  static const Id INVALID_INDEX = OUTER_MASK;
+  static const size_type MAX_SIZE = MAX_INDEX + 1;
+  static const size_type PAGE_SIZE = 1 << PAGE_BITS;
+  static const size_type MAX_PAGES = (MAX_SIZE + PAGE_SIZE - 1) >> PAGE_BITS;
+
+  explicit BasicSharedIdVector(size_type capacity = 0);
+
+  // Destruction must be synchronized: all method calls in all threads need to
+  // have finished before calling the destructor.
+  ~BasicSharedIdVector();
+
+  // Non-copyable nor movable since it cannot be done lockfree.
+  BasicSharedIdVector(const BasicSharedIdVector&) = delete;
+  BasicSharedIdVector(BasicSharedIdVector&&) = delete;
+
+  BasicSharedIdVector& operator=(const BasicSharedIdVector&) = delete;
+  BasicSharedIdVector& operator=(BasicSharedIdVector&&) = delete;
+
+  bool is_valid_id(Id id) const;
+
+  // Returns INVALID_INDEX if all MAX_SIZE entries are in use.
+  template<typename ...Args>
+  inline Id emplace(Args&& ...args);
+
+  // Idempotent: erasing a stale id is a no-op which returns false.
+  inline bool erase(Id id);
+
+  inline value_type& operator[](Id id);
+  inline const value_type& operator[](Id id) const;
+
+  // Approximate when other threads are emplacing or erasing.
+  size_type size() const { return size_.load(std::memory_order_relaxed); }
+  size_type capacity() const;
+
+ private:
+  using AtomicId = std::atomic<Id>;
+
+  static const size_type PAGE_MASK = PAGE_SIZE - 1;
+
+  struct Entry {
+    alignas(value_type) char data[sizeof(value_type)];
+
+    // For live entries, the id of the element: its outer part is the index of
+    // the entry. For free entries, the outer part links to the next free
+    // entry while the inner part is the tag the next element will get.
+    AtomicId id;
+  };
+
+  static Id increment_tag(Id id) {
+    return ((id & INNER_MASK) + (1 << OUTER_BITS)) & INNER_MASK;
+  }
+
+  inline Entry& entry(size_type index) const;
+
+  // Allocates a new page and pushes all its entries on the free list; returns
+  // false if there is no room for another page. Threads which concurrently run
+  // out of entries each add a page rather than wait for one another.
+  bool add_page();
+
+  // Pushes a chain of entries [first ... last] onto the free list.
+  void push_free(size_type first, Entry& last);
+
+  std::atomic<Entry*> pages_[MAX_PAGES];
+  std::atomic<size_type> num_pages_{0};
+  AtomicId free_head_{INVALID_INDEX};
+  std::atomic<size_type> size_{0};
+};
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_SHARED_ID_VECTOR_FWD_HPP_
@@ -0,0 +1,204 @@
+#include "shared_id_vector.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+struct Element {
+  Element(int owner, int seq) : owner{owner}, seq{seq} {
+    num_live.fetch_add(1);
+  }
+  ~Element() { num_live.fetch_sub(1); }
+
+  int owner;
+  int seq;
+
+  static std::atomic<int> num_live;
+};
+
+std::atomic<int> Element::num_live{0};
+
+// 15 entries in pages of 4, with 12 bits of tag.
+using SmallVector = BasicSharedIdVector<Element, uint16_t, 4, 2>;
+
+// 63 entries in pages of 4, so that the free list is short and contended.
+using ContendedVector = BasicSharedIdVector<Element, uint32_t, 6, 2>;
+
+struct SharedIdVectorTest : public ::testing::Test {
+  void TearDown() { EXPECT_EQ(0, Element::num_live.load()); }
+};
+
+TEST_F(SharedIdVectorTest, SingleThreaded) {
+  SmallVector vector;
+  EXPECT_EQ(0, vector.size());
+  EXPECT_EQ(0, vector.capacity());
+  EXPECT_FALSE(vector.is_valid_id(0));
+
+  const auto a = vector.emplace(0, 1);
+  const auto b = vector.emplace(0, 2);
+  ASSERT_NE(SmallVector::Id{SmallVector::INVALID_INDEX}, a);
+  ASSERT_NE(SmallVector::Id{SmallVector::INVALID_INDEX}, b);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(2, vector.size());
+  EXPECT_EQ(4, vector.capacity());
+  EXPECT_TRUE(vector.is_valid_id(a));
+  EXPECT_TRUE(vector.is_valid_id(b));
+  EXPECT_EQ(1, vector[a].seq);
+  EXPECT_EQ(2, vector[b].seq);
+
+  // Elements never move, whatever else is emplaced and erased.
+  const Element* const b_pointer = &vector[b];
+  EXPECT_TRUE(vector.erase(a));
+  EXPECT_FALSE(vector.erase(a));
+  EXPECT_FALSE(vector.is_valid_id(a));
+  EXPECT_EQ(1, vector.size());
+  for (int i = 0; i < 8; ++i) vector.emplace(0, 3 + i);
+  EXPECT_EQ(b_pointer, &vector[b]);
+  EXPECT_EQ(2, vector[b].seq);
+  EXPECT_EQ(9, vector.size());
+  EXPECT_EQ(12, vector.capacity());
+  EXPECT_EQ(9, Element::num_live.load());
+
+  // The destructor destroys the remaining elements (see TearDown()).
+}
+
+TEST_F(SharedIdVectorTest, FullVectorReturnsInvalidIndex) {
+  SmallVector vector;
+  std::vector<SmallVector::Id> ids;
+  for (int i = 0; i < int{SmallVector::MAX_SIZE}; ++i) {
+    ids.push_back(vector.emplace(0, i));
+    ASSERT_NE(SmallVector::Id{SmallVector::INVALID_INDEX}, ids.back());
+  }
+  EXPECT_EQ(size_t{SmallVector::MAX_SIZE}, vector.size());
+  EXPECT_EQ(size_t{SmallVector::MAX_SIZE}, vector.capacity());
+  EXPECT_EQ(SmallVector::Id{SmallVector::INVALID_INDEX}, vector.emplace(0, -1));
+
+  std::set<SmallVector::Id> indices;
+  for (auto id : ids) indices.insert(id & SmallVector::OUTER_MASK);
+  EXPECT_EQ(size_t{SmallVector::MAX_SIZE}, indices.size());
+
+  EXPECT_TRUE(vector.erase(ids[7]));
+  const auto reused = vector.emplace(0, 7);
+  EXPECT_EQ(ids[7] & SmallVector::OUTER_MASK,
+            reused & SmallVector::OUTER_MASK);
+  EXPECT_EQ(SmallVector::Id{SmallVector::INVALID_INDEX}, vector.emplace(0, -1));
+}
+
+// Reusing an entry gives it a new tag, so ids of erased elements stay invalid
+// (and erasing them stays a no-op) until the tag wraps around.
+TEST_F(SharedIdVectorTest, ReusedEntriesGetNewIds) {
+  const int NUM_TAGS = 1 << 12;
+  SmallVector vector;
+  const auto first = vector.emplace(0, 0);
+  std::set<SmallVector::Id> seen{first};
+  auto id = first;
+  for (int i = 1; i < NUM_TAGS; ++i) {
+    ASSERT_TRUE(vector.erase(id));
+    id = vector.emplace(0, i);
+    // Only one entry is free at a time: the one just erased.
+    ASSERT_EQ(first & SmallVector::OUTER_MASK, id & SmallVector::OUTER_MASK);
+    EXPECT_FALSE(vector.is_valid_id(first));
+    EXPECT_FALSE(vector.erase(first));
+    EXPECT_TRUE(seen.insert(id).second) << "Id reused after " << i;
+  }
+  EXPECT_EQ(1, vector.size());
+}
+
+// Only one of several threads erasing the same id succeeds, and the element
+// is destroyed exactly once.
+TEST_F(SharedIdVectorTest, ConcurrentEraseOfOneId) {
+  const int NUM_THREADS = 4;
+  const int NUM_IDS = 1000;
+  BasicSharedIdVector<Element, uint32_t, 12> vector;
+  std::vector<uint32_t> ids;
+  for (int i = 0; i < NUM_IDS; ++i) ids.push_back(vector.emplace(0, i));
+
+  std::vector<std::atomic<int>> num_erased(NUM_IDS);
+  std::vector<std::thread> threads;
+  for (int i_thread = 0; i_thread < NUM_THREADS; ++i_thread) {
+    threads.emplace_back([&vector, &ids, &num_erased, i_thread] {
+      for (int i = 0; i < NUM_IDS; ++i) {
+        // Start at different places so that threads do collide.
+        const int i_id = (i + i_thread * NUM_IDS / NUM_THREADS) % NUM_IDS;
+        if (vector.erase(ids[i_id])) num_erased[i_id].fetch_add(1);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  int num_not_once = 0;
+  for (const auto& count : num_erased) num_not_once += count.load() != 1;
+  EXPECT_EQ(0, num_not_once);
+  EXPECT_EQ(0, vector.size());
+  EXPECT_EQ(0, Element::num_live.load());
+}
+
+// Threads emplace and erase on a nearly full vector, which keeps the free
+// list short and its head contended: any ABA on the head would hand one entry
+// to two threads (one overwriting the other's element) or lose entries.
+TEST_F(SharedIdVectorTest, ManyThreadsEmplaceAndErase) {
+  const int NUM_THREADS = 4;
+  const int NUM_ITERS = 100000;
+  const int MAX_LIVE_PER_THREAD = 15;
+  ContendedVector vector;
+  std::atomic<int> num_corrupted{0};
+
+  std::vector<std::thread> threads;
+  for (int i_thread = 0; i_thread < NUM_THREADS; ++i_thread) {
+    threads.emplace_back([&, i_thread] {
+      std::vector<uint32_t> live;
+      for (int i = 0; i < NUM_ITERS; ++i) {
+        if (live.size() < MAX_LIVE_PER_THREAD && i % 3 != 2) {
+          const auto id = vector.emplace(i_thread, i);
+          if (id == ContendedVector::INVALID_INDEX) {
+            std::this_thread::yield();
+          } else {
+            live.push_back(id);
+          }
+          continue;
+        }
+        if (live.empty()) continue;
+
+        // Erase the oldest live element after checking that it still holds
+        // what this thread wrote.
+        const auto id = live.front();
+        live.erase(live.begin());
+        const Element& element = vector[id];
+        if (element.owner != i_thread || element.seq >= i) {
+          num_corrupted.fetch_add(1);
+        }
+        if (!vector.erase(id)) num_corrupted.fetch_add(1);
+      }
+      for (auto id : live) {
+        if (vector[id].owner != i_thread || !vector.erase(id)) {
+          num_corrupted.fetch_add(1);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_EQ(0, num_corrupted.load());
+  EXPECT_EQ(0, vector.size());
+  EXPECT_EQ(0, Element::num_live.load());
+
+  // No entry was lost from (or duplicated on) the free list.
+  std::set<uint32_t> indices;
+  for (uint32_t i = 0; i < ContendedVector::MAX_SIZE; ++i) {
+    const auto id = vector.emplace(0, 0);
+    ASSERT_NE(uint32_t{ContendedVector::INVALID_INDEX}, id);
+    indices.insert(id & ContendedVector::OUTER_MASK);
+  }
+  EXPECT_EQ(size_t{ContendedVector::MAX_SIZE}, indices.size());
+  EXPECT_EQ(uint32_t{ContendedVector::INVALID_INDEX}, vector.emplace(0, 0));
+}
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,63 @@
+#ifndef SPARKS_CORE_SIGNAL_HPP_
+#define SPARKS_CORE_SIGNAL_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+#include <glog/logging.h>
+
+#include "futex.hpp"
+
+namespace sparks {
+
+// A manual-reset event: wait() blocks until trigger() is called, then every
+// wait() returns immediately until reset(). The triggered flag and the number
+// of parked waiters share one atomic word, so trigger() is a single atomic
+// operation and makes a futex call only if someone is actually waiting.
+class Signal {
+ public:
+  static const uint32_t SPIN_COUNT{8};
+
+  ~Signal() {
+    CHECK_EQ(state_.load() >> WAITER_SHIFT, 0);
+  }
+
+  void trigger() {
+    const auto old_state = state_.fetch_or(TRIGGERED);
+    if (!(old_state & TRIGGERED) && (old_state >> WAITER_SHIFT) > 0) {
+      futex_wake_all(state_);
+    }
+  }
+
+  void reset() {
+    const auto old_state = state_.fetch_and(~TRIGGERED);
+    CHECK_EQ(old_state >> WAITER_SHIFT, 0);
+    CHECK(old_state & TRIGGERED);
+  }
+
+  void wait() {
+    for (uint32_t i_spin = 0; i_spin < SPIN_COUNT; ++i_spin) {
+      if (state_.load() & TRIGGERED) return;
+    }
+
+    auto state = state_.fetch_add(ONE_WAITER) + ONE_WAITER;
+    while (!(state & TRIGGERED)) {
+      futex_wait(state_, state);
+      state = state_.load();
+    }
+    state_.fetch_sub(ONE_WAITER);
+  }
+
+ private:
+  static const uint32_t TRIGGERED = 1;
+  static const uint32_t WAITER_SHIFT = 1;
+  static const uint32_t ONE_WAITER = 1 << WAITER_SHIFT;
+
+  // Bit 0: triggered. Bits 1 to 31: number of threads in wait()'s slow path.
+  std::atomic<uint32_t> state_{0};
+};
+
+}  // namespace sparks
+
+
+#endif  // #ifndef SPARKS_CORE_SIGNAL_HPP_
@@ -0,0 +1,42 @@
+#include "signal.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+TEST(SignalTest, TriggeredSignalDoesNotBlock) {
+  Signal signal;
+  signal.trigger();
+  signal.wait();
+  signal.wait();
+  signal.reset();
+}
+
+TEST(SignalTest, TriggerWakesAllWaiters) {
+  const int kNumWaiters = 8;
+  const int kNumRounds = 200;
+  Signal go;
+  std::atomic<int> woken{0};
+
+  for (int i_round = 0; i_round < kNumRounds; ++i_round) {
+    std::vector<std::thread> waiters;
+    for (int i = 0; i < kNumWaiters; ++i) {
+      waiters.emplace_back([&] {
+        go.wait();
+        woken.fetch_add(1);
+      });
+    }
+    go.trigger();
+    for (auto& waiter : waiters) waiter.join();
+    EXPECT_EQ((i_round + 1) * kNumWaiters, woken.load());
+    go.reset();
+  }
+}
+
+}  // namespace
+}  // namespace sparks
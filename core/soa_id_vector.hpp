@@ -0,0 +1,148 @@
+#ifndef SPARKS_CORE_SOA_ID_VECTOR_HPP_
+#define SPARKS_CORE_SOA_ID_VECTOR_HPP_
+
+#include "soa_id_vector_fwd.hpp"
+#include "id_index_map.hpp"
+
+#include <utility>
+
+#include <glog/logging.h>
+
+namespace sparks {
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields>
+BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::BasicSoaIdVector(
+    size_type min_ids, size_type min_elements) {
+  reserve_ids(min_ids);
+  reserve_elements(min_elements);
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields>
+void BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::reserve_ids(
+    size_type new_size) {
+  ids_.reserve_ids(new_size);
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields>
+void BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::reserve_elements(
+    size_type new_size) {
+  DCHECK_LE(new_size, MAX_SIZE);
+  reserve_fields(AllFields{}, new_size);
+  ids_.reserve_indices(new_size);
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields> inline
+bool BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::is_valid_id(
+    Id id) const {
+  return ids_.is_valid_id(id);
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields> inline
+typename BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::Id
+BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::id_from_index(
+    size_type index) const {
+  return ids_.id_at(index);
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields> inline
+typename BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::size_type
+BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::index_from_id(Id id) const {
+  return ids_.index_of(id);
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields> inline
+typename BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::Id
+BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::emplace() {
+  const auto id = ids_.create_id();
+  emplace_back_fields(AllFields{}, Fields{}...);
+  return id;
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields>
+template<typename... Args> inline
+typename BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::Id
+BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::emplace(
+    Args&&... field_values) {
+  static_assert(sizeof...(Args) == NUM_FIELDS,
+                "emplace() takes one initializer per field.");
+  const auto id = ids_.create_id();
+  emplace_back_fields(AllFields{}, std::forward<Args>(field_values)...);
+  return id;
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields> inline
+void BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::erase(Id id) {
+  swap_remove_fields(AllFields{}, ids_.free_id(id));
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields>
+template <size_t FIELD> inline
+typename BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::template field_type<
+    FIELD>&
+BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::get(Id id) {
+  return std::get<FIELD>(fields_)[ids_.index_of(id)];
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields>
+template <size_t FIELD> inline
+const typename BasicSoaIdVector<IdType, OUTER_BITS,
+                                Fields...>::template field_type<FIELD>&
+BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::get(Id id) const {
+  return std::get<FIELD>(fields_)[ids_.index_of(id)];
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields>
+template <size_t FIELD> inline
+typename BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::template field_type<
+    FIELD>*
+BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::data() {
+  return static_cast<field_type<FIELD>*>(__builtin_assume_aligned(
+      std::get<FIELD>(fields_).data(), FIELD_ALIGNMENT));
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields>
+template <size_t FIELD> inline
+const typename BasicSoaIdVector<IdType, OUTER_BITS,
+                                Fields...>::template field_type<FIELD>*
+BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::data() const {
+  return static_cast<const field_type<FIELD>*>(__builtin_assume_aligned(
+      std::get<FIELD>(fields_).data(), FIELD_ALIGNMENT));
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields>
+template <size_t... I> inline
+void BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::reserve_fields(
+    soa_detail::Indices<I...>, size_type new_size) {
+  using expand = int[];
+  (void)expand{0, (std::get<I>(fields_).reserve(new_size), 0)...};
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields>
+template <size_t... I, typename... Args> inline
+void BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::emplace_back_fields(
+    soa_detail::Indices<I...>, Args&&... field_values) {
+  using expand = int[];
+  (void)expand{0, (std::get<I>(fields_).emplace_back(
+                       std::forward<Args>(field_values)), 0)...};
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields>
+template <size_t... I> inline
+void BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::swap_remove_fields(
+    soa_detail::Indices<I...>, size_type index) {
+  using expand = int[];
+  (void)expand{0, (swap_remove(std::get<I>(fields_), index), 0)...};
+}
+
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields>
+template <typename Vector> inline
+void BasicSoaIdVector<IdType, OUTER_BITS, Fields...>::swap_remove(
+    Vector& field, size_type index) {
+  // Same as BasicIdVector::free_id: move the last element into the hole.
+  if (index != field.size() - 1) field[index] = std::move(field.back());
+  field.pop_back();
+}
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_SOA_ID_VECTOR_HPP_
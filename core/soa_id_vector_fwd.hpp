@@ -0,0 +1,118 @@
+#ifndef SPARKS_CORE_SOA_ID_VECTOR_FWD_HPP_
+#define SPARKS_CORE_SOA_ID_VECTOR_FWD_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "aligned_allocator.hpp"
+#include "id_index_map_fwd.hpp"
+
+namespace sparks {
+
+namespace soa_detail {
+
+template <size_t... I>
+struct Indices {};
+
+template <size_t N, size_t... I>
+struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+
+template <size_t... I>
+struct MakeIndices<0, I...> {
+  using type = Indices<I...>;
+};
+
+}  // namespace soa_detail
+
+// Structure-of-arrays counterpart of BasicIdVector: every field is stored in
+// its own packed, cache line aligned array and all the arrays share the same
+// id -> index mapping. Loops over a single field (via data<FIELD>() and
+// size()) only touch that field's memory and can be auto-vectorized.
+template<typename IdType, uint8_t OUTER_BITS, typename... Fields>
+class BasicSoaIdVector {
+ public:
+  using Id = IdType;
+  using size_type = IdType;
+  using IndexMap = BasicIdIndexMap<IdType, OUTER_BITS>;
+
+  static const size_t NUM_FIELDS = sizeof...(Fields);
+  static const size_t FIELD_ALIGNMENT = 64;
+
+  template <size_t FIELD>
+  using field_type =
+      typename std::tuple_element<FIELD, std::tuple<Fields...>>::type;
+
+  static const Id OUTER_MASK = IndexMap::OUTER_MASK;
+  static const Id INNER_MASK = IndexMap::INNER_MASK;
+  static const Id MAX_INDEX = IndexMap::MAX_INDEX;
+  static const Id INVALID_INDEX = IndexMap::INVALID_INDEX;
+  static const size_type MAX_SIZE = IndexMap::MAX_SIZE;
+
+  static_assert(NUM_FIELDS > 0, "no fields");
+
+  inline BasicSoaIdVector(size_type min_ids, size_type min_elements);
+
+  inline void reserve_ids(size_type new_size);
+  inline void reserve_elements(size_type new_size);
+
+  inline bool is_valid_id(Id id) const;
+  inline Id id_from_index(size_type index) const;
+  inline size_type index_from_id(Id id) const;
+
+  // Takes either no arguments (all fields are value-initialized) or exactly one
+  // initializer per field.
+  inline Id emplace();
+  template<typename ...Args>
+  inline Id emplace(Args&& ...field_values);
+
+  inline void erase(Id id);
+
+  template <size_t FIELD>
+  inline field_type<FIELD>& get(Id id);
+  template <size_t FIELD>
+  inline const field_type<FIELD>& get(Id id) const;
+
+  // The packed array of a field; element i belongs to id_from_index(i).
+  template <size_t FIELD>
+  inline field_type<FIELD>* data();
+  template <size_t FIELD>
+  inline const field_type<FIELD>* data() const;
+
+  bool empty() const { return size() == 0; }
+  size_type size() const { return ids_.size(); }
+  size_type capacity() const {
+    return static_cast<size_type>(std::get<0>(fields_).capacity());
+  }
+
+ private:
+  template <typename Field>
+  using FieldVector =
+      std::vector<Field, AlignedAllocator<Field, FIELD_ALIGNMENT>>;
+
+  using AllFields = typename soa_detail::MakeIndices<NUM_FIELDS>::type;
+
+  template <size_t... I>
+  inline void reserve_fields(soa_detail::Indices<I...>, size_type new_size);
+
+  template <size_t... I, typename... Args>
+  inline void emplace_back_fields(soa_detail::Indices<I...>,
+                                  Args&&... field_values);
+
+  template <size_t... I>
+  inline void swap_remove_fields(soa_detail::Indices<I...>, size_type index);
+
+  template <typename Vector>
+  static inline void swap_remove(Vector& field, size_type index);
+
+  IndexMap ids_;
+  std::tuple<FieldVector<Fields>...> fields_;
+};
+
+template<typename... Fields>
+using SoaIdVector32 = BasicSoaIdVector<uint32_t, 24, Fields...>;
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_SOA_ID_VECTOR_FWD_HPP_
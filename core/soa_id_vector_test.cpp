@@ -0,0 +1,103 @@
+#include "soa_id_vector.hpp"
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+using Particles = SoaIdVector32<float, int, std::string>;
+
+TEST(SoaIdVectorTest, EmplaceAndGet) {
+  Particles particles{4, 4};
+  EXPECT_TRUE(particles.empty());
+  EXPECT_GE(particles.capacity(), 4u);
+
+  const auto a = particles.emplace(1.5f, 2, std::string{"a"});
+  const auto b = particles.emplace();
+  EXPECT_EQ(2u, particles.size());
+  EXPECT_EQ(1.5f, particles.get<0>(a));
+  EXPECT_EQ(2, particles.get<1>(a));
+  EXPECT_EQ("a", particles.get<2>(a));
+
+  // emplace() with no arguments value-initializes every field.
+  EXPECT_EQ(0.0f, particles.get<0>(b));
+  EXPECT_EQ(0, particles.get<1>(b));
+  EXPECT_EQ("", particles.get<2>(b));
+
+  particles.get<1>(b) = 7;
+  EXPECT_EQ(7, particles.data<1>()[particles.index_from_id(b)]);
+}
+
+// Each field is a separate packed array, starting on a cache line.
+TEST(SoaIdVectorTest, FieldsAreAlignedArrays) {
+  Particles particles{0, 0};
+  for (int i = 0; i < 100; ++i) particles.emplace(float(i), i, std::string{});
+
+  const auto alignment = uintptr_t{Particles::FIELD_ALIGNMENT};
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(particles.data<0>()) % alignment);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(particles.data<1>()) % alignment);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(particles.data<2>()) % alignment);
+  for (uint32_t i = 0; i < particles.size(); ++i) {
+    EXPECT_EQ(float(particles.data<1>()[i]), particles.data<0>()[i]);
+  }
+}
+
+// Erasing swap-removes from every field, keeping the rows together.
+TEST(SoaIdVectorTest, EraseKeepsFieldsOfAnIdTogether) {
+  Particles particles{0, 0};
+  const auto a = particles.emplace(1.0f, 1, std::string{"one"});
+  const auto b = particles.emplace(2.0f, 2, std::string{"two"});
+  const auto c = particles.emplace(3.0f, 3, std::string{"three"});
+
+  particles.erase(a);
+  EXPECT_FALSE(particles.is_valid_id(a));
+  EXPECT_EQ(2u, particles.size());
+  EXPECT_EQ(0u, particles.index_from_id(c));
+  EXPECT_EQ(c, particles.id_from_index(0));
+  EXPECT_EQ(3.0f, particles.data<0>()[0]);
+  EXPECT_EQ(3, particles.data<1>()[0]);
+  EXPECT_EQ("three", particles.data<2>()[0]);
+  EXPECT_EQ("two", particles.get<2>(b));
+
+  // The freed id is reused with a new tag.
+  const auto d = particles.emplace(4.0f, 4, std::string{"four"});
+  EXPECT_NE(a, d);
+  EXPECT_FALSE(particles.is_valid_id(a));
+  EXPECT_EQ(4, particles.get<1>(d));
+}
+
+// Random emplaces and erases against a reference map from id to row.
+TEST(SoaIdVectorTest, RandomOperationsMatchReference) {
+  Particles particles{0, 0};
+  std::map<uint32_t, int> reference;
+  std::mt19937 random{7};
+  for (int i = 0; i < 5000; ++i) {
+    if (reference.empty() || random() % 3 != 0) {
+      const auto id = particles.emplace(float(i), i, std::to_string(i));
+      EXPECT_TRUE(reference.emplace(id, i).second);
+    } else {
+      auto erased = reference.begin();
+      std::advance(erased, random() % reference.size());
+      particles.erase(erased->first);
+      reference.erase(erased);
+    }
+  }
+
+  ASSERT_EQ(reference.size(), size_t{particles.size()});
+  for (const auto& id_and_row : reference) {
+    const auto id = id_and_row.first;
+    const int row = id_and_row.second;
+    ASSERT_TRUE(particles.is_valid_id(id));
+    EXPECT_EQ(float(row), particles.get<0>(id));
+    EXPECT_EQ(row, particles.get<1>(id));
+    EXPECT_EQ(std::to_string(row), particles.get<2>(id));
+  }
+}
+
+}  // namespace
+}  // namespace sparks
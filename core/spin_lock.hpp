@@ -0,0 +1,260 @@
+#ifndef SPARKS_CORE_SPIN_LOCK_HPP_
+#define SPARKS_CORE_SPIN_LOCK_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "clock.hpp"
+#include "futex.hpp"
+
+namespace sparks {
+
+// Tells the CPU we are busy-waiting: saves power and, on hyper-threaded cores,
+// yields execution resources to the sibling thread.
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// Counters exported by the locks below. Counts cover every lock() since
+// construction; times are in Clock ticks.
+struct SpinLockStats {
+  // Number of times the lock was acquired.
+  uint64_t acquisitions;
+
+  // Number of acquisitions which found the lock taken.
+  uint64_t contended;
+
+  // Number of contended acquisitions which ran out of spins and parked (or,
+  // for ticket locks, yielded).
+  uint64_t parked;
+
+  // Total time spent waiting in contended acquisitions.
+  Clock::Ticks wait_ticks;
+
+  // Total time the lock was held; only measured by locks with TIME_HOLDS,
+  // since it takes two clock reads per acquisition.
+  Clock::Ticks hold_ticks;
+};
+
+namespace spin_lock_detail {
+
+// Keeps the counters of one lock. Every record_*() call is made by the lock's
+// holder, so the counters need no read-modify-write atomics: they are atomic
+// only so that stats() can be called concurrently. They sit on their own cache
+// line so that updating them does not disturb the waiters spinning on the
+// lock word.
+template<bool TIME_HOLDS>
+class alignas(64) StatsRecorder {
+ public:
+  void record_acquired() {
+    add(acquisitions_, 1);
+    if (TIME_HOLDS) acquired_at_ = Clock::now();
+  }
+
+  void record_contended(Clock::Ticks waiting_since, bool parked) {
+    add(contended_, 1);
+    if (parked) add(parked_, 1);
+    add(wait_ticks_, Clock::now() - waiting_since);
+  }
+
+  void record_released() {
+    if (TIME_HOLDS) add(hold_ticks_, Clock::now() - acquired_at_);
+  }
+
+  SpinLockStats stats() const {
+    return {acquisitions_.load(std::memory_order_relaxed),
+            contended_.load(std::memory_order_relaxed),
+            parked_.load(std::memory_order_relaxed),
+            wait_ticks_.load(std::memory_order_relaxed),
+            hold_ticks_.load(std::memory_order_relaxed)};
+  }
+
+ private:
+  static void add(std::atomic<uint64_t>& counter, uint64_t by) {
+    counter.store(counter.load(std::memory_order_relaxed) + by,
+                  std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> acquisitions_{0};
+  std::atomic<uint64_t> contended_{0};
+  std::atomic<uint64_t> parked_{0};
+  std::atomic<uint64_t> wait_ticks_{0};
+  std::atomic<uint64_t> hold_ticks_{0};
+  Clock::Ticks acquired_at_{0};
+};
+
+}  // namespace spin_lock_detail
+
+// A test-and-test-and-set lock with exponential backoff which parks on a
+// futex once its spin budget runs out, so that long waits (e.g. behind a
+// preempted holder) do not burn a core. Uncontended lock() and unlock() are a
+// single atomic operation each. Not fair: see BasicTicketSpinLock.
+//
+// Satisfies Lockable, so it works with std::lock_guard and std::unique_lock.
+template<bool TIME_HOLDS>
+class BasicSpinLock {
+ public:
+  // Backoff rounds before parking, and the cap of the exponential backoff
+  // in pause instructions per round.
+  static const uint32_t SPIN_BUDGET = 64;
+  static const uint32_t MAX_BACKOFF = 64;
+
+  BasicSpinLock() = default;
+
+  BasicSpinLock(const BasicSpinLock&) = delete;
+  BasicSpinLock(BasicSpinLock&&) = delete;
+
+  BasicSpinLock& operator=(const BasicSpinLock&) = delete;
+  BasicSpinLock& operator=(BasicSpinLock&&) = delete;
+
+  void lock() {
+    uint32_t expected = UNLOCKED;
+    if (!state_.compare_exchange_strong(expected, LOCKED,
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed)) {
+      lock_contended();
+    }
+    stats_.record_acquired();
+  }
+
+  bool try_lock() {
+    uint32_t expected = UNLOCKED;
+    if (state_.load(std::memory_order_relaxed) == UNLOCKED &&
+        state_.compare_exchange_strong(expected, LOCKED,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+      stats_.record_acquired();
+      return true;
+    }
+    return false;
+  }
+
+  void unlock() {
+    stats_.record_released();
+    if (state_.exchange(UNLOCKED, std::memory_order_release) == PARKED) {
+      futex_wake(state_);
+    }
+  }
+
+  SpinLockStats stats() const { return stats_.stats(); }
+
+ private:
+  // PARKED means locked with (possibly) threads waiting on the futex, which
+  // unlock() must then wake.
+  enum : uint32_t { UNLOCKED = 0, LOCKED = 1, PARKED = 2 };
+
+  void lock_contended() {
+    const auto waiting_since = Clock::now();
+
+    uint32_t backoff = 1;
+    for (uint32_t i_spin = 0; i_spin < SPIN_BUDGET; ++i_spin) {
+      // Only attempt the (cache line stealing) CAS if the lock looks free.
+      uint32_t expected = UNLOCKED;
+      if (state_.load(std::memory_order_relaxed) == UNLOCKED &&
+          state_.compare_exchange_weak(expected, LOCKED,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        stats_.record_contended(waiting_since, false);
+        return;
+      }
+      for (uint32_t i_pause = 0; i_pause < backoff; ++i_pause) cpu_relax();
+      if (backoff < MAX_BACKOFF) backoff *= 2;
+    }
+
+    // Having parked once, we cannot know whether others are still parked, so
+    // we take the lock as PARKED, which costs the next unlock() a wake call.
+    while (state_.exchange(PARKED, std::memory_order_acquire) != UNLOCKED) {
+      futex_wait(state_, PARKED);
+    }
+    stats_.record_contended(waiting_since, true);
+  }
+
+  std::atomic<uint32_t> state_{UNLOCKED};
+  spin_lock_detail::StatsRecorder<TIME_HOLDS> stats_;
+};
+
+// A ticket lock: threads acquire it in the order in which they called lock(),
+// which bounds waiting times when many (32+) threads contend for it, at the
+// cost of a hand-over to a specific, possibly descheduled, thread. Waiters
+// back off in proportion to their distance from the head of the queue and
+// yield, rather than park, once their spin budget runs out. Avoid it when
+// there are more threads than cores: every hand-over may then wait for the
+// next ticket's owner to be scheduled.
+template<bool TIME_HOLDS>
+class BasicTicketSpinLock {
+ public:
+  static const uint32_t SPIN_BUDGET = 64;
+  static const uint32_t BACKOFF_PER_WAITER = 16;
+
+  BasicTicketSpinLock() = default;
+
+  BasicTicketSpinLock(const BasicTicketSpinLock&) = delete;
+  BasicTicketSpinLock(BasicTicketSpinLock&&) = delete;
+
+  BasicTicketSpinLock& operator=(const BasicTicketSpinLock&) = delete;
+  BasicTicketSpinLock& operator=(BasicTicketSpinLock&&) = delete;
+
+  void lock() {
+    const auto ticket = next_ticket_.fetch_add(1, std::memory_order_relaxed);
+    if (now_serving_.load(std::memory_order_acquire) != ticket) {
+      lock_contended(ticket);
+    }
+    stats_.record_acquired();
+  }
+
+  bool try_lock() {
+    auto ticket = now_serving_.load(std::memory_order_acquire);
+    if (next_ticket_.compare_exchange_strong(ticket, ticket + 1,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+      stats_.record_acquired();
+      return true;
+    }
+    return false;
+  }
+
+  void unlock() {
+    stats_.record_released();
+    now_serving_.store(now_serving_.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_release);
+  }
+
+  SpinLockStats stats() const { return stats_.stats(); }
+
+ private:
+  void lock_contended(uint32_t ticket) {
+    const auto waiting_since = Clock::now();
+    bool yielded = false;
+    uint32_t num_spins = 0;
+    uint32_t serving;
+    while ((serving = now_serving_.load(std::memory_order_acquire)) != ticket) {
+      if (num_spins < SPIN_BUDGET) {
+        const uint32_t backoff = (ticket - serving) * BACKOFF_PER_WAITER;
+        for (uint32_t i_pause = 0; i_pause < backoff; ++i_pause) cpu_relax();
+        ++num_spins;
+      } else {
+        std::this_thread::yield();
+        yielded = true;
+      }
+    }
+    stats_.record_contended(waiting_since, yielded);
+  }
+
+  alignas(64) std::atomic<uint32_t> next_ticket_{0};
+  alignas(64) std::atomic<uint32_t> now_serving_{0};
+  spin_lock_detail::StatsRecorder<TIME_HOLDS> stats_;
+};
+
+using SpinLock = BasicSpinLock<false>;
+using TimedSpinLock = BasicSpinLock<true>;
+using TicketSpinLock = BasicTicketSpinLock<false>;
+using TimedTicketSpinLock = BasicTicketSpinLock<true>;
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_SPIN_LOCK_HPP_
@@ -0,0 +1,33 @@
+#include "spin_lock.hpp"
+
+#include <cstdint>
+#include <mutex>
+
+#include <benchmark/benchmark.h>
+
+namespace sparks {
+namespace {
+
+// Every thread repeatedly takes the same lock around a short critical
+// section, like workers around Executor::tasks_mutex_.
+template<typename Lock>
+void BM_LockContended(benchmark::State& state) {
+  static Lock lock;
+  static int64_t shared_counter = 0;
+  for (auto _ : state) {
+    std::lock_guard<Lock> guard{lock};
+    for (int i = 0; i < 16; ++i) benchmark::DoNotOptimize(++shared_counter);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_LockContended, SpinLock)->ThreadRange(1, 32)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LockContended, TimedSpinLock)->ThreadRange(1, 32)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LockContended, TicketSpinLock)->ThreadRange(1, 32)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LockContended, std::mutex)->ThreadRange(1, 32)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,177 @@
+#include "spin_lock.hpp"
+#include "executor_test_util.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+void sleep_ms(int milliseconds) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+// Increments of an unprotected counter under the lock are never lost, and
+// no two threads ever hold it at once.
+template <typename Lock>
+void check_mutual_exclusion() {
+  const int NUM_THREADS = 8;
+  const int NUM_INCREMENTS = 20000;
+  Lock lock;
+  uint64_t counter = 0;
+  std::atomic<int> num_holders{0};
+  std::atomic<int> num_overlaps{0};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < NUM_THREADS; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < NUM_INCREMENTS; ++j) {
+        std::lock_guard<Lock> guard{lock};
+        if (num_holders.fetch_add(1) != 0) ++num_overlaps;
+        ++counter;
+        num_holders.fetch_sub(1);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_EQ(uint64_t{NUM_THREADS * NUM_INCREMENTS}, counter);
+  EXPECT_EQ(0, num_overlaps.load());
+  const SpinLockStats stats = lock.stats();
+  EXPECT_EQ(uint64_t{NUM_THREADS * NUM_INCREMENTS}, stats.acquisitions);
+  EXPECT_LE(stats.contended, stats.acquisitions);
+  EXPECT_LE(stats.parked, stats.contended);
+}
+
+// try_lock() fails while the lock is held, and only successes count as
+// acquisitions.
+template <typename Lock>
+void check_try_lock() {
+  Lock lock;
+  ASSERT_TRUE(lock.try_lock());
+  std::thread other{[&lock] { EXPECT_FALSE(lock.try_lock()); }};
+  other.join();
+  lock.unlock();
+  std::thread again{[&lock] {
+    EXPECT_TRUE(lock.try_lock());
+    lock.unlock();
+  }};
+  again.join();
+  EXPECT_EQ(2u, lock.stats().acquisitions);
+  EXPECT_EQ(0u, lock.stats().contended);
+}
+
+TEST(SpinLockTest, MutualExclusion) {
+  check_mutual_exclusion<SpinLock>();
+  check_mutual_exclusion<TimedSpinLock>();
+  check_mutual_exclusion<TicketSpinLock>();
+  check_mutual_exclusion<TimedTicketSpinLock>();
+}
+
+TEST(SpinLockTest, TryLock) {
+  check_try_lock<SpinLock>();
+  check_try_lock<TimedSpinLock>();
+  check_try_lock<TicketSpinLock>();
+  check_try_lock<TimedTicketSpinLock>();
+}
+
+// Waiters which run out of spins while the lock is held park on the futex;
+// every unlock() wakes the next, so all of them get the lock.
+TEST(SpinLockTest, ParkedWaitersAreWoken) {
+  const int NUM_WAITERS = 4;
+  SpinLock lock;
+  std::atomic<int> num_started{0};
+  std::atomic<int> num_acquired{0};
+
+  lock.lock();
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < NUM_WAITERS; ++i) {
+    waiters.emplace_back([&] {
+      ++num_started;
+      std::lock_guard<SpinLock> guard{lock};
+      ++num_acquired;
+    });
+  }
+  ASSERT_TRUE(wait_until([&] { return num_started == NUM_WAITERS; }));
+
+  // Far beyond the spin budget.
+  sleep_ms(50);
+  EXPECT_EQ(0, num_acquired.load());
+  lock.unlock();
+  EXPECT_TRUE(wait_until([&] { return num_acquired == NUM_WAITERS; }));
+  for (auto& waiter : waiters) waiter.join();
+
+  const SpinLockStats stats = lock.stats();
+  EXPECT_EQ(uint64_t{NUM_WAITERS + 1}, stats.acquisitions);
+  EXPECT_EQ(uint64_t{NUM_WAITERS}, stats.contended);
+  EXPECT_EQ(uint64_t{NUM_WAITERS}, stats.parked);
+  // Each waited at least the 50ms the lock was held after it started.
+  const Clock::Ticks min_wait =
+      NUM_WAITERS * 50 * Clock::TICKS_PER_SECOND / 1000;
+  EXPECT_GE(stats.wait_ticks, min_wait);
+}
+
+// The ticket lock is handed over in the order in which lock() was called.
+TEST(SpinLockTest, TicketLockIsFifo) {
+  const int NUM_WAITERS = 6;
+  TicketSpinLock lock;
+  std::mutex order_mutex;
+  std::vector<int> order;
+
+  lock.lock();
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < NUM_WAITERS; ++i) {
+    std::atomic<bool> started{false};
+    waiters.emplace_back([&lock, &order_mutex, &order, &started, i] {
+      started = true;
+      std::lock_guard<TicketSpinLock> guard{lock};
+      std::lock_guard<std::mutex> order_lock{order_mutex};
+      order.push_back(i);
+    });
+    ASSERT_TRUE(wait_until([&started] { return started.load(); }));
+
+    // Long enough for the waiter to draw its ticket.
+    sleep_ms(20);
+  }
+  lock.unlock();
+  for (auto& waiter : waiters) waiter.join();
+
+  std::vector<int> expected;
+  for (int i = 0; i < NUM_WAITERS; ++i) expected.push_back(i);
+  EXPECT_EQ(expected, order);
+  EXPECT_EQ(uint64_t{NUM_WAITERS}, lock.stats().contended);
+}
+
+// Hold times are only measured by the Timed* locks.
+TEST(SpinLockTest, OnlyTimedLocksMeasureHolds) {
+  SpinLock untimed;
+  TimedSpinLock timed;
+  TimedTicketSpinLock timed_ticket;
+  for (int i = 0; i < 3; ++i) {
+    std::lock_guard<SpinLock> untimed_guard{untimed};
+    std::lock_guard<TimedSpinLock> timed_guard{timed};
+    std::lock_guard<TimedTicketSpinLock> timed_ticket_guard{timed_ticket};
+    sleep_ms(2);
+  }
+
+  const Clock::Ticks min_hold = 3 * 2 * Clock::TICKS_PER_SECOND / 1000;
+  EXPECT_EQ(0u, untimed.stats().hold_ticks);
+  EXPECT_GE(timed.stats().hold_ticks, min_hold);
+  EXPECT_GE(timed_ticket.stats().hold_ticks, min_hold);
+  for (const SpinLockStats& stats :
+       {untimed.stats(), timed.stats(), timed_ticket.stats()}) {
+    EXPECT_EQ(3u, stats.acquisitions);
+    EXPECT_EQ(0u, stats.contended);
+    EXPECT_EQ(0u, stats.parked);
+    EXPECT_EQ(0u, stats.wait_ticks);
+  }
+}
+
+}  // namespace
+}  // namespace sparks
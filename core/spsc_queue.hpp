@@ -0,0 +1,118 @@
+#ifndef SPARKS_CORE_SPSC_QUEUE_HPP_
+#define SPARKS_CORE_SPSC_QUEUE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "cache_line.hpp"
+
+namespace sparks {
+
+// A bounded, lock-free queue from a single producer thread to a single
+// consumer thread, e.g. from the SDL main thread to the simulation. Each side
+// owns its index and keeps a cached copy of the other's, which it only
+// reloads when the queue looks full (or empty): in the steady state a push or
+// a pull touches no cache line written by the other side but the element's.
+template <class Element_, size_t CAPACITY_BITS, typename Size_ = uint32_t>
+class alignas(CACHE_LINE_SIZE) SpscQueue {
+ public:
+  using Element = Element_;
+  using Size = Size_;
+
+  static const Size CAPACITY{1uL << CAPACITY_BITS};
+
+  static_assert(std::is_pod<Element_>::value, "queue element type is non-POD");
+  static_assert(CAPACITY > 0, "zero capacity");
+  static_assert(static_cast<Size>(CAPACITY) == CAPACITY,
+                "capacity incompatible with Size");
+
+ private:
+  using AtomicIdx = std::atomic<Size>;
+
+  static const Size MASK = CAPACITY - 1;
+
+ public:
+  SpscQueue() : elements_{new Element[CAPACITY]} {}
+  ~SpscQueue() { delete[] elements_; }
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue(SpscQueue&&) = delete;
+
+  SpscQueue& operator=(const SpscQueue&) = delete;
+  SpscQueue& operator=(SpscQueue&&) = delete;
+
+  // Exact only when called from either side while the other is idle.
+  bool empty() const { return size() == 0; }
+  Size size() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+
+  // Producer only. Returns false if the queue is full.
+  bool push(Element new_value) {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == CAPACITY) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == CAPACITY) return false;
+    }
+    elements_[tail & MASK] = new_value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Producer only. Pushes the first values of [first, first + count) which
+  // fit, publishing them at once, and returns how many that was.
+  Size push_batch(const Element* first, Size count) {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (CAPACITY - (tail - cached_head_) < count) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+    count = std::min<Size>(count, CAPACITY - (tail - cached_head_));
+    for (Size i = 0; i < count; ++i) elements_[(tail + i) & MASK] = first[i];
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  // Consumer only. Returns false if the queue is empty.
+  bool pull(Element& to) {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) return false;
+    }
+    to = elements_[head & MASK];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Pulls up to max_count elements into to, oldest first, and
+  // returns how many it did.
+  Size pull_batch(Element* to, Size max_count) {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (cached_tail_ - head < max_count) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+    const Size count = std::min<Size>(max_count, cached_tail_ - head);
+    for (Size i = 0; i < count; ++i) to[i] = elements_[(head + i) & MASK];
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+ private:
+  Element* elements_;
+
+  // The producer's.
+  alignas(CACHE_LINE_SIZE) AtomicIdx tail_{0};
+  Size cached_head_{0};
+
+  // The consumer's.
+  alignas(CACHE_LINE_SIZE) AtomicIdx head_{0};
+  Size cached_tail_{0};
+};
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_SPSC_QUEUE_HPP_
@@ -0,0 +1,72 @@
+#include "blocking_queue.hpp"
+#include "spsc_queue.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace sparks {
+namespace {
+
+using Element = uint32_t;
+using Queue = SpscQueue<Element, 10>;
+
+// Single-threaded: push a batch of state.range(0) elements then pull them.
+void BM_SpscQueuePushPull(benchmark::State& state) {
+  Queue queue;
+  const auto batch = static_cast<Element>(state.range(0));
+  Element to = 0;
+  for (auto _ : state) {
+    for (Element i = 0; i < batch; ++i) queue.push(i);
+    for (Element i = 0; i < batch; ++i) queue.pull(to);
+    benchmark::DoNotOptimize(to);
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_SpscQueuePushPull)->RangeMultiplier(8)->Range(8, 512);
+
+// Thread 0 produces, thread 1 consumes, state.range(0) elements at a time
+// (one by one for 1, else with push_batch() and pull_batch()).
+void BM_SpscQueueThroughput(benchmark::State& state) {
+  static Queue queue;
+  const auto batch_size = static_cast<Element>(state.range(0));
+  std::vector<Element> batch(batch_size);
+  int64_t num_moved = 0;
+  if (state.thread_index() == 0) {
+    for (auto _ : state) {
+      num_moved += batch_size == 1 ? queue.push(0)
+                                   : queue.push_batch(batch.data(), batch_size);
+    }
+  } else {
+    for (auto _ : state) {
+      num_moved += batch_size == 1 ? queue.pull(batch[0])
+                                   : queue.pull_batch(batch.data(), batch_size);
+    }
+  }
+  benchmark::DoNotOptimize(batch.data());
+  state.SetItemsProcessed(num_moved);
+}
+BENCHMARK(BM_SpscQueueThroughput)
+    ->ArgName("batch")
+    ->Arg(1)->Arg(16)
+    ->Threads(2)
+    ->UseRealTime();
+
+// The same through a BlockingQueue, one element at a time: the threads park
+// whenever the other falls behind.
+void BM_BlockingSpscQueueThroughput(benchmark::State& state) {
+  static BlockingQueue<Queue> queue;
+  Element to = 0;
+  if (state.thread_index() == 0) {
+    for (auto _ : state) queue.push(0);
+  } else {
+    for (auto _ : state) queue.pull(to);
+  }
+  benchmark::DoNotOptimize(to);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BlockingSpscQueueThroughput)->Threads(2)->UseRealTime();
+
+}  // namespace
+}  // namespace sparks
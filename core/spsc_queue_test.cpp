@@ -0,0 +1,113 @@
+#include "spsc_queue.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+using Element = uint32_t;
+using SmallQueue = SpscQueue<Element, 2>;
+using LargeQueue = SpscQueue<Element, 10>;
+
+TEST(SpscQueueTest, SingleThreaded) {
+  SmallQueue small;
+  Element to;
+
+  EXPECT_TRUE(small.empty());
+  EXPECT_EQ(0, small.size());
+  EXPECT_FALSE(small.pull(to));
+
+  EXPECT_TRUE(small.push(1));
+  EXPECT_TRUE(small.push(2));
+  EXPECT_TRUE(small.push(3));
+  EXPECT_TRUE(small.push(4));
+  EXPECT_FALSE(small.push(5));
+  EXPECT_EQ(4, small.size());
+
+  EXPECT_TRUE(small.pull(to)); EXPECT_EQ(1, to);
+  EXPECT_TRUE(small.pull(to)); EXPECT_EQ(2, to);
+  EXPECT_EQ(2, small.size());
+
+  // Wraps around.
+  EXPECT_TRUE(small.push(5));
+  EXPECT_TRUE(small.push(6));
+  EXPECT_FALSE(small.push(7));
+
+  EXPECT_TRUE(small.pull(to)); EXPECT_EQ(3, to);
+  EXPECT_TRUE(small.pull(to)); EXPECT_EQ(4, to);
+  EXPECT_TRUE(small.pull(to)); EXPECT_EQ(5, to);
+  EXPECT_TRUE(small.pull(to)); EXPECT_EQ(6, to);
+  EXPECT_FALSE(small.pull(to));
+  EXPECT_TRUE(small.empty());
+}
+
+TEST(SpscQueueTest, Batches) {
+  SmallQueue small;
+  const Element values[] = {1, 2, 3, 4, 5, 6};
+  Element to[6] = {};
+
+  EXPECT_EQ(0, small.pull_batch(to, 6));
+  EXPECT_EQ(3, small.push_batch(values, 3));
+  EXPECT_EQ(1, small.push_batch(values + 3, 3));  // Only room for one.
+  EXPECT_EQ(0, small.push_batch(values + 4, 2));
+
+  EXPECT_EQ(2, small.pull_batch(to, 2));
+  EXPECT_EQ(1, to[0]);
+  EXPECT_EQ(2, to[1]);
+
+  EXPECT_EQ(2, small.push_batch(values + 4, 2));
+  EXPECT_EQ(4, small.pull_batch(to, 6));
+  EXPECT_EQ(3, to[0]);
+  EXPECT_EQ(4, to[1]);
+  EXPECT_EQ(5, to[2]);
+  EXPECT_EQ(6, to[3]);
+  EXPECT_TRUE(small.empty());
+}
+
+// The consumer must see every value exactly once and in order, whatever mix of
+// single and batched operations either side uses.
+TEST(SpscQueueTest, ProducerConsumerStress) {
+  const Element NUM_VALUES = 1 << 20;
+  const Element MAX_BATCH = 37;
+  LargeQueue queue;
+
+  std::thread producer{[&queue, NUM_VALUES, MAX_BATCH] {
+    Element batch[MAX_BATCH];
+    Element next = 0;
+    while (next < NUM_VALUES) {
+      const Element batch_size =
+          std::min(next % MAX_BATCH + 1, NUM_VALUES - next);
+      for (Element i = 0; i < batch_size; ++i) batch[i] = next + i;
+      const Element num_pushed = batch_size == 1
+                                     ? Element{queue.push(next)}
+                                     : queue.push_batch(batch, batch_size);
+      next += num_pushed;
+      if (num_pushed == 0) std::this_thread::yield();
+    }
+  }};
+
+  Element batch[MAX_BATCH];
+  Element expected = 0;
+  bool in_order = true;
+  while (expected < NUM_VALUES) {
+    const Element num_pulled =
+        expected % 2 == 0 ? Element{queue.pull(batch[0])}
+                          : queue.pull_batch(batch, expected % MAX_BATCH + 1);
+    for (Element i = 0; i < num_pulled; ++i) {
+      in_order &= batch[i] == expected++;
+    }
+    if (num_pulled == 0) std::this_thread::yield();
+  }
+  producer.join();
+
+  EXPECT_TRUE(in_order);
+  EXPECT_TRUE(queue.empty());
+}
+
+}  // namespace
+}  // namespace sparks
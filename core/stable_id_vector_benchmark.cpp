@@ -0,0 +1,56 @@
+#include "stable_id_vector.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace sparks {
+namespace {
+
+struct Element {
+  explicit Element(int64_t x) : x{x} {}
+  int64_t x;
+};
+
+using StableIdVector = BasicStableIdVector<Element, uint32_t, 20>;
+using Id = StableIdVector::Id;
+
+// Emplaces a batch of state.range(0) elements, then erases them all.
+void BM_StableIdVectorEmplaceErase(benchmark::State& state) {
+  const auto batch = static_cast<StableIdVector::size_type>(state.range(0));
+  StableIdVector vector{batch};
+  std::vector<Id> ids(batch);
+  for (auto _ : state) {
+    for (StableIdVector::size_type i = 0; i < batch; ++i) {
+      ids[i] = vector.emplace(i);
+    }
+    for (auto id : ids) vector.erase(id);
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_StableIdVectorEmplaceErase)->RangeMultiplier(8)->Range(8, 32768);
+
+// Lookups by id, hopping around the pages.
+void BM_StableIdVectorLookup(benchmark::State& state) {
+  const auto count = static_cast<StableIdVector::size_type>(state.range(0));
+  StableIdVector vector{count};
+  std::vector<Id> ids(count);
+  for (StableIdVector::size_type i = 0; i < count; ++i) {
+    ids[i] = vector.emplace(i);
+  }
+
+  int64_t sum = 0;
+  size_t i_id = 0;
+  for (auto _ : state) {
+    sum += vector[ids[i_id]].x;
+    i_id = (i_id + 7919) % count;
+  }
+  benchmark::DoNotOptimize(sum);
+  for (auto id : ids) vector.erase(id);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StableIdVectorLookup)->RangeMultiplier(8)->Range(64, 262144);
+
+}  // namespace
+}  // namespace sparks
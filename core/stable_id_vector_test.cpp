@@ -0,0 +1,151 @@
+#include "stable_id_vector.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+// Neither copyable nor movable, which only a stable vector can hold; counts
+// the live instances.
+struct Pinned {
+  explicit Pinned(int value) : value{value} { ++num_live; }
+  ~Pinned() { --num_live; }
+
+  Pinned(const Pinned&) = delete;
+  Pinned& operator=(const Pinned&) = delete;
+
+  int value;
+
+  static int num_live;
+};
+
+int Pinned::num_live = 0;
+
+// 15 entries in pages of 4.
+using SmallVector = BasicStableIdVector<Pinned, uint32_t, 4, 2>;
+using Vector = BasicStableIdVector<Pinned, uint32_t, 24, 4>;
+
+struct StableIdVectorTest : public ::testing::Test {
+  void TearDown() { EXPECT_EQ(0, Pinned::num_live); }
+};
+
+TEST_F(StableIdVectorTest, EmplaceAndErase) {
+  Vector vector{0};
+  EXPECT_TRUE(vector.empty());
+  EXPECT_EQ(0u, vector.capacity());
+
+  const auto a = vector.emplace(1);
+  const auto b = vector.emplace(2);
+  EXPECT_EQ(2u, vector.size());
+  EXPECT_EQ(16u, vector.capacity());
+  EXPECT_EQ(1, vector[a].value);
+  EXPECT_EQ(2, vector[b].value);
+
+  vector.erase(a);
+  EXPECT_FALSE(vector.is_valid_id(a));
+  EXPECT_TRUE(vector.is_valid_id(b));
+  EXPECT_EQ(1u, vector.size());
+  EXPECT_EQ(1, Pinned::num_live);
+}
+
+// The capacity grows a page at a time, and the last page is one entry short
+// since INVALID_INDEX is not a valid index.
+TEST_F(StableIdVectorTest, GrowsByPages) {
+  SmallVector vector{5};
+  EXPECT_EQ(8u, vector.capacity());
+  vector.reserve(8);
+  EXPECT_EQ(8u, vector.capacity());
+
+  std::vector<uint32_t> ids;
+  for (int i = 0; i < 15; ++i) {
+    ids.push_back(vector.emplace(i));
+    const uint32_t num_pages = std::max(i / 4 + 1, 2);
+    EXPECT_EQ(std::min(num_pages * 4, 15u), vector.capacity()) << i;
+  }
+  EXPECT_EQ(15u, vector.size());
+  EXPECT_EQ(uint32_t{SmallVector::MAX_SIZE}, vector.capacity());
+  for (int i = 0; i < 15; ++i) EXPECT_EQ(i, vector[ids[i]].value);
+}
+
+// Elements stay put as pages are added and other elements come and go.
+TEST_F(StableIdVectorTest, ElementsNeverMove) {
+  Vector vector{0};
+  std::vector<uint32_t> ids;
+  std::vector<const Pinned*> pointers;
+  for (int i = 0; i < 100; ++i) {
+    ids.push_back(vector.emplace(i));
+    pointers.push_back(&vector[ids.back()]);
+  }
+
+  for (int i = 0; i < 100; i += 2) vector.erase(ids[i]);
+  for (int i = 0; i < 1000; ++i) vector.emplace(-i);
+  EXPECT_EQ(1050u, vector.size());
+
+  for (int i = 1; i < 100; i += 2) {
+    EXPECT_EQ(pointers[i], &vector[ids[i]]);
+    EXPECT_EQ(i, vector[ids[i]].value);
+  }
+}
+
+// Erased entries are reused in the order they were erased, with a new tag, so
+// their old ids stay invalid.
+TEST_F(StableIdVectorTest, ReusedEntriesGetNewIds) {
+  SmallVector vector{4};
+  std::vector<uint32_t> ids;
+  for (int i = 0; i < 4; ++i) ids.push_back(vector.emplace(i));
+
+  vector.erase(ids[1]);
+  vector.erase(ids[3]);
+  const auto reused_1 = vector.emplace(10);
+  const auto reused_3 = vector.emplace(30);
+  EXPECT_EQ(ids[1] & SmallVector::OUTER_MASK,
+            reused_1 & SmallVector::OUTER_MASK);
+  EXPECT_EQ(ids[3] & SmallVector::OUTER_MASK,
+            reused_3 & SmallVector::OUTER_MASK);
+  EXPECT_NE(ids[1], reused_1);
+  EXPECT_FALSE(vector.is_valid_id(ids[1]));
+  EXPECT_FALSE(vector.is_valid_id(ids[3]));
+  EXPECT_EQ(10, vector[reused_1].value);
+
+  // The free list is empty again, so the next emplace adds a page.
+  EXPECT_EQ(4u, vector.capacity());
+  vector.emplace(4);
+  EXPECT_EQ(8u, vector.capacity());
+}
+
+// Random emplaces and erases against a reference map; the destructor then
+// destroys exactly the remaining elements (see TearDown()).
+TEST_F(StableIdVectorTest, RandomOperationsMatchReference) {
+  Vector vector{0};
+  std::map<uint32_t, int> reference;
+  std::vector<uint32_t> erased;
+  std::mt19937 random{8};
+  for (int i = 0; i < 5000; ++i) {
+    if (reference.empty() || random() % 3 != 0) {
+      EXPECT_TRUE(reference.emplace(vector.emplace(i), i).second);
+    } else {
+      auto erased_entry = reference.begin();
+      std::advance(erased_entry, random() % reference.size());
+      vector.erase(erased_entry->first);
+      erased.push_back(erased_entry->first);
+      reference.erase(erased_entry);
+    }
+  }
+
+  ASSERT_EQ(reference.size(), size_t{vector.size()});
+  EXPECT_EQ(int(reference.size()), Pinned::num_live);
+  for (const auto& id_and_value : reference) {
+    ASSERT_TRUE(vector.is_valid_id(id_and_value.first));
+    EXPECT_EQ(id_and_value.second, vector[id_and_value.first].value);
+  }
+  for (auto id : erased) EXPECT_FALSE(vector.is_valid_id(id));
+}
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,273 @@
+#ifndef SPARKS_CORE_TASK_GRAPH_HPP_
+#define SPARKS_CORE_TASK_GRAPH_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "executor.hpp"
+
+namespace sparks {
+
+// A recorded task graph which can be submitted to an Executor any number of
+// times, e.g. once per frame. Recording first allows optimize() to rewrite
+// the graph into fewer Executor tasks with identical semantics:
+//
+//  * Empty nodes used as join points (add_join()) are elided: their
+//    successors depend on their predecessors directly, unless that would take
+//    many more dependency edges than the join task costs.
+//  * Linear chains, where a node is the only successor of its only
+//    predecessor, are fused into a single task which runs their closures in
+//    order.
+//
+// Nodes can only depend on nodes recorded before them. The graph must not be
+// modified (or destroyed) while tasks submitted from it may still run.
+class TaskGraph {
+ public:
+  using NodeId = uint32_t;
+  using TaskId = Executor::TaskId;
+  using ThreadId = Executor::ThreadId;
+
+  // An elided join of p predecessors and s successors replaces p + s edges and
+  // a task with p * s edges; it is elided if p * s <= p + s + this.
+  static const size_t JOIN_TASK_COST_IN_EDGES = 4;
+
+  TaskGraph() = default;
+
+  TaskGraph(const TaskGraph&) = delete;
+  TaskGraph& operator=(const TaskGraph&) = delete;
+
+  template <typename ClosureType,
+            typename NodeIdRange = ::std::initializer_list<NodeId>>
+  NodeId add_node(ClosureType&& closure, const NodeIdRange& depends_on = {},
+                  ThreadId affinity = Executor::NO_AFFINITY) {
+    return add_node_impl(std::forward<ClosureType>(closure),
+                         depends_on.begin(), depends_on.end(), affinity,
+                         false);
+  }
+
+  // A node without work, which completes once all of depends_on have.
+  template <typename NodeIdRange = ::std::initializer_list<NodeId>>
+  NodeId add_join(const NodeIdRange& depends_on) {
+    return add_node_impl(std::function<void()>{}, depends_on.begin(),
+                         depends_on.end(), Executor::NO_AFFINITY, false);
+  }
+
+  // A node submitted with Executor::add_epoch_task(); never fused.
+  template <typename ClosureType,
+            typename NodeIdRange = ::std::initializer_list<NodeId>>
+  NodeId add_epoch_node(ClosureType&& closure,
+                        const NodeIdRange& depends_on = {},
+                        ThreadId affinity = Executor::NO_AFFINITY) {
+    return add_node_impl(std::forward<ClosureType>(closure),
+                         depends_on.begin(), depends_on.end(), affinity,
+                         true);
+  }
+
+  // Fuses chains and elides joins in every later submit().
+  void optimize() {
+    optimize_ = true;
+    plan_valid_ = false;
+  }
+
+  // Adds the graph's tasks to executor. Nodes without dependencies in the
+  // graph additionally depend on the tasks in depends_on.
+  template <typename TaskIdRange = ::std::initializer_list<TaskId>>
+  void submit(Executor& executor, const TaskIdRange& depends_on = {});
+
+  size_t num_nodes() const { return nodes_.size(); }
+
+  // The number of tasks and dependency edges which submit() adds.
+  size_t num_tasks() {
+    build_plan();
+    return plan_.size();
+  }
+  size_t num_dependencies() {
+    build_plan();
+    size_t num_edges = 0;
+    for (const auto& task : plan_) num_edges += task.depends_on.size();
+    return num_edges;
+  }
+
+ private:
+  struct Node {
+    std::function<void()> closure;
+    std::vector<NodeId> depends_on;
+    ThreadId affinity;
+    bool ends_epoch;
+  };
+
+  // A task of the submitted graph: a chain of nodes.
+  struct PlannedTask {
+    std::vector<NodeId> chain;
+
+    // Indices in plan_, all smaller than this task's.
+    std::vector<uint32_t> depends_on;
+
+    ThreadId affinity;
+    bool ends_epoch;
+  };
+
+  template <typename ClosureType, typename NodeIdIter>
+  NodeId add_node_impl(ClosureType&& closure, NodeIdIter depends_begin,
+                       NodeIdIter depends_end, ThreadId affinity,
+                       bool ends_epoch);
+
+  inline void build_plan();
+
+  void run_task(uint32_t i_task) const {
+    for (NodeId node_id : plan_[i_task].chain) {
+      const auto& closure = nodes_[node_id].closure;
+      if (closure) closure();
+    }
+  }
+
+  static void remove(std::vector<NodeId>& ids, NodeId id) {
+    ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+  }
+
+  static void append_unique(std::vector<NodeId>& ids,
+                            const std::vector<NodeId>& more) {
+    for (NodeId id : more) {
+      if (std::find(ids.begin(), ids.end(), id) == ids.end()) {
+        ids.push_back(id);
+      }
+    }
+  }
+
+  std::vector<Node> nodes_;
+  std::vector<PlannedTask> plan_;
+  bool optimize_{false};
+  bool plan_valid_{false};
+
+  // Scratch space for submit().
+  std::vector<TaskId> task_ids_;
+  std::vector<TaskId> dependency_ids_;
+};
+
+template <typename ClosureType, typename NodeIdIter>
+TaskGraph::NodeId TaskGraph::add_node_impl(ClosureType&& closure,
+                                           NodeIdIter depends_begin,
+                                           NodeIdIter depends_end,
+                                           ThreadId affinity,
+                                           bool ends_epoch) {
+  const auto node_id = static_cast<NodeId>(nodes_.size());
+  Node node{std::function<void()>{std::forward<ClosureType>(closure)}, {},
+            affinity, ends_epoch};
+  for (; depends_begin != depends_end; ++depends_begin) {
+    DCHECK_LT(*depends_begin, node_id) << "Depending on a later node.";
+    append_unique(node.depends_on, {*depends_begin});
+  }
+  nodes_.push_back(std::move(node));
+  plan_valid_ = false;
+  return node_id;
+}
+
+void TaskGraph::build_plan() {
+  if (plan_valid_) return;
+  plan_valid_ = true;
+  plan_.clear();
+
+  const auto num_nodes = static_cast<NodeId>(nodes_.size());
+  std::vector<std::vector<NodeId>> predecessors(num_nodes);
+  std::vector<std::vector<NodeId>> successors(num_nodes);
+  for (NodeId i_node = 0; i_node < num_nodes; ++i_node) {
+    predecessors[i_node] = nodes_[i_node].depends_on;
+    for (NodeId dependency : predecessors[i_node]) {
+      successors[dependency].push_back(i_node);
+    }
+  }
+
+  std::vector<bool> elided(num_nodes, false);
+  if (optimize_) {
+    for (NodeId join = 0; join < num_nodes; ++join) {
+      const Node& node = nodes_[join];
+      if (node.closure || node.ends_epoch) continue;
+      const auto& before = predecessors[join];
+      const auto& after = successors[join];
+      if (before.size() * after.size() >
+          before.size() + after.size() + JOIN_TASK_COST_IN_EDGES) {
+        continue;
+      }
+
+      for (NodeId successor : after) {
+        remove(predecessors[successor], join);
+        append_unique(predecessors[successor], before);
+      }
+      for (NodeId predecessor : before) {
+        remove(successors[predecessor], join);
+        append_unique(successors[predecessor], after);
+      }
+      elided[join] = true;
+    }
+  }
+
+  // Nodes are in topological order, so every chain head comes before the
+  // rest of its chain and every task after the tasks it depends on.
+  std::vector<uint32_t> task_of(num_nodes);
+  for (NodeId i_node = 0; i_node < num_nodes; ++i_node) {
+    if (elided[i_node]) continue;
+
+    const auto& before = predecessors[i_node];
+    if (optimize_ && before.size() == 1) {
+      const NodeId previous = before.front();
+      const auto& previous_task = plan_[task_of[previous]];
+      if (successors[previous].size() == 1 &&
+          previous_task.chain.back() == previous &&
+          !nodes_[previous].ends_epoch && !nodes_[i_node].ends_epoch &&
+          nodes_[previous].affinity == nodes_[i_node].affinity) {
+        task_of[i_node] = task_of[previous];
+        plan_[task_of[i_node]].chain.push_back(i_node);
+        continue;
+      }
+    }
+
+    task_of[i_node] = static_cast<uint32_t>(plan_.size());
+    plan_.push_back(PlannedTask{{i_node}, {}, nodes_[i_node].affinity,
+                                nodes_[i_node].ends_epoch});
+    auto& task = plan_.back();
+    for (NodeId predecessor : before) {
+      const auto dependency = task_of[predecessor];
+      if (std::find(task.depends_on.begin(), task.depends_on.end(),
+                    dependency) == task.depends_on.end()) {
+        task.depends_on.push_back(dependency);
+      }
+    }
+  }
+}
+
+template <typename TaskIdRange>
+void TaskGraph::submit(Executor& executor, const TaskIdRange& depends_on) {
+  build_plan();
+
+  task_ids_.resize(plan_.size());
+  for (uint32_t i_task = 0; i_task < plan_.size(); ++i_task) {
+    const auto& task = plan_[i_task];
+    dependency_ids_.clear();
+    if (task.depends_on.empty()) {
+      dependency_ids_.insert(dependency_ids_.end(), depends_on.begin(),
+                             depends_on.end());
+    }
+    for (uint32_t dependency : task.depends_on) {
+      dependency_ids_.push_back(task_ids_[dependency]);
+    }
+
+    const TaskGraph* graph = this;
+    const auto run = [graph, i_task] { graph->run_task(i_task); };
+    task_ids_[i_task] =
+        task.ends_epoch
+            ? executor.add_epoch_task(run, dependency_ids_.begin(),
+                                      dependency_ids_.end(), task.affinity)
+            : executor.add_task(run, dependency_ids_.begin(),
+                                dependency_ids_.end(), task.affinity);
+  }
+}
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_TASK_GRAPH_HPP_
@@ -0,0 +1,196 @@
+#include "task_graph.hpp"
+#include "executor_test_util.hpp"
+
+#include <atomic>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+using NodeId = TaskGraph::NodeId;
+
+// Submits the graph to a fresh Executor with num_threads workers and waits
+// for it to complete.
+void run(TaskGraph& graph, int num_threads) {
+  Executor executor;
+  ExecutorThreads threads{executor, num_threads};
+  graph.submit(executor);
+  ASSERT_TRUE(wait_until_idle(executor));
+}
+
+TEST(TaskGraphTest, ChainsAreFused) {
+  TaskLog log;
+  TaskGraph graph;
+  NodeId previous = graph.add_node(Logged{&log, 0});
+  for (int i = 1; i < 10; ++i) {
+    previous = graph.add_node(Logged{&log, i}, {previous});
+  }
+  EXPECT_EQ(10u, graph.num_tasks());
+  EXPECT_EQ(9u, graph.num_dependencies());
+
+  graph.optimize();
+  EXPECT_EQ(1u, graph.num_tasks());
+  EXPECT_EQ(0u, graph.num_dependencies());
+  run(graph, 2);
+  for (int i = 1; i < 10; ++i) EXPECT_TRUE(log.ended_before(i - 1, i));
+}
+
+// Only a node's single successor joins its chain, and epoch nodes and nodes
+// with another affinity start a new task.
+TEST(TaskGraphTest, OnlyTrueChainsAreFused) {
+  TaskLog log;
+  TaskGraph graph;
+  const NodeId root = graph.add_node(Logged{&log, 0});
+  const NodeId left = graph.add_node(Rendezvous{&log, 1, 2}, {root});
+  graph.add_node(Rendezvous{&log, 2, 1}, {root});
+  const NodeId epoch = graph.add_epoch_node(Logged{&log, 3}, {left});
+  const NodeId after_epoch = graph.add_node(Logged{&log, 4}, {epoch});
+  graph.add_node([] {}, {after_epoch}, 0);
+  graph.optimize();
+  EXPECT_EQ(6u, graph.num_tasks());
+
+  // Without the pinned node, which would need a worker with affinity 0.
+  TaskGraph runnable;
+  const NodeId runnable_root = runnable.add_node(Logged{&log, 10});
+  runnable.add_node(Rendezvous{&log, 11, 12}, {runnable_root});
+  runnable.add_node(Rendezvous{&log, 12, 11}, {runnable_root});
+  runnable.optimize();
+  EXPECT_EQ(3u, runnable.num_tasks());
+  run(runnable, 2);
+  EXPECT_TRUE(overlapped(log, 11, 12));
+}
+
+TEST(TaskGraphTest, SmallJoinsAreElided) {
+  TaskLog log;
+  TaskGraph graph;
+  const NodeId join =
+      graph.add_join({graph.add_node(Logged{&log, 0}),
+                      graph.add_node(Logged{&log, 1})});
+  graph.add_node(Rendezvous{&log, 2, 3}, {join});
+  graph.add_node(Rendezvous{&log, 3, 2}, {join});
+  EXPECT_EQ(5u, graph.num_tasks());
+  EXPECT_EQ(4u, graph.num_dependencies());
+
+  graph.optimize();
+  EXPECT_EQ(4u, graph.num_tasks());
+  EXPECT_EQ(4u, graph.num_dependencies());
+  run(graph, 2);
+  for (int i : {0, 1}) {
+    for (int j : {2, 3}) EXPECT_TRUE(log.ended_before(i, j));
+  }
+  EXPECT_TRUE(overlapped(log, 2, 3));
+}
+
+// Eliding a join of 5 x 5 nodes would take 25 edges instead of 10.
+TEST(TaskGraphTest, LargeJoinsAreKept) {
+  TaskGraph graph;
+  std::vector<NodeId> before;
+  for (int i = 0; i < 5; ++i) before.push_back(graph.add_node([] {}));
+  const NodeId join = graph.add_join(before);
+  for (int i = 0; i < 5; ++i) graph.add_node([] {}, {join});
+  graph.optimize();
+  EXPECT_EQ(11u, graph.num_tasks());
+  EXPECT_EQ(10u, graph.num_dependencies());
+}
+
+// Nodes which lose their only dependency to an elided join still wait for
+// submit()'s depends_on.
+TEST(TaskGraphTest, ElidedRootJoinKeepsExternalDependencies) {
+  TaskLog log;
+  TaskGraph graph;
+  const NodeId join = graph.add_join(std::vector<NodeId>{});
+  graph.add_node(Logged{&log, 1}, {join});
+  graph.add_node(Logged{&log, 2}, {join});
+  graph.optimize();
+  EXPECT_EQ(2u, graph.num_tasks());
+
+  Executor executor;
+  ExecutorThreads threads{executor, 2};
+  std::atomic<bool> release{false};
+  std::atomic<bool>* const release_ptr = &release;
+  TaskLog* const log_ptr = &log;
+  const auto blocker = executor.add_task([release_ptr, log_ptr] {
+    wait_until([release_ptr] { return release_ptr->load(); });
+    log_ptr->start(0);
+    log_ptr->end(0);
+  });
+  graph.submit(executor, {blocker});
+  release = true;
+  ASSERT_TRUE(wait_until_idle(executor));
+  EXPECT_TRUE(log.ended_before(0, 1));
+  EXPECT_TRUE(log.ended_before(0, 2));
+}
+
+// Random graphs run every node, in the order of the recorded graph, with and
+// without optimize().
+TEST(TaskGraphTest, RandomGraphsKeepTheirOrder) {
+  const int NUM_NODES = 40;
+  std::mt19937 random{11};
+  for (int round = 0; round < 20; ++round) {
+    for (bool optimized : {false, true}) {
+      TaskLog log;
+      TaskGraph graph;
+      std::vector<std::vector<bool>> precedes(
+          NUM_NODES, std::vector<bool>(NUM_NODES, false));
+      std::vector<bool> is_join(NUM_NODES);
+      std::mt19937 graph_random{static_cast<uint32_t>(round)};
+      for (int i = 0; i < NUM_NODES; ++i) {
+        std::vector<NodeId> depends_on;
+        const int num_dependencies = i == 0 ? 0 : graph_random() % 4;
+        for (int j = 0; j < num_dependencies; ++j) {
+          const auto dependency = static_cast<NodeId>(graph_random() % i);
+          depends_on.push_back(dependency);
+          for (int k = 0; k < NUM_NODES; ++k) {
+            if (precedes[k][dependency]) precedes[k][i] = true;
+          }
+          precedes[dependency][i] = true;
+        }
+        is_join[i] = graph_random() % 4 == 0;
+        if (is_join[i]) {
+          graph.add_join(depends_on);
+        } else {
+          graph.add_node(Logged{&log, i}, depends_on);
+        }
+      }
+      if (optimized) graph.optimize();
+
+      run(graph, 1 + random() % 3);
+      for (int a = 0; a < NUM_NODES; ++a) {
+        if (is_join[a]) continue;
+        ASSERT_TRUE(log.started(a)) << a;
+        for (int b = 0; b < NUM_NODES; ++b) {
+          if (!is_join[b] && precedes[a][b]) {
+            EXPECT_TRUE(log.ended_before(a, b)) << a << " -> " << b;
+          }
+        }
+      }
+    }
+  }
+}
+
+// A graph can be submitted again once (or even before) its previous
+// submission has completed.
+TEST(TaskGraphTest, SubmitRepeatedly) {
+  std::atomic<int> num_runs{0};
+  std::atomic<int>* const num_runs_ptr = &num_runs;
+  TaskGraph graph;
+  NodeId previous = graph.add_node([num_runs_ptr] { ++*num_runs_ptr; });
+  for (int i = 1; i < 5; ++i) {
+    const NodeId join = graph.add_join({previous});
+    previous = graph.add_node([num_runs_ptr] { ++*num_runs_ptr; }, {join});
+  }
+  graph.optimize();
+  EXPECT_EQ(1u, graph.num_tasks());
+
+  Executor executor;
+  ExecutorThreads threads{executor, 2};
+  for (int i = 0; i < 10; ++i) graph.submit(executor);
+  ASSERT_TRUE(wait_until_idle(executor));
+  EXPECT_EQ(50, num_runs.load());
+}
+
+}  // namespace
+}  // namespace sparks
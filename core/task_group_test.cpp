@@ -0,0 +1,81 @@
+#include "scheduler.hpp"
+
+#include <atomic>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+const size_t NUM_NODES = 4;
+
+TEST(TaskGroupTest, ContinuationRunsAfterAllChildren) {
+  const int NUM_CHILDREN = 1000;
+  std::atomic<int> num_finished{0};
+  int finished_before_continuation = -1;
+
+  Scheduler scheduler{NUM_NODES};
+  scheduler.run([&](SchedulerNode& node) {
+    TaskGroup& group = node.new_group();
+    std::atomic<int>* finished = &num_finished;
+    for (int i = 0; i < NUM_CHILDREN; ++i) {
+      group.spawn(node, [finished](SchedulerNode&) { ++*finished; });
+    }
+    int* seen = &finished_before_continuation;
+    group.then(node, [finished, seen](SchedulerNode& node) {
+      *seen = finished->load();
+      node.stop_scheduler();
+    });
+  });
+
+  EXPECT_EQ(NUM_CHILDREN, finished_before_continuation);
+}
+
+// Every child waits for a nested group of its own by holding the parent
+// group until the nested group's continuation releases it.
+struct Tree {
+  std::atomic<int> num_leaves{0};
+  std::atomic<int> num_subtrees{0};
+  int leaves_before_root = -1;
+  int subtrees_before_root = -1;
+};
+
+const int TREE_FANOUT = 32;
+
+void subtree(Tree* tree, TaskGroup* parent, SchedulerNode& node) {
+  parent->hold();
+  TaskGroup& group = node.new_group();
+  for (int i = 0; i < TREE_FANOUT; ++i) {
+    group.spawn(node, [tree](SchedulerNode&) { ++tree->num_leaves; });
+  }
+  group.then(node, [tree, parent](SchedulerNode& node) {
+    ++tree->num_subtrees;
+    parent->release(node);
+  });
+}
+
+TEST(TaskGroupTest, NestedGroups) {
+  Tree tree;
+
+  Scheduler scheduler{NUM_NODES};
+  scheduler.run([&tree](SchedulerNode& node) {
+    Tree* t = &tree;
+    TaskGroup& root = node.new_group();
+    TaskGroup* r = &root;
+    for (int i = 0; i < TREE_FANOUT; ++i) {
+      root.spawn(node, [t, r](SchedulerNode& node) { subtree(t, r, node); });
+    }
+    root.then(node, [t](SchedulerNode& node) {
+      t->leaves_before_root = t->num_leaves.load();
+      t->subtrees_before_root = t->num_subtrees.load();
+      node.stop_scheduler();
+    });
+  });
+
+  EXPECT_EQ(TREE_FANOUT * TREE_FANOUT, tree.leaves_before_root);
+  EXPECT_EQ(TREE_FANOUT, tree.subtrees_before_root);
+}
+
+}  // namespace
+}  // namespace sparks
@@ -3,31 +3,53 @@
 #include <vector>
 
 #include <glog/logging.h>
-#include <SDL2/SDL.h>
 
+#include "clock.hpp"
+#include "cpu_topology.hpp"
 #include "executor.hpp"
+#include "resource_tracker.hpp"
 
 #define SLOG if (false) LOG(INFO)
 
 uint32_t frame_counter = 0;
 uint32_t total_frames = 0;
 uint64_t last_frame_reset = 0;
-double perf_freq = 0;
 uint32_t silly_counter = 0;
 
-void new_frame(sparks::Executor& executor) {
-  using sparks::Executor;
-  using TaskId = sparks::Executor::TaskId;
+// The shared state of a frame. Tasks declare which of these they read and
+// write and the ResourceTracker derives the frame graph from that.
+struct FrameResources {
+  using ResourceId = sparks::ResourceTracker::ResourceId;
+
+  explicit FrameResources(sparks::ResourceTracker& tracker)
+      : time{tracker.new_resource()}, scene{tracker.new_resource()},
+        poses{tracker.new_resource()}, ai{tracker.new_resource()},
+        input{tracker.new_resource()}, game{tracker.new_resource()},
+        audio{tracker.new_resource()}, gui{tracker.new_resource()},
+        draw_list{tracker.new_resource()},
+        targets{tracker.new_resource(), tracker.new_resource(),
+                tracker.new_resource(), tracker.new_resource()},
+        frame_buffer{tracker.new_resource()} {}
+
+  ResourceId time, scene, poses, ai, input, game, audio, gui, draw_list;
+  ResourceId targets[4];
+  ResourceId frame_buffer;
+};
+
+void new_frame(sparks::ResourceTracker& tracker,
+               const FrameResources& resources) {
   uint32_t* ptr = &silly_counter;
+  const FrameResources& r = resources;
 
-  TaskId frame_start = executor.add_task(
+  tracker.add_task(
       [=] {
         SLOG << "frame_start";
         (*ptr) += 1;
-      }, {}, Executor::NO_AFFINITY);
+      }, {}, {r.time});
 
-  auto new_time = SDL_GetPerformanceCounter();
-  double time_since_reset = (new_time - last_frame_reset) / perf_freq;
+  auto new_time = sparks::Clock::now();
+  double time_since_reset =
+      sparks::Clock::to_seconds(new_time - last_frame_reset);
 
   ++frame_counter;
   if (time_since_reset >= 2.0) {
@@ -37,101 +59,95 @@ void new_frame(sparks::Executor& executor) {
     total_frames += frame_counter;
     frame_counter = 0;
 
-    if (total_frames >= 5000000) executor.close();
+    if (total_frames >= 5000000) tracker.executor().close();
   }
 
-  TaskId scene = executor.add_task(
+  tracker.add_task(
       [=] {
         SLOG << "scene";
         for (int i = 0; i < 1000; ++i) *ptr += i * (*ptr);
-      }, {frame_start}, Executor::NO_AFFINITY);
+      }, {r.time}, {r.scene});
 
-  TaskId anim = executor.add_task(
+  tracker.add_task(
       [=] {
         SLOG << "anim";
         for (int i = 0; i < 1000; ++i) (*ptr) += i * (*ptr);
-      }, {scene}, Executor::NO_AFFINITY);
+      }, {r.scene}, {r.poses});
 
-  TaskId ai = executor.add_task(
+  tracker.add_task(
       [=] {
         SLOG << "ai";
         for (int i = 0; i < 1000; ++i) (*ptr) += i * (*ptr);
-      }, {frame_start}, Executor::NO_AFFINITY);
+      }, {r.time}, {r.ai});
 
-  TaskId ctrl = executor.add_task(
+  tracker.add_task(
       [=] {
         SLOG << "ctrl";
         for (int i = 0; i < 1000; ++i) (*ptr) += i * (*ptr);
-      }, {frame_start});
+      }, {r.time}, {r.input});
 
-  TaskId gameplay = executor.add_task(
+  tracker.add_task(
       [=] {
         SLOG << "game";
         for (int i = 0; i < 1000; ++i) (*ptr) += i * (*ptr);
-      }, {scene, anim, ai, ctrl});
+      }, {r.scene, r.poses, r.ai, r.input}, {r.game});
 
-  TaskId audio = executor.add_task(
+  tracker.add_task(
       [=] {
         SLOG << "audio";
         for (int i = 0; i < 1000; ++i) (*ptr) += i * (*ptr);
-      }, {gameplay});
+      }, {r.game}, {r.audio});
 
-  TaskId gui = executor.add_task(
+  tracker.add_task(
       [=] {
         SLOG << "gui";
         for (int i = 0; i < 1000; ++i) (*ptr) += i * (*ptr);
-      }, {frame_start}, Executor::NO_AFFINITY);
+      }, {r.time}, {r.gui});
 
-  TaskId render_start = executor.add_task(
+  tracker.add_task(
       [=] { ++silly_counter; },
-      {scene, anim, gui, gameplay}, Executor::NO_AFFINITY);
+      {r.scene, r.poses, r.gui, r.game}, {r.draw_list});
 
-  TaskId render_end = executor.add_task(
+  for (int i_target = 0; i_target < 4; ++i_target) {
+    tracker.add_task([=] {
+      SLOG << "render" << i_target;
+      for (int i = 0; i < 1000; ++i) (*ptr) += i * (*ptr);
+    }, {r.draw_list}, {r.targets[i_target]});
+  }
+
+  tracker.add_task(
       [=] { (*ptr) += 1; },
-      {
-        executor.add_task([=] {
-          SLOG << "render1";
-          for (int i = 0; i < 1000; ++i) (*ptr) += i * (*ptr);
-        }, {render_start}),
-
-        executor.add_task([=] {
-          SLOG << "render2";
-          for (int i = 0; i < 1000; ++i) (*ptr) += i * (*ptr);
-        }, {render_start}),
-
-        executor.add_task([=] {
-          SLOG << "render3";
-          for (int i = 0; i < 1000; ++i) (*ptr) += i * (*ptr);
-        }, {render_start}),
-
-        executor.add_task([=] {
-          SLOG << "render4";
-          for (int i = 0; i < 1000; ++i) (*ptr) += i * (*ptr);
-        }, {render_start}),
-      });
-
-  executor.add_task([&]{
+      {r.targets[0], r.targets[1], r.targets[2], r.targets[3]},
+      {r.frame_buffer});
+
+  tracker.add_epoch_task([&] {
       SLOG << "frame_end";
       ++silly_counter;
-      new_frame(executor); },
-      {frame_start, scene, anim, ai, ctrl, gameplay, audio, gui,
-       render_start, render_end});
+      new_frame(tracker, resources); });
 }
 
 int main() {
   google::InitGoogleLogging("sparks");
   google::LogToStderr();
-  perf_freq = static_cast<double>(SDL_GetPerformanceFrequency());
 
   sparks::Executor executor;
-  last_frame_reset = SDL_GetPerformanceCounter();
-  //new_frame(executor);
+  sparks::ResourceTracker tracker{executor};
+  const FrameResources resources{tracker};
+  last_frame_reset = sparks::Clock::now();
+  //new_frame(tracker, resources);
+  const auto placement = sparks::CpuTopology::detect().place_workers(4);
   std::vector<std::thread> threads;
   threads.reserve(4);
   for (int i = 0; i < 3; ++i) {
-    threads.emplace_back([&executor, i] { executor.run_tasks_no_affinity(); });
+    threads.emplace_back([&executor, &placement, i] {
+      sparks::apply_placement(placement[i + 1]);
+      executor.run_tasks_no_affinity();
+    });
+  }
+  {
+    sparks::ScopedPlacement main_placement{placement[0]};
+    executor.run_tasks_no_affinity();
   }
-  executor.run_tasks_no_affinity();
 
   LOG(INFO) << silly_counter << " done.";
 
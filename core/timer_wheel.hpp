@@ -0,0 +1,181 @@
+#ifndef SPARKS_CORE_TIMER_WHEEL_HPP_
+#define SPARKS_CORE_TIMER_WHEEL_HPP_
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace sparks {
+
+// A hierarchical timer wheel: timers are hashed by deadline into NUM_LEVELS
+// levels of 64 slots, level l covering deadlines up to 64^(l + 1) ticks away
+// with slots 64^l ticks wide. Adding a timer is O(1); advancing fires the
+// slot of each tick passed on level 0, and cascades a higher level's slot
+// into the lower levels whenever the one below wraps around, skipping the
+// ticks where neither happens. Deadlines
+// further away than the wheel covers wait in the last level's furthest slot.
+//
+// Time is in abstract Ticks; not thread-safe.
+template <typename PayloadType, uint8_t NUM_LEVELS = 5>
+class TimerWheel {
+ public:
+  using Payload = PayloadType;
+  using Tick = uint64_t;
+
+  static const Tick NEVER = std::numeric_limits<Tick>::max();
+
+  // Timers beyond the wheel need a level to cascade from, and the wheel
+  // cannot span more than 2^64 ticks.
+  static_assert(NUM_LEVELS >= 2 && NUM_LEVELS <= 10,
+                "A TimerWheel has between 2 and 10 levels.");
+
+  explicit TimerWheel(Tick now = 0) : current_{now} {}
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  // The last tick advanced to.
+  Tick current_tick() const { return current_; }
+
+  // Adds a timer which fires once advance() reaches deadline, or on the next
+  // advance() if the deadline has passed already.
+  void add(Tick deadline, Payload payload) {
+    if (deadline <= current_) deadline = current_ + 1;
+    insert(Timer{deadline, std::move(payload)});
+    ++size_;
+  }
+
+  // Advances to tick now, calling fire(payload) for every timer due by then,
+  // in deadline order (to the tick). fire() may add timers.
+  template <typename FireCallback>
+  void advance(Tick now, FireCallback&& fire);
+
+  // A tick after current_tick(), at or before the earliest deadline; NEVER if
+  // there are no timers. It is earlier than the deadline only when timers are
+  // cascaded before then: at most once per level for deadlines the wheel
+  // spans, after which it is exact.
+  Tick next_tick() const;
+
+ private:
+  static const uint8_t SLOT_BITS = 6;
+  static const uint32_t NUM_SLOTS = 1u << SLOT_BITS;
+  static const uint32_t SLOT_MASK = NUM_SLOTS - 1;
+
+  struct Timer {
+    Tick deadline;
+    Payload payload;
+  };
+
+  static uint64_t rotate_right(uint64_t bits, uint32_t by) {
+    return (bits >> by) | (bits << ((64 - by) & 63));
+  }
+
+  void insert(Timer&& timer) {
+    const Tick delta = timer.deadline - current_;
+    uint8_t level = 0;
+    while (level + 1 < NUM_LEVELS &&
+           delta >= (Tick{1} << (SLOT_BITS * (level + 1)))) {
+      ++level;
+    }
+
+    // Beyond the last level, the furthest slot it has.
+    Tick position = timer.deadline;
+    const Tick max_delta = (Tick{1} << (SLOT_BITS * NUM_LEVELS)) - 1;
+    if (delta > max_delta) position = current_ + max_delta;
+
+    const uint32_t slot = (position >> (SLOT_BITS * level)) & SLOT_MASK;
+    slots_[level][slot].push_back(std::move(timer));
+    occupied_[level] |= uint64_t{1} << slot;
+  }
+
+  // Moves the timers of a slot into taken_.
+  void take_slot(uint8_t level, uint32_t slot) {
+    taken_.clear();
+    taken_.swap(slots_[level][slot]);
+    occupied_[level] &= ~(uint64_t{1} << slot);
+  }
+
+  std::vector<Timer> slots_[NUM_LEVELS][NUM_SLOTS];
+
+  // Bit i of occupied_[l] is set iff slots_[l][i] is not empty.
+  uint64_t occupied_[NUM_LEVELS] = {};
+
+  Tick current_;
+  size_t size_{0};
+
+  // Scratch space for the timers of the slot being fired or cascaded.
+  std::vector<Timer> taken_;
+  std::vector<Timer> firing_;
+};
+
+template <typename PayloadType, uint8_t NUM_LEVELS>
+const typename TimerWheel<PayloadType, NUM_LEVELS>::Tick
+    TimerWheel<PayloadType, NUM_LEVELS>::NEVER;
+
+template <typename PayloadType, uint8_t NUM_LEVELS>
+template <typename FireCallback>
+void TimerWheel<PayloadType, NUM_LEVELS>::advance(Tick now,
+                                                  FireCallback&& fire) {
+  while (current_ < now) {
+    // Nothing fires or cascades before next_tick(): skip ahead to it.
+    const Tick next = next_tick();
+    if (next > now) {
+      current_ = now;
+      break;
+    }
+    current_ = next - 1;
+
+    const Tick tick = ++current_;
+
+    // Cascade from the highest level which wrapped around, so that timers
+    // end up on the lowest level they can.
+    uint8_t wrapped = 0;
+    while (wrapped + 1 < NUM_LEVELS &&
+           (tick & ((Tick{1} << (SLOT_BITS * (wrapped + 1))) - 1)) == 0) {
+      ++wrapped;
+    }
+    for (uint8_t level = wrapped; level > 0; --level) {
+      take_slot(level, (tick >> (SLOT_BITS * level)) & SLOT_MASK);
+      for (auto& timer : taken_) insert(std::move(timer));
+    }
+
+    // Fired from firing_, so that fire() can add timers to any slot.
+    take_slot(0, tick & SLOT_MASK);
+    firing_.swap(taken_);
+    size_ -= firing_.size();
+    for (auto& timer : firing_) {
+      DCHECK_LE(timer.deadline, tick);
+      fire(std::move(timer.payload));
+    }
+    firing_.clear();
+  }
+}
+
+template <typename PayloadType, uint8_t NUM_LEVELS>
+typename TimerWheel<PayloadType, NUM_LEVELS>::Tick
+TimerWheel<PayloadType, NUM_LEVELS>::next_tick() const {
+  if (size_ == 0) return NEVER;
+
+  Tick next = NEVER;
+  for (uint8_t level = 0; level < NUM_LEVELS; ++level) {
+    if (occupied_[level] == 0) continue;
+
+    // The next slot at this level begins with the next block of 64^level
+    // ticks; the first occupied one from there is the next to fire (level 0)
+    // or cascade.
+    const uint8_t shift = SLOT_BITS * level;
+    const Tick next_block = (current_ >> shift) + 1;
+    const auto rotated = rotate_right(
+        occupied_[level], static_cast<uint32_t>(next_block & SLOT_MASK));
+    const Tick block = next_block + __builtin_ctzll(rotated);
+    if ((block << shift) < next) next = block << shift;
+  }
+  return next;
+}
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_TIMER_WHEEL_HPP_
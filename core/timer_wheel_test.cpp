@@ -0,0 +1,171 @@
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+using Tick = uint64_t;
+
+// A wheel of timers whose payloads index their deadlines, checking every
+// advance() against those.
+template <uint8_t NUM_LEVELS>
+class CheckedWheel {
+ public:
+  using Wheel = TimerWheel<int, NUM_LEVELS>;
+
+  explicit CheckedWheel(Tick now = 0) : wheel_{now} {}
+
+  Wheel& wheel() { return wheel_; }
+
+  void add(Tick deadline) {
+    // Deadlines which have passed are due on the next tick.
+    deadlines_.push_back(std::max(deadline, wheel_.current_tick() + 1));
+    fired_.push_back(false);
+    wheel_.add(deadline, static_cast<int>(deadlines_.size() - 1));
+  }
+
+  // Advances to now, checking that exactly the timers due by then fire, in
+  // deadline order. Returns how many fired.
+  int advance(Tick now) {
+    const Tick before = wheel_.current_tick();
+    Tick last_deadline = 0;
+    int num_fired = 0;
+    wheel_.advance(now, [&](int timer) {
+      const Tick deadline = deadlines_[timer];
+      EXPECT_FALSE(fired_[timer]) << "Fired twice: " << timer;
+      EXPECT_GT(deadline, before);
+      EXPECT_LE(deadline, now);
+      EXPECT_GE(deadline, last_deadline) << "Fired out of order.";
+      fired_[timer] = true;
+      last_deadline = deadline;
+      ++num_fired;
+    });
+    EXPECT_EQ(now, wheel_.current_tick());
+    for (size_t i = 0; i < deadlines_.size(); ++i) {
+      EXPECT_TRUE(fired_[i] || deadlines_[i] > now)
+          << "Missed timer due at " << deadlines_[i] << " by " << now;
+    }
+    return num_fired;
+  }
+
+  // The earliest deadline of the timers which haven't fired.
+  Tick earliest() const {
+    Tick earliest = Wheel::NEVER;
+    for (size_t i = 0; i < deadlines_.size(); ++i) {
+      if (!fired_[i]) earliest = std::min(earliest, deadlines_[i]);
+    }
+    return earliest;
+  }
+
+ private:
+  Wheel wheel_;
+  std::vector<Tick> deadlines_;
+  std::vector<bool> fired_;
+};
+
+TEST(TimerWheelTest, FiresAtDeadlines) {
+  // Deadlines around each level's boundaries and beyond the five levels.
+  const Tick deadlines[] = {1,      2,      63,      64,      65,
+                            4095,   4096,   4097,    262143,  262144,
+                            262145, 999999, 1 << 30, 1ull << 31};
+  CheckedWheel<5> checked;
+  for (Tick deadline : deadlines) checked.add(deadline);
+  EXPECT_EQ(14u, checked.wheel().size());
+
+  // Tick by tick around the deadlines, in one go between them.
+  for (Tick deadline : deadlines) {
+    checked.advance(deadline - 1);
+    EXPECT_EQ(1, checked.advance(deadline)) << deadline;
+  }
+  EXPECT_TRUE(checked.wheel().empty());
+  EXPECT_EQ(TimerWheel<int>::NEVER, checked.wheel().next_tick());
+}
+
+TEST(TimerWheelTest, PastDeadlinesFireOnTheNextTick) {
+  CheckedWheel<2> checked{100};
+  checked.add(0);
+  checked.add(100);
+  checked.add(101);
+  EXPECT_EQ(101u, checked.wheel().next_tick());
+  EXPECT_EQ(3, checked.advance(101));
+}
+
+// fire() may add timers, including ones due within the same advance().
+TEST(TimerWheelTest, FireCanRearm) {
+  TimerWheel<int> wheel;
+  wheel.add(10, 0);
+  std::vector<Tick> fired_at;
+  wheel.advance(1000, [&](int timer) {
+    fired_at.push_back(wheel.current_tick());
+    wheel.add(wheel.current_tick() + 100, timer);
+  });
+  ASSERT_EQ(10u, fired_at.size());
+  for (size_t i = 0; i < fired_at.size(); ++i) {
+    EXPECT_EQ(10 + 100 * i, fired_at[i]);
+  }
+  EXPECT_EQ(1u, wheel.size());
+  EXPECT_EQ(1010u, wheel.next_tick());
+}
+
+// next_tick() is never after the earliest deadline, and reaches it after at
+// most one cascade per level.
+TEST(TimerWheelTest, NextTickLeadsToTheEarliestDeadline) {
+  std::mt19937 random{12};
+  for (int round = 0; round < 1000; ++round) {
+    CheckedWheel<3> checked{random() % 100000};
+    for (int i = 0; i < 5; ++i) {
+      // Deadlines the 2^18 ticks of the wheel span, on any level.
+      const int level = random() % 3;
+      checked.add(checked.wheel().current_tick() + 1 +
+                  random() % (Tick{1} << (6 * (level + 1))));
+    }
+
+    const Tick earliest = checked.earliest();
+    int num_steps = 0;
+    for (;;) {
+      const Tick next = checked.wheel().next_tick();
+      ASSERT_GT(next, checked.wheel().current_tick());
+      ASSERT_LE(next, earliest);
+      ++num_steps;
+      if (checked.advance(next) > 0) break;
+    }
+    EXPECT_LE(num_steps, 3);
+  }
+}
+
+// Random adds and advances, many spanning several levels or the whole wheel.
+TEST(TimerWheelTest, RandomTimers) {
+  std::mt19937 random{13};
+  CheckedWheel<3> checked;
+  for (int i = 0; i < 2000; ++i) {
+    const Tick now = checked.wheel().current_tick();
+    switch (random() % 4) {
+      case 0:
+        checked.add(now + random() % 64);
+        break;
+      case 1:
+        checked.add(now + random() % 300000);
+        break;
+      case 2:
+        checked.advance(now + 1 + random() % 100);
+        break;
+      case 3:
+        checked.advance(now + 1 + random() % 20000);
+        break;
+    }
+    const Tick next = checked.wheel().next_tick();
+    ASSERT_GT(next, checked.wheel().current_tick());
+    ASSERT_LE(next, checked.earliest());
+  }
+  checked.advance(checked.wheel().current_tick() + 1000000);
+  EXPECT_TRUE(checked.wheel().empty());
+}
+
+}  // namespace
+}  // namespace sparks
@@ -0,0 +1,52 @@
+#ifndef SPARKS_CORE_UNIQUE_PULSE_HPP_
+#define SPARKS_CORE_UNIQUE_PULSE_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+#include <glog/logging.h>
+
+#include "futex.hpp"
+
+namespace sparks {
+
+// An auto-reset event with a single waiter: wait() blocks until pulse() is
+// called, consuming the pulse; pulses sent while nobody waits are coalesced
+// into one. pulse() is a single atomic exchange, which is followed by a futex
+// wake only if the waiter is actually asleep.
+class UniquePulse {
+ public:
+  inline void pulse();
+  inline void wait();
+
+ private:
+  enum : uint32_t { IDLE = 0, PULSED = 1, ASLEEP = 2 };
+
+  std::atomic<uint32_t> state_{IDLE};
+};
+
+void UniquePulse::pulse() {
+  if (state_.exchange(PULSED) == ASLEEP) futex_wake(state_);
+}
+
+void UniquePulse::wait() {
+  // Either consume a pending pulse or announce we are going to sleep.
+  auto state = state_.load();
+  while (true) {
+    DCHECK_NE(state, ASLEEP) << "UniquePulse has more than one waiter.";
+    if (state == PULSED) {
+      if (state_.compare_exchange_weak(state, IDLE)) return;
+    } else if (state_.compare_exchange_weak(state, ASLEEP)) {
+      break;
+    }
+  }
+
+  do {
+    futex_wait(state_, ASLEEP);
+  } while (state_.load() == ASLEEP);
+  state_.exchange(IDLE);
+}
+
+}  // namespace sparks
+
+#endif  // #ifndef SPARKS_CORE_UNIQUE_PULSE_HPP_
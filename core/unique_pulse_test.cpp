@@ -0,0 +1,66 @@
+#include "unique_pulse.hpp"
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace sparks {
+namespace {
+
+TEST(UniquePulseTest, PulseBeforeWaitIsNotLost) {
+  UniquePulse pulse;
+  pulse.pulse();
+  pulse.pulse();  // Coalesced with the first one.
+  pulse.wait();
+}
+
+TEST(UniquePulseTest, PingPong) {
+  const int kNumRounds = 20000;
+  UniquePulse ping, pong;
+  std::atomic<int> rounds{0};
+
+  std::thread ponger{[&] {
+    for (int i = 0; i < kNumRounds; ++i) {
+      ping.wait();
+      rounds.fetch_add(1);
+      pong.pulse();
+    }
+  }};
+
+  for (int i = 0; i < kNumRounds; ++i) {
+    ping.pulse();
+    pong.wait();
+    EXPECT_EQ(i + 1, rounds.load());
+  }
+  ponger.join();
+}
+
+TEST(UniquePulseTest, ManyPulsersOneWaiter) {
+  const int kNumPulsers = 4;
+  const int kNumPulses = 20000;
+  UniquePulse pulse;
+  std::atomic<int> pulses_left{kNumPulsers * kNumPulses};
+  std::atomic<bool> done{false};
+
+  std::thread waiter{[&] {
+    while (pulses_left.load() > 0) pulse.wait();
+    done.store(true);
+  }};
+
+  std::thread pulsers[kNumPulsers];
+  for (auto& pulser : pulsers) {
+    pulser = std::thread{[&] {
+      for (int i = 0; i < kNumPulses; ++i) {
+        pulses_left.fetch_sub(1);
+        pulse.pulse();
+      }
+    }};
+  }
+  for (auto& pulser : pulsers) pulser.join();
+  waiter.join();
+  EXPECT_TRUE(done.load());
+}
+
+}  // namespace
+}  // namespace sparks
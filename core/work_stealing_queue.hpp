@@ -8,10 +8,16 @@
 #include <mutex>
 #include <type_traits>
 
+#include "cache_line.hpp"
+
 namespace sparks {
 
+// The owner pushes and pulls at the tail, other threads steal from the head
+// under foreign_sync_. Each of those sits on a cache line of its own, so that
+// the owner's pushes don't slow down thieves and vice versa, and the queue as
+// a whole doesn't share one with its neighbours in an array.
 template <class Element_, size_t CAPACITY_BITS, typename Size_ = uint32_t>
-class WorkStealingQueue {
+class alignas(CACHE_LINE_SIZE) WorkStealingQueue {
  public:
   using Element = Element_;
   using Size = Size_;
@@ -93,9 +99,14 @@ class WorkStealingQueue {
 
  private:
   Element *elements_;
-  AtomicIdx head_{0};
-  AtomicIdx tail_{0};
-  Mutex foreign_sync_;
+
+  // Written by thieves, read by the owner.
+  alignas(CACHE_LINE_SIZE) AtomicIdx head_{0};
+
+  // Written by the owner, read by thieves.
+  alignas(CACHE_LINE_SIZE) AtomicIdx tail_{0};
+
+  alignas(CACHE_LINE_SIZE) Mutex foreign_sync_;
 };
 
 }  // namespace sparks
@@ -0,0 +1,64 @@
+#include "work_stealing_queue.hpp"
+
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+namespace sparks {
+namespace {
+
+using Element = uint32_t;
+using Queue = WorkStealingQueue<Element, 16>;
+
+// Owner-only traffic: push a batch of state.range(0) elements then pop them.
+void BM_WorkStealingQueueUniquePushPull(benchmark::State& state) {
+  Queue queue;
+  const auto batch = static_cast<Element>(state.range(0));
+  Element to = 0;
+  for (auto _ : state) {
+    for (Element i = 0; i < batch; ++i) queue.unique_push(i);
+    for (Element i = 0; i < batch; ++i) queue.unique_pull(to);
+    benchmark::DoNotOptimize(to);
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_WorkStealingQueueUniquePushPull)
+    ->RangeMultiplier(8)
+    ->Range(8, 4096);
+
+// Single-threaded cost of a shared_pull(), i.e. of taking the foreign lock.
+void BM_WorkStealingQueueSharedPull(benchmark::State& state) {
+  Queue queue;
+  Element to = 0;
+  for (auto _ : state) {
+    queue.unique_push(1);
+    queue.shared_pull(to);
+    benchmark::DoNotOptimize(to);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_WorkStealingQueueSharedPull);
+
+// Thread 0 owns the queue, pushing and popping; every other thread steals.
+void BM_WorkStealingQueueContended(benchmark::State& state) {
+  static Queue queue;
+  Element to = 0;
+  int64_t succeeded = 0;
+  if (state.thread_index() == 0) {
+    for (auto _ : state) {
+      queue.unique_push(1);
+      queue.unique_push(2);
+      succeeded += queue.unique_pull(to);
+      succeeded += queue.unique_pull(to);
+    }
+    while (queue.unique_pull(to)) {}
+  } else {
+    for (auto _ : state) succeeded += queue.shared_pull(to);
+  }
+  benchmark::DoNotOptimize(to);
+  state.SetItemsProcessed(succeeded);
+}
+BENCHMARK(BM_WorkStealingQueueContended)->ThreadRange(1, 8)->UseRealTime();
+
+}  // namespace
+}  // namespace sparks
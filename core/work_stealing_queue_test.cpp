@@ -88,22 +88,14 @@ TEST(WorkStealingQueueTest, ManyThreads) {
     auto num_threads = NUM_THREADS[i_num_threads];
     VLOG(1) << "With " << num_threads << " threads.";
     std::vector<std::thread> threads;
-    std::vector<std::atomic<uint32_t>> produced;
-    std::vector<std::atomic<uint32_t>> consumed;
-    std::vector<std::atomic<uint32_t>> consumed_by;
+    std::vector<std::atomic<uint32_t>> produced(NUM_ENTRIES);
+    std::vector<std::atomic<uint32_t>> consumed(NUM_ENTRIES);
+    std::vector<std::atomic<uint32_t>> consumed_by(num_threads);
     std::atomic<bool> last_thread_ready{false};
     std::atomic<bool> closed{false};
     threads.reserve(num_threads);
-    produced.reserve(NUM_ENTRIES);
-    consumed.reserve(NUM_ENTRIES);
-    consumed_by.reserve(num_threads);
-    for (size_t i_entry = 0; i_entry < NUM_ENTRIES; ++i_entry) {
-      produced.emplace_back(0);
-      consumed.emplace_back(0);
-    }
 
     for (int i_thread = 0; i_thread < num_threads; ++i_thread) {
-      consumed_by.emplace_back(0);
       threads.emplace_back([&pool, &consumed, &closed, &last_thread_ready,
                             &consumed_by, i_thread, num_threads] {
         std::minstd_rand0 gen{i_thread};
@@ -1,3 +0,0 @@
-extern "C" {
-  void sparks_force_compilation() {}
-}